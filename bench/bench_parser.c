@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/ast.h"
+
+/*
+ * Parse benchmark over programs with a growing number of top-level
+ * statements. With amortized O(1) child appends the time per statement stays
+ * flat as the program grows.
+ */
+
+static char *generate_program(size_t statements) {
+  char *source = (char *)malloc(statements * 32 + 1);
+  if (!source)
+    return NULL;
+
+  size_t length = 0;
+  for (size_t i = 0; i < statements; i++) {
+    length += (size_t)sprintf(source + length, "let v%zu = %zu;\n", i, i % 1000);
+  }
+  source[length] = '\0';
+
+  return source;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+  const size_t sizes[] = {100000, 200000, 400000, 800000, 1600000};
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    char *source = generate_program(sizes[i]);
+    if (!source) {
+      fprintf(stderr, "Failed to allocate the benchmark input\n");
+      return EXIT_FAILURE;
+    }
+
+    AST ast;
+    if (init_ast(&ast, source) != AST_INIT_OK) {
+      fprintf(stderr, "Failed to initialize the AST\n");
+      free(source);
+      return EXIT_FAILURE;
+    }
+
+    double start = now_seconds();
+    ASTNode *program = ast_parse_program(&ast);
+    double elapsed = now_seconds() - start;
+
+    printf("%8zu statements: %8.2f ms  %6.1f ns/statement  (%zu parsed)\n",
+           sizes[i], elapsed * 1e3, elapsed * 1e9 / (double)sizes[i],
+           program ? program->children_count : 0);
+
+    free_ast(&ast);
+    free(source);
+  }
+
+  return EXIT_SUCCESS;
+}
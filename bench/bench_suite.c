@@ -0,0 +1,567 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/batch.h"
+#include "../include/compiler.h"
+#include "../include/token_array.h"
+#include "../include/vm.h"
+
+/*
+ * Benchmark suite measuring the throughput of `next_token`,
+ * `next_lexical_token`, `lex_token_array` (on one thread and in parallel),
+ * `ast_parse_program` and `vm_run` over a generated corpus of small, medium
+ * and large scripts. The corpus is produced from a fixed seed,
+ * so runs on the same machine can be compared against each other.
+ *
+ * For every phase and script the suite reports MB/s and tokens/s of the best
+ * sample, the number of heap allocations per token and the peak resident set
+ * size of the process so far. The VM is measured separately, in instructions
+ * per second over the compiled scripts, and so are the garbage collector over
+ * an allocation-heavy script and `parse_files` over many files with a growing
+ * number of threads.
+ */
+
+#define SAMPLES 5
+
+/*
+ * Every sample processes at least this many bytes, repeating small scripts as
+ * needed so that timer resolution does not dominate.
+ */
+#define SAMPLE_BYTES (16 * 1024 * 1024)
+
+/*
+ * Number of files of the multi-file benchmark, each a copy of the medium
+ * script.
+ */
+#define BATCH_FILES 256
+
+#ifdef CIJS_BENCH_COUNT_ALLOCATIONS
+
+/*
+ * Allocation counters. The target is linked with `--wrap` for the allocation
+ * functions, so every call made by the interpreter goes through these.
+ */
+static unsigned long allocation_count;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  allocation_count++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  allocation_count++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+  allocation_count++;
+  return __real_realloc(pointer, size);
+}
+
+#endif
+
+/*
+ * A script of the corpus.
+ */
+typedef struct {
+  const char *name;
+  size_t size;
+  char *source;
+  size_t length;
+} Script;
+
+/*
+ * A phase of the pipeline. `run` processes a whole script once and returns the
+ * number of tokens it went through, 0 if it does not count them.
+ */
+typedef struct {
+  const char *name;
+  unsigned long (*run)(const Source *source);
+} Phase;
+
+static uint64_t random_state = 0x9e3779b97f4a7c15ull;
+
+/*
+ * Helper function returning the next number of a xorshift generator, so the
+ * corpus is the same on every run.
+ */
+static uint64_t next_random(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return random_state;
+}
+
+/*
+ * Builds a script of roughly `size` bytes mixing declarations of numbers,
+ * keyword literals, references to earlier variables and additions, in
+ * statements the parser and the compiler accept.
+ */
+static char *generate_script(size_t size, size_t *length) {
+  char *source = (char *)malloc(size + 256);
+  if (!source)
+    return NULL;
+
+  static const char *literals[] = {"true", "false", "null"};
+
+  size_t used = 0;
+  unsigned long i = 0;
+
+  while (used < size) {
+    /* Only variables declared before statement i can be referenced. */
+    switch (i == 0 ? 0 : next_random() % 4) {
+    case 0:
+      used += (size_t)sprintf(source + used, "let v%lu = %lu;\n", i,
+                              (unsigned long)(next_random() % 100000));
+      break;
+    case 1:
+      used += (size_t)sprintf(source + used, "let v%lu = v%lu;\n", i,
+                              (unsigned long)(next_random() % i));
+      break;
+    case 2:
+      used += (size_t)sprintf(source + used, "let v%lu = %s;\n", i,
+                              literals[next_random() % 3]);
+      break;
+    default:
+      used += (size_t)sprintf(source + used,
+                              "  let v%lu = v%lu + v%lu + %lu;\n\n", i,
+                              (unsigned long)(next_random() % i),
+                              (unsigned long)(next_random() % i),
+                              (unsigned long)(next_random() % 1000));
+      break;
+    }
+    i++;
+  }
+
+  source[used] = '\0';
+  *length = used;
+
+  return source;
+}
+
+static unsigned long run_tokenizer(const Source *source) {
+  Tokenizer tokenizer;
+  if (init_tokenizer_source(&tokenizer, source) != TOKENIZER_INIT_OK)
+    return 0;
+
+  unsigned long count = 0;
+  while (next_token(&tokenizer).length > 0) {
+    count++;
+  }
+
+  free_tokenizer(&tokenizer);
+
+  return count;
+}
+
+static unsigned long run_lexer(const Source *source) {
+  Lexer lexer;
+  if (init_lexer_source(&lexer, source) != LEXER_INIT_OK)
+    return 0;
+
+  unsigned long count = 0;
+  while (next_lexical_token(&lexer).type != TOKEN_EOF) {
+    count++;
+  }
+
+  free_lexer(&lexer);
+
+  return count;
+}
+
+/*
+ * Helper function lexing a script into a token array with interned names, in
+ * parallel when `parallel` is set.
+ */
+static unsigned long lex_into_array(const Source *source, bool parallel) {
+  AtomTable atoms;
+  init_atom_table(&atoms);
+  TokenArray tokens;
+  init_token_array(&tokens);
+
+  TokenArrayError error =
+      parallel ? lex_token_array_parallel(source, &atoms, NULL, &tokens)
+               : lex_token_array(source, &atoms, &tokens);
+  unsigned long count = error == TOKEN_ARRAY_OK ? tokens.count - 1 : 0;
+
+  free_token_array(&tokens);
+  free_atom_table(&atoms);
+
+  return count;
+}
+
+static unsigned long run_lex_array(const Source *source) {
+  return lex_into_array(source, false);
+}
+
+static unsigned long run_lex_parallel(const Source *source) {
+  return lex_into_array(source, true);
+}
+
+static unsigned long run_parser(const Source *source) {
+  AST ast;
+  if (init_ast_source(&ast, source) != AST_INIT_OK)
+    return 0;
+
+  ast_parse_program(&ast);
+  free_ast(&ast);
+
+  return 0;
+}
+
+static unsigned long run_parser_array(const Source *source) {
+  AST ast;
+  if (init_ast_tokens(&ast, source, NULL) != AST_INIT_OK)
+    return 0;
+
+  ast_parse_program(&ast);
+  free_ast(&ast);
+
+  return 0;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Returns the peak resident set size of the process in MB.
+ */
+static double peak_rss_mb(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+
+#ifdef __APPLE__
+  return (double)usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return (double)usage.ru_maxrss / 1024.0;
+#endif
+}
+
+/*
+ * Runs a phase over a script and prints one line of results.
+ */
+static void measure(const Phase *phase, const Script *script) {
+  Source source;
+  init_source_buffer(&source, script->source, script->length);
+
+  size_t repeats = SAMPLE_BYTES / script->length;
+  if (repeats == 0)
+    repeats = 1;
+
+  /* The tokenizer returns one span per lexer token, so all phases go through
+   * the number of tokens counted by the lexer. */
+  unsigned long tokens = run_lexer(&source);
+
+  double best = 0.0;
+  for (int sample = 0; sample < SAMPLES; sample++) {
+    double start = now_seconds();
+    for (size_t i = 0; i < repeats; i++) {
+      phase->run(&source);
+    }
+    double elapsed = (now_seconds() - start) / (double)repeats;
+
+    if (best == 0.0 || elapsed < best)
+      best = elapsed;
+  }
+
+  char allocations[32] = "n/a";
+#ifdef CIJS_BENCH_COUNT_ALLOCATIONS
+  unsigned long before = allocation_count;
+  phase->run(&source);
+  snprintf(allocations, sizeof(allocations), "%.4f",
+           (double)(allocation_count - before) / (double)tokens);
+#endif
+
+  printf("%-10s %-7s %10zu %10lu %10.1f %12.2f %10s %10.1f\n", phase->name,
+         script->name, script->length, tokens,
+         (double)script->length / (1024.0 * 1024.0) / best,
+         (double)tokens / best / 1e6, allocations, peak_rss_mb());
+}
+
+/*
+ * Compiles a script once and measures the execution of its bytecode.
+ */
+static void measure_vm(const Script *script) {
+  AST ast;
+  if (init_ast(&ast, script->source) != AST_INIT_OK)
+    return;
+
+  Chunk chunk;
+  init_chunk(&chunk);
+  ASTNode *program = ast_parse_program(&ast);
+  resolve_program(program);
+  CompileError error = compile_program(program, &chunk);
+  free_ast(&ast);
+
+  if (error != COMPILE_OK) {
+    fprintf(stderr, "Failed to compile the %s script (error code: %d)\n",
+            script->name, error);
+    free_chunk(&chunk);
+    return;
+  }
+
+  unsigned long instructions = 0;
+  for (size_t offset = 0; offset < chunk.code_count; instructions++) {
+    offset += 1 + opcode_operand_counts[chunk.code[offset]];
+  }
+
+  size_t repeats = SAMPLE_BYTES / script->length;
+  if (repeats == 0)
+    repeats = 1;
+
+  VM vm;
+  init_vm(&vm);
+  vm_run(&vm, &chunk);
+
+  double best = 0.0;
+  for (int sample = 0; sample < SAMPLES; sample++) {
+    double start = now_seconds();
+    for (size_t i = 0; i < repeats; i++) {
+      vm_run(&vm, &chunk);
+    }
+    double elapsed = (now_seconds() - start) / (double)repeats;
+
+    if (best == 0.0 || elapsed < best)
+      best = elapsed;
+  }
+
+  char allocations[32] = "n/a";
+#ifdef CIJS_BENCH_COUNT_ALLOCATIONS
+  unsigned long before = allocation_count;
+  vm_run(&vm, &chunk);
+  snprintf(allocations, sizeof(allocations), "%.4f",
+           (double)(allocation_count - before) / (double)instructions);
+#endif
+
+  printf("%-10s %-7s %10zu %10lu %10.1f %12.2f %10s %10.1f\n", "vm",
+         script->name, chunk.code_count * sizeof(uint32_t), instructions,
+         (double)(chunk.code_count * sizeof(uint32_t)) / (1024.0 * 1024.0) /
+             best,
+         (double)instructions / best / 1e6, allocations, peak_rss_mb());
+
+  free_vm(&vm);
+  free_chunk(&chunk);
+}
+
+/*
+ * Builds an allocation-heavy script of `statements` statements, each
+ * replacing a variable with new objects, keeping every thousandth in a
+ * chain so that some objects survive collections.
+ */
+static char *generate_garbage_script(unsigned long statements) {
+  char *source = (char *)malloc(statements * 48 + 64);
+  if (!source)
+    return NULL;
+
+  size_t used = (size_t)sprintf(source, "let keep = {n: 0}; let t;\n");
+  for (unsigned long i = 1; i <= statements; i++) {
+    used += (size_t)sprintf(source + used, "t = {a: {b: %lu}};\n", i);
+    if (i % 1000 == 0) {
+      used += (size_t)sprintf(source + used,
+                              "keep = {next: keep, t: t, n: %lu};\n", i);
+    }
+  }
+
+  return source;
+}
+
+/*
+ * Runs the allocation-heavy script and reports the allocation rate of the VM
+ * and the pauses of the garbage collector.
+ */
+static void measure_gc(void) {
+  char *source = generate_garbage_script(100000);
+  if (!source)
+    return;
+
+  AST ast;
+  if (init_ast(&ast, source) != AST_INIT_OK) {
+    free(source);
+    return;
+  }
+
+  Chunk chunk;
+  init_chunk(&chunk);
+  ASTNode *program = ast_parse_program(&ast);
+  resolve_program(program);
+  CompileError error = compile_program(program, &chunk);
+  free_ast(&ast);
+  free(source);
+
+  if (error != COMPILE_OK) {
+    fprintf(stderr, "Failed to compile the gc script (error code: %d)\n",
+            error);
+    free_chunk(&chunk);
+    return;
+  }
+
+  VM vm;
+  init_vm(&vm);
+
+  double best = 0.0;
+  for (int sample = 0; sample < SAMPLES; sample++) {
+    double start = now_seconds();
+    vm_run(&vm, &chunk);
+    double elapsed = now_seconds() - start;
+
+    if (best == 0.0 || elapsed < best)
+      best = elapsed;
+  }
+
+  const HeapStats *stats = &vm.heap.stats;
+  printf("%-10s %10.1f %10.1f %10.1f %10.1f %12.1f %10.1f\n", "gc",
+         (double)stats->bytes_allocated / SAMPLES / (1024.0 * 1024.0),
+         (double)stats->bytes_allocated / SAMPLES / (1024.0 * 1024.0) / best,
+         (double)stats->minor_collections / SAMPLES,
+         (double)stats->major_collections / SAMPLES,
+         stats->max_pause_seconds * 1e6,
+         stats->minor_collections + stats->major_collections
+             ? stats->pause_seconds * 1e6 /
+                   (double)(stats->minor_collections +
+                            stats->major_collections)
+             : 0.0);
+
+  free_vm(&vm);
+  free_chunk(&chunk);
+}
+
+/*
+ * Writes BATCH_FILES copies of a script to temporary files and measures how
+ * long `parse_files` takes on them with 1, 2, 4, ... threads, up to one per
+ * online CPU.
+ */
+static void measure_batch(const Script *script) {
+  ParsedFile files[BATCH_FILES];
+  char paths[BATCH_FILES][32];
+  size_t written = 0;
+
+  for (; written < BATCH_FILES; written++) {
+    snprintf(paths[written], sizeof(paths[written]), "/tmp/cijs_bench_XXXXXX");
+    int fd = mkstemp(paths[written]);
+    if (fd < 0)
+      break;
+
+    ssize_t count = write(fd, script->source, script->length);
+    close(fd);
+    if (count != (ssize_t)script->length) {
+      unlink(paths[written]);
+      break;
+    }
+  }
+
+  if (written == BATCH_FILES) {
+    unsigned cpus = batch_default_threads();
+    double single = 0.0;
+
+    for (unsigned threads = 1;; threads *= 2) {
+      if (threads > cpus)
+        threads = cpus;
+
+      double best = 0.0;
+      for (int sample = 0; sample < SAMPLES; sample++) {
+        for (size_t i = 0; i < BATCH_FILES; i++) {
+          files[i].path = paths[i];
+        }
+
+        BatchOptions options = {.threads = threads};
+        double start = now_seconds();
+        parse_files(files, BATCH_FILES, &options);
+        double elapsed = now_seconds() - start;
+
+        for (size_t i = 0; i < BATCH_FILES; i++) {
+          free_parsed_file(&files[i]);
+        }
+
+        if (best == 0.0 || elapsed < best)
+          best = elapsed;
+      }
+
+      if (threads == 1)
+        single = best;
+
+      printf("%-10s %-7u %10d %10.2f %10.1f %12.2f\n", "batch", threads,
+             BATCH_FILES, best * 1e3,
+             (double)script->length * BATCH_FILES / (1024.0 * 1024.0) / best,
+             single / best);
+
+      if (threads == cpus)
+        break;
+    }
+  } else {
+    fprintf(stderr, "Failed to write the files of the batch benchmark\n");
+  }
+
+  for (size_t i = 0; i < written; i++) {
+    unlink(paths[i]);
+  }
+}
+
+int main(void) {
+  Script corpus[] = {
+      {.name = "small", .size = 1024},
+      {.name = "medium", .size = 64 * 1024},
+      {.name = "large", .size = 8 * 1024 * 1024},
+  };
+  const size_t corpus_size = sizeof(corpus) / sizeof(corpus[0]);
+
+  const Phase phases[] = {
+      {.name = "tokenizer", .run = run_tokenizer},
+      {.name = "lexer", .run = run_lexer},
+      {.name = "lex-array", .run = run_lex_array},
+      {.name = "lex-par", .run = run_lex_parallel},
+      {.name = "parser", .run = run_parser},
+      {.name = "parse-arr", .run = run_parser_array},
+  };
+
+  for (size_t i = 0; i < corpus_size; i++) {
+    corpus[i].source = generate_script(corpus[i].size, &corpus[i].length);
+    if (!corpus[i].source) {
+      fprintf(stderr, "Failed to allocate the benchmark corpus\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf("%-10s %-7s %10s %10s %10s %12s %10s %10s\n", "phase", "script",
+         "bytes", "tokens", "MB/s", "Mtokens/s", "allocs/tok", "peak MB");
+
+  for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+    for (size_t i = 0; i < corpus_size; i++) {
+      measure(&phases[p], &corpus[i]);
+    }
+  }
+
+  printf("\n%-10s %-7s %10s %10s %10s %12s %10s %10s\n", "phase", "script",
+         "code bytes", "instrs", "MB/s", "Minstrs/s", "allocs/ins", "peak MB");
+
+  for (size_t i = 0; i < corpus_size; i++) {
+    measure_vm(&corpus[i]);
+  }
+
+  printf("\n%-10s %10s %10s %10s %10s %12s %10s\n", "phase", "alloc MB",
+         "MB/s", "minor", "major", "max pause us", "avg us");
+
+  measure_gc();
+
+  printf("\n%-10s %-7s %10s %10s %10s %12s\n", "phase", "threads", "files",
+         "ms", "MB/s", "speedup");
+
+  measure_batch(&corpus[1]);
+
+  for (size_t i = 0; i < corpus_size; i++) {
+    free(corpus[i].source);
+  }
+
+  return EXIT_SUCCESS;
+}
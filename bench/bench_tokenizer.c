@@ -0,0 +1,143 @@
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/tokenizer.h"
+
+/*
+ * Microbenchmark comparing the table-driven/SIMD tokenizer with the previous
+ * byte-by-byte scanner built on libc ctype functions.
+ */
+
+#define INPUT_SIZE (32 * 1024 * 1024)
+#define RUNS 5
+
+/*
+ * The scanner as it was before the character class table: one ctype call per
+ * byte and a chain of comparisons for delimiters.
+ */
+static inline bool baseline_is_delimiter(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == ';';
+}
+
+static TokenSpan baseline_next_token(Tokenizer *tokenizer) {
+  TokenSpan span = {.offset = 0, .length = 0};
+
+  while (baseline_is_delimiter(tokenizer->source[tokenizer->position])) {
+    tokenizer->position++;
+  }
+
+  span.offset = tokenizer->position;
+
+  if (tokenizer->source[tokenizer->position] == '\0') {
+    return span;
+  }
+
+  if (isalpha(tokenizer->source[tokenizer->position])) {
+    while (tokenizer->source[tokenizer->position] != '\0' &&
+           !baseline_is_delimiter(tokenizer->source[tokenizer->position]) &&
+           isalnum(tokenizer->source[tokenizer->position])) {
+      tokenizer->position++;
+    }
+  } else {
+    tokenizer->position++;
+  }
+
+  span.length = tokenizer->position - span.offset;
+
+  return span;
+}
+
+/*
+ * Builds a synthetic program of roughly INPUT_SIZE bytes. Minified sources
+ * have no whitespace beyond what is required, pretty-printed ones use
+ * indentation, blank lines and longer names.
+ */
+static char *generate_source(bool pretty) {
+  char *source = (char *)malloc(INPUT_SIZE + 256);
+  if (!source)
+    return NULL;
+
+  size_t length = 0;
+  unsigned long i = 0;
+
+  while (length < INPUT_SIZE) {
+    if (pretty) {
+      length += (size_t)sprintf(
+          source + length,
+          "    let accumulatedValue%lu = previousValue%lu + 1234567;\n\n", i,
+          i + 1);
+    } else {
+      length += (size_t)sprintf(source + length, "let a%lu=b%lu+12;", i, i);
+    }
+    i++;
+  }
+
+  source[length] = '\0';
+
+  return source;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Runs a tokenizer function over the whole source RUNS times and returns the
+ * best throughput in MB/s.
+ */
+static double measure(const char *source, TokenSpan (*next)(Tokenizer *),
+                      unsigned long *token_count) {
+  double best = 0.0;
+
+  for (int run = 0; run < RUNS; run++) {
+    Tokenizer tokenizer;
+    init_tokenizer(&tokenizer, source);
+
+    unsigned long count = 0;
+    double start = now_seconds();
+    while (next(&tokenizer).length > 0) {
+      count++;
+    }
+    double elapsed = now_seconds() - start;
+
+    double throughput = (double)tokenizer.length / (1024.0 * 1024.0) / elapsed;
+    if (throughput > best)
+      best = throughput;
+
+    *token_count = count;
+  }
+
+  return best;
+}
+
+int main(void) {
+  const char *names[] = {"minified", "pretty-printed"};
+
+  for (int pretty = 0; pretty <= 1; pretty++) {
+    char *source = generate_source(pretty);
+    if (!source) {
+      fprintf(stderr, "Failed to allocate the benchmark input\n");
+      return EXIT_FAILURE;
+    }
+
+    unsigned long baseline_tokens = 0;
+    unsigned long tokens = 0;
+    double baseline = measure(source, baseline_next_token, &baseline_tokens);
+    double current = measure(source, next_token, &tokens);
+
+    printf("%-15s baseline: %8.1f MB/s (%lu tokens)  "
+           "table/simd: %8.1f MB/s (%lu tokens)  speedup: %.2fx\n",
+           names[pretty], baseline, baseline_tokens, current, tokens,
+           current / baseline);
+
+    free(source);
+  }
+
+  return EXIT_SUCCESS;
+}
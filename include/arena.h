@@ -0,0 +1,80 @@
+#ifndef CIJS_ARENA_H_
+#define CIJS_ARENA_H_
+
+#include <stddef.h>
+
+/**
+ * @file arena.h
+ * @brief Bump allocator used for memory that shares a single lifetime.
+ *
+ * An arena hands out memory by bumping a pointer inside large blocks and
+ * releases everything at once. Individual allocations are never freed, which
+ * makes allocation a few instructions and keeps related data (such as the
+ * nodes of one syntax tree) close together in memory.
+ */
+
+/**
+ * @struct ArenaBlock
+ * @brief A single contiguous chunk of memory owned by an arena.
+ */
+typedef struct ArenaBlock {
+  struct ArenaBlock *previous; /**< The block allocated before this one. */
+  size_t capacity;             /**< Usable bytes in `data`. */
+  size_t used;                 /**< Bytes of `data` already handed out. */
+  max_align_t data[];          /**< Storage, aligned for any type. */
+} ArenaBlock;
+
+/**
+ * @struct Arena
+ * @brief A bump allocator made of a chain of blocks.
+ *
+ * Blocks grow geometrically, so an arena holding N bytes owns O(log N)
+ * blocks and freeing it never visits the individual allocations.
+ */
+typedef struct {
+  ArenaBlock *current; /**< The block allocations are currently carved from. */
+  size_t allocated;    /**< Total bytes requested from the system. */
+} Arena;
+
+/**
+ * @brief Initializes an empty arena.
+ *
+ * No memory is requested until the first allocation.
+ *
+ * @param arena A pointer to the Arena to initialize.
+ */
+void init_arena(Arena *arena);
+
+/**
+ * @brief Releases every block owned by the arena.
+ *
+ * All pointers previously returned by the arena become invalid. The arena is
+ * left empty and can be reused.
+ *
+ * @param arena A pointer to the Arena to free.
+ */
+void free_arena(Arena *arena);
+
+/**
+ * @brief Allocates memory from the arena.
+ *
+ * The returned memory is uninitialized and suitably aligned for any type.
+ *
+ * @param arena A pointer to the Arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return A pointer to the memory, or NULL if the system is out of memory.
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Copies a string into the arena.
+ *
+ * @param arena A pointer to the Arena to allocate from.
+ * @param text The characters to copy. They do not need to be NUL-terminated.
+ * @param length The number of characters to copy.
+ * @return A NUL-terminated copy of the text, or NULL if the system is out of
+ * memory.
+ */
+char *arena_strndup(Arena *arena, const char *text, size_t length);
+
+#endif // CIJS_ARENA_H_
@@ -1,9 +1,15 @@
 #ifndef CIJS_AST_H
 #define CIJS_AST_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
+#include "arena.h"
+#include "diagnostic.h"
 #import "lexer.h"
+#include "token_array.h"
+#include "value.h"
 
 /*
  * @file ast.h
@@ -73,39 +79,190 @@ typedef enum {
    * - Boolean literals: `true`, `false`
    */
   NODE_LITERAL,
+
+  /**
+   * @brief Represents a binary expression such as `a + 1`.
+   *
+   * The node has two children, the left and the right operand. Binary
+   * operators are left-associative: `a - b - c` is `(a - b) - c`. Operations
+   * on literals are folded into a literal while parsing.
+   */
+  NODE_BINARY_EXPRESSION,
+
+  /**
+   * @brief Represents a unary expression such as `-a` or `!a`.
+   *
+   * The node has one child, the operand.
+   */
+  NODE_UNARY_EXPRESSION,
+
+  /**
+   * @brief Represents an assignment such as `a = 1`.
+   *
+   * The node has two children, the identifier or member expression assigned
+   * to and the assigned expression. Assignments are right-associative:
+   * `a = b = 1` is `a = (b = 1)`.
+   */
+  NODE_ASSIGNMENT_EXPRESSION,
+
+  /**
+   * @brief Represents an expression evaluated as a statement, such as
+   * `a = 1;`.
+   *
+   * The node has one child, the expression.
+   */
+  NODE_EXPRESSION_STATEMENT,
+
+  /**
+   * @brief Represents an object literal such as `{x: 1, y: a}`.
+   *
+   * The node's children are its properties, in source order.
+   */
+  NODE_OBJECT_LITERAL,
+
+  /**
+   * @brief Represents a property of an object literal, such as `x: 1`.
+   *
+   * The node holds the name of the property and has one child, its value.
+   */
+  NODE_PROPERTY,
+
+  /**
+   * @brief Represents a property access such as `a.x`.
+   *
+   * The node holds the name of the property and has one child, the object
+   * accessed. It can be assigned to.
+   */
+  NODE_MEMBER_EXPRESSION,
+
+  /**
+   * @brief Represents a function declaration such as `function f(a, b) {}`.
+   *
+   * The node's children are the parameters, as identifier nodes, followed by
+   * the body of the function as its last child.
+   */
+  NODE_FUNCTION_DECLARATION,
+
+  /**
+   * @brief Represents the body of a function.
+   *
+   * The node's children are the statements of the body. A body that was only
+   * pre-parsed has no children yet: it records the tokens it spans, and its
+   * statements are built by `ast_parse_function_body`.
+   */
+  NODE_FUNCTION_BODY,
 } ASTNodeType;
 
 /**
  * @brief Represents a variable declaration in an Abstract Syntax Tree (AST).
  *
- * The `name` field stores the variable name, and `value` stores the assigned
- * expression. If the declaration does not include an assignment, `value` may be
- * NULL.
+ * The `atom` field identifies the variable name in the AST's atom table and
+ * `name` is the text of that atom, shared by every node using the name. The
+ * assigned expression, if the declaration includes one, is stored as the
+ * node's only child; a `const` declaration always has one. `slot` is set by
+ * `resolve_program`.
  */
 typedef struct {
-  char *name; /**< Name of the variable being declared. */
+  const char *name; /**< Name of the variable being declared. */
+  Atom atom;        /**< Interned name of the variable. */
+  uint32_t slot;    /**< Index of the variable in its function's frame. */
+  bool constant;    /**< Whether the variable was declared with `const`. */
 } ASTVariableDeclarationNode;
 
 /**
  * @brief Represents an identifier in an Abstract Syntax Tree (AST).
  *
- * The `value` field stores the name of the identifier as a string (e.g.,
- * variable or function name).
+ * The `atom` field identifies the name in the AST's atom table, so two
+ * identifiers refer to the same name exactly when their atoms are equal. The
+ * `value` field is the text of that atom (e.g., variable or function name).
+ *
+ * `resolve_program` sets `depth` and `slot` to where the variable lives: in
+ * slot `slot` of the frame of the function `depth` levels out from the one
+ * using it, the program being the outermost function. Identifiers that match
+ * no declaration refer to globals and get depth `AST_SCOPE_GLOBAL`.
  */
 typedef struct {
-  char *value; /**< Name of the identifier as a string. */
+  const char *value; /**< Name of the identifier as a string. */
+  Atom atom;         /**< Interned name of the identifier. */
+  uint32_t depth;    /**< Functions between the use and the declaration. */
+  uint32_t slot;     /**< Index of the variable in the frame declaring it. */
 } ASTIdentifierNode;
 
 /**
  * @brief Represents a literal in an Abstract Syntax Tree (AST).
  *
- * The `value` field stores the name of the literal as a string (e.g., the value
- * of a string).
+ * The `value` field stores the runtime value of the literal, folded from its
+ * text once while parsing.
  */
 typedef struct {
-  char *value; /**< Value of the literal as a string. */
+  Value value; /**< Value of the literal. */
 } ASTLiteralNode;
 
+/**
+ * @brief Represents a binary expression in an Abstract Syntax Tree (AST).
+ *
+ * The `operator` field stores the token of the operator (e.g., `TOKEN_PLUS`).
+ */
+typedef struct {
+  TokenType operator; /**< The operator applied to the two children. */
+} ASTBinaryExpressionNode;
+
+/**
+ * @brief Represents a unary expression in an Abstract Syntax Tree (AST).
+ *
+ * The `operator` field stores the token of the operator (e.g., `TOKEN_MINUS`).
+ */
+typedef struct {
+  TokenType operator; /**< The operator applied to the child. */
+} ASTUnaryExpressionNode;
+
+/**
+ * @brief Represents a property name in an Abstract Syntax Tree (AST), for
+ * property and member expression nodes.
+ *
+ * The `atom` field identifies the name in the AST's atom table and `name` is
+ * the text of that atom.
+ */
+typedef struct {
+  const char *name; /**< Name of the property. */
+  Atom atom;        /**< Interned name of the property. */
+} ASTPropertyNode;
+
+/**
+ * @brief Represents a function declaration in an Abstract Syntax Tree (AST).
+ *
+ * The `atom` field identifies the function name in the AST's atom table and
+ * `name` is the text of that atom. `slot` and `slot_count` are set by
+ * `resolve_program`; the parameters take the first slots of the frame.
+ */
+typedef struct {
+  const char *name;    /**< Name of the function being declared. */
+  Atom atom;           /**< Interned name of the function. */
+  uint32_t slot;       /**< Index of the function in the enclosing frame. */
+  uint32_t slot_count; /**< Number of variables of the function's frame. */
+} ASTFunctionDeclarationNode;
+
+/**
+ * @brief Represents the body of a function in an Abstract Syntax Tree (AST).
+ *
+ * `first` and `end` are the indices of the tokens following the opening brace
+ * and of the closing brace, when the function was parsed from a token array.
+ */
+typedef struct {
+  size_t first; /**< Index of the first token of the body. */
+  size_t end;   /**< Index of the closing brace of the body. */
+  bool parsed;  /**< Whether the statements of the body were built. */
+} ASTFunctionBodyNode;
+
+/**
+ * @brief Represents the scope of a whole program in an Abstract Syntax Tree
+ * (AST), for the source file node.
+ */
+typedef struct {
+  uint32_t slot_count; /**< Number of top-level variables and functions. */
+  bool resolved;       /**< Whether `resolve_program` ran on the tree. */
+} ASTScopeNode;
+
 /**
  * @brief Represents the data of a node in an Abstract Syntax Tree (AST).
  *
@@ -115,11 +272,29 @@ typedef struct {
  * value.
  */
 typedef union {
+  ASTScopeNode scope; /**< Data for the source file node. */
   ASTVariableDeclarationNode declaration;
   ASTIdentifierNode identifier; /**< Data for an identifier node. */
   ASTLiteralNode literal;       /**< Data for a literal node. */
+  ASTBinaryExpressionNode binary; /**< Data for a binary expression node. */
+  ASTUnaryExpressionNode unary;   /**< Data for a unary expression node. */
+  ASTPropertyNode property;       /**< Data for property and member nodes. */
+  ASTFunctionDeclarationNode function; /**< Data for a function node. */
+  ASTFunctionBodyNode body;            /**< Data for a function body node. */
 } ASTNodeData;
 
+/**
+ * @brief Depth of an identifier that refers to a global.
+ */
+#define AST_SCOPE_GLOBAL UINT32_MAX
+
+/**
+ * @brief Largest number of function bodies nested in each other. Every
+ * nested body is parsed on the call stack, so a deeper function is reported
+ * as `DIAGNOSTIC_NESTING_TOO_DEEP` instead of overflowing it.
+ */
+#define AST_MAX_FUNCTION_DEPTH 256
+
 /**
  * @brief Represents a single node in an Abstract Syntax Tree (AST).
  *
@@ -128,41 +303,125 @@ typedef union {
  * identifier, literal, operator, etc.).
  * - Data (`ASTNodeData`), which holds the node's specific content, like an
  * identifier or a literal.
- * - A placeholder for child nodes (`children`), which will be implemented later
- * as a dynamic array.
+ * - Its child nodes (`children`), stored by value in one contiguous block
+ * allocated from the AST's arena.
  */
 typedef struct ASTNode {
   ASTNodeType
       type; /**< The type of the AST node (e.g., identifier, literal, etc.). */
   ASTNodeData data; /**< The content of the node (e.g., identifier name, literal
                        value). */
-  struct ASTNode **children;
-  size_t children_count;
+  struct ASTNode *children; /**< The node's children, in source order. */
+  size_t children_count;    /**< Number of nodes in `children`. */
 } ASTNode;
 
+/**
+ * @struct ASTTokenRange
+ * @brief The tokens `[first, end)` of a top-level statement, recorded when
+ * parsing from a token array so that the statement can be reused after an
+ * edit.
+ */
+typedef struct {
+  size_t first; /**< Index of the first token of the statement. */
+  size_t end;   /**< Index of the token following the statement. */
+} ASTTokenRange;
+
+/**
+ * @struct ASTOperator
+ * @brief An operator waiting for its right operand while an expression is
+ * parsed, or an open group: a parenthesis, an object literal (`{`) or a
+ * property waiting for its value (`:`).
+ */
+typedef struct {
+  TokenType operator; /**< The token of the operator. */
+  uint8_t power;      /**< How tightly the operator binds its right operand;
+                         0 for a group. */
+  bool prefix;        /**< Whether the operator is a unary prefix one. */
+  size_t offset;      /**< Offset of the operator in the source, for errors. */
+  size_t base;        /**< For an object literal, the number of pending nodes
+                         below its properties. */
+} ASTOperator;
+
 /**
  * @brief Represents an Abstract Syntax Tree (AST) for a program.
  *
  * The AST contains:
- * - A `Lexer` for tokenizing the source code (used during parsing).
+ * - Either a `Lexer` tokenizing the source code on demand while parsing, or a
+ * `TokenArray` holding every token of a contiguous source, lexed ahead of
+ * parsing, with a `TokenCursor` reading it.
+ * - An `Arena` owning every node and child array of the tree.
+ * - An `AtomTable` holding every name of the tree once.
+ * - A pending stack where the children of the nodes being parsed are
+ * collected before being moved into their parent's contiguous child block,
+ * and an operator stack holding the operators of the expression being parsed,
+ * so that expressions of any depth are parsed without recursion.
  * - A `root` node, which is the top-level node of the tree and acts as the
  * entry point for the AST structure.
+ * - The syntax errors of the program, in source order. A statement with an
+ * error is left out of the tree and parsing goes on after it, so a single
+ * parse reports every broken statement.
  */
 typedef struct {
-  Lexer *lexer; /**< The lexer used for tokenizing input. */
-  ASTNode root; /**< The root node of the AST. */
+  Lexer *lexer;               /**< The lexer used for tokenizing input, NULL
+                                when the tokens were lexed ahead. */
+  TokenArray tokens;          /**< The tokens lexed ahead of parsing. */
+  TokenCursor cursor;         /**< The next token of `tokens` to parse. */
+  ASTTokenRange *ranges;      /**< Tokens of each top-level statement, when
+                                parsing from `tokens`. */
+  size_t range_count;         /**< Number of ranges in `ranges`. */
+  size_t range_capacity;      /**< Number of ranges `ranges` can hold. */
+  size_t stop;                /**< Index of the token that ended the program,
+                                or that started the first statement with an
+                                error. */
+  bool lazy_functions;        /**< Whether the bodies of top-level functions are
+                                only pre-parsed, when parsing from `tokens`. */
+  unsigned function_depth;    /**< Number of function bodies being parsed. */
+  size_t depth;               /**< Number of braces opened and not yet closed
+                                by the tokens read. */
+  double number;              /**< Value of the latest number token read. */
+  LexerToken last_token;      /**< The latest token read. */
+  size_t previous_end;        /**< End of the text of the token read before
+                                `last_token`. */
+  Arena arena;                /**< Memory for the nodes of the tree. */
+  AtomTable atoms;            /**< Names of the identifiers of the tree. */
+  ASTNode *pending;           /**< Children of nodes still being parsed. */
+  size_t pending_count;       /**< Number of nodes on the pending stack. */
+  size_t pending_capacity;    /**< Number of nodes the pending stack can
+                                hold. */
+  ASTOperator *operators;     /**< Operators of the expression being parsed. */
+  size_t operator_count;      /**< Number of operators on the operator stack. */
+  size_t operator_capacity;   /**< Number of operators the stack can hold. */
+  ASTNode root;               /**< The root node of the AST. */
+  DiagnosticList diagnostics; /**< Syntax errors of the program. */
+  DiagnosticList body_diagnostics; /**< Syntax errors of the body last built
+                                     by `ast_parse_function_body`. */
 } AST;
 
 /**
  * @brief Enum representing possible errors during AST initialization.
  */
 typedef enum {
-  AST_INIT_OK = 0,           /**< No error, initialization successful. */
-  AST_INIT_ERROR_NULL_PTR,   /**< The `ast` or `source` parameter was NULL. */
-  AST_INIT_ERROR_LEXER_FAIL, /**< Failed to initialize the lexer. */
-  AST_INIT_ERROR_MEMORY_FAIL /**< Memory allocation failure. */
+  AST_INIT_OK = 0,             /**< No error, initialization successful. */
+  AST_INIT_ERROR_NULL_PTR,     /**< The `ast` or `source` parameter was
+                                  NULL. */
+  AST_INIT_ERROR_LEXER_FAIL,   /**< Failed to initialize the lexer. */
+  AST_INIT_ERROR_MEMORY_FAIL,  /**< Memory allocation failure. */
+  AST_INIT_ERROR_TOKEN_TOO_LONG /**< A token is longer than
+                                   `TOKENIZER_MAX_TOKEN_LENGTH`. */
 } ASTInitError;
 
+/**
+ * @brief Enum representing possible errors when building a pre-parsed
+ * function body.
+ */
+typedef enum {
+  AST_BODY_OK = 0,        /**< No error, the body is built. */
+  AST_BODY_ERROR_INVALID, /**< Not a function, or a body without tokens. */
+  AST_BODY_ERROR_SYNTAX,  /**< The body has syntax errors, which are in
+                             `body_diagnostics`. */
+  AST_BODY_ERROR_MEMORY   /**< Memory allocation failure. */
+} ASTBodyError;
+
 /**
  * @brief Initializes an Abstract Syntax Tree (AST) with a lexer for the given
  * source.
@@ -175,12 +434,36 @@ typedef enum {
  */
 ASTInitError init_ast(AST *ast, const char *source);
 
+/**
+ * @brief Initializes an Abstract Syntax Tree (AST) over a contiguous or
+ * streamed source.
+ *
+ * @param ast A pointer to the AST structure to initialize.
+ * @param source The source to be parsed.
+ */
+ASTInitError init_ast_source(AST *ast, const Source *source);
+
+/**
+ * @brief Initializes an Abstract Syntax Tree (AST) over a contiguous source
+ * that is lexed into a token array before parsing starts.
+ *
+ * The parser then reads the tokens by index instead of driving the lexer,
+ * which gives it cheap lookahead and backtracking.
+ *
+ * @param ast A pointer to the AST structure to initialize.
+ * @param source The source to be parsed. It must be contiguous and outlive the
+ * AST.
+ * @param options The settings of a parallel lexer, or NULL to lex on the
+ * calling thread.
+ */
+ASTInitError init_ast_tokens(AST *ast, const Source *source,
+                             const ParallelLexOptions *options);
+
 /**
  * @brief frees resources used by the ast.
  *
- * cleans up the ast structure, including the lexer and any dynamically
- * allocated memory. note: this assumes `create_lexer` dynamically allocates
- * memory for the lexer.
+ * cleans up the ast structure, including the lexer and every node produced by
+ * `ast_parse_program`, which are released in bulk with the ast's arena.
  *
  * @param ast a pointer to the ast structure to free.
  */
@@ -190,19 +473,71 @@ void free_ast(AST *ast);
  * @brief Parses the program and constructs an AST.
  *
  * This function processes the given AST structure, parsing the input
- * and returning the root node of the AST. The caller is responsible
- * for freeing the returned ASTNode when it is no longer needed.
+ * and returning the root node of the AST. The returned node is owned by the
+ * AST and is released together with it by `free_ast`.
+ *
+ * A statement with a syntax error is recorded in `ast->diagnostics` and left
+ * out of the tree, and parsing resumes at the next `let`, `const` or
+ * `function` keyword after the error.
  *
  * @param ast A pointer to the AST structure used for parsing.
- * @return A pointer to the root ASTNode of the parsed program.
+ * @return A pointer to the root ASTNode of the parsed program, or NULL if
+ * memory ran out, including for the window of a streamed source.
  */
 ASTNode *ast_parse_program(AST *ast);
 
+/**
+ * @brief Updates a program after an edit of its source.
+ *
+ * Only the tokens around the edit are lexed again, and only the top-level
+ * statements they belong to are parsed again: the statements before the edit
+ * and, once the parser is back in step with the old tokens, those after it are
+ * kept as they are. The result is the tree, and the diagnostics,
+ * `ast_parse_program` would build from the new source.
+ *
+ * @param ast An AST initialized with `init_ast_tokens` whose program was
+ * parsed or reparsed.
+ * @param program The root returned by the last parse, updated in place.
+ * @param source The edited source, which replaces the previous one and must
+ * outlive the AST.
+ * @param edit The edit turning the previous source into `source`.
+ * @return `program`, or NULL if the AST was not parsed from tokens, the edit
+ * does not match the sources, a token of the edited source is too long or
+ * memory ran out. The previous tree is left unchanged in the first three
+ * cases.
+ */
+ASTNode *ast_reparse(AST *ast, ASTNode *program, const Source *source,
+                     const SourceEdit *edit);
+
+/**
+ * @brief Builds the statements of a pre-parsed function body.
+ *
+ * With `lazy_functions` set, the body of a top-level function is only
+ * pre-parsed while parsing the program, and its tokens are recorded.
+ * Pre-parsing rejects the errors two neighbouring tokens show: unknown tokens,
+ * keywords the parser does not support, unbalanced parentheses and braces, a
+ * missing name after `let`, `const`, `function` or `.`, and a missing operand
+ * after an operator, `=`, `:` or `(`. Every other syntax error, such as a
+ * constant without a value or a malformed object literal, is deferred to this
+ * function, which builds the statements of the body, typically when the
+ * function is first called. Functions nested in the body are parsed in full.
+ *
+ * The errors found in the body are recorded in `ast->body_diagnostics`, which
+ * is emptied first, and not in `ast->diagnostics`, which describe the program
+ * as parsed.
+ *
+ * @param ast The AST the function was parsed with.
+ * @param function A `NODE_FUNCTION_DECLARATION` node of the AST's program.
+ * @return `AST_BODY_OK` if the body is built, or the error that prevented it.
+ */
+ASTBodyError ast_parse_function_body(AST *ast, ASTNode *function);
+
 /**
  * @brief Parses a statement and creates the corresponding AST node.
  *
- * This function takes a lexer token and creates an AST node based on the type
- * of the token.
+ * This function takes the lexer token starting a statement, consumes the rest
+ * of the statement from the lexer and creates an AST node based on the type of
+ * the token.
  *
  * @param ast A pointer to the AST structure.
  * @param token The lexer token representing the statement.
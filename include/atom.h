@@ -0,0 +1,93 @@
+#ifndef CIJS_ATOM_H_
+#define CIJS_ATOM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+/**
+ * @file atom.h
+ * @brief Interning of names into small integer atoms.
+ *
+ * An atom table stores every distinct name once and identifies it by a dense
+ * integer id. Two names are equal exactly when their atoms are, so names are
+ * compared with one integer comparison and can index arrays directly.
+ */
+
+/**
+ * @brief The id of an interned name. Ids are dense, starting at 0, in order of
+ * first appearance.
+ */
+typedef uint32_t Atom;
+
+/**
+ * @brief The atom returned when a name could not be interned.
+ */
+#define ATOM_INVALID UINT32_MAX
+
+/**
+ * @struct AtomEntry
+ * @brief A name held by an atom table.
+ */
+typedef struct {
+  const char *text; /**< The NUL-terminated name, owned by the table. */
+  uint32_t length;  /**< Number of bytes in `text`. */
+  uint32_t hash;    /**< Hash of `text`. */
+} AtomEntry;
+
+/**
+ * @struct AtomTable
+ * @brief A hash table from names to atoms.
+ *
+ * Names are stored once in the table's arena. `slots` is an open-addressing
+ * index into `entries`, kept at most half full.
+ */
+typedef struct {
+  Arena arena;         /**< Memory for the names. */
+  AtomEntry *entries;  /**< Names by atom. */
+  uint32_t count;      /**< Number of atoms in `entries`. */
+  uint32_t capacity;   /**< Number of atoms `entries` can hold. */
+  uint32_t *slots;     /**< Atom + 1 for used slots, 0 for empty ones. */
+  uint32_t slot_count; /**< Number of slots, a power of two. */
+} AtomTable;
+
+/**
+ * @brief Initializes an empty atom table.
+ *
+ * @param table A pointer to the AtomTable to initialize.
+ */
+void init_atom_table(AtomTable *table);
+
+/**
+ * @brief Releases every name held by an atom table.
+ *
+ * @param table A pointer to the AtomTable to free. The AtomTable structure
+ * itself is not freed.
+ */
+void free_atom_table(AtomTable *table);
+
+/**
+ * @brief Returns the atom of a name, adding the name to the table if needed.
+ *
+ * @param table A pointer to the AtomTable.
+ * @param text The name. It does not need to be NUL-terminated.
+ * @param length The number of bytes in `text`.
+ * @return The atom of the name, or `ATOM_INVALID` if the system is out of
+ * memory.
+ */
+Atom atom_intern(AtomTable *table, const char *text, size_t length);
+
+/**
+ * @brief Returns the NUL-terminated name of an atom.
+ *
+ * The name stays valid for as long as the table does.
+ *
+ * @param table A pointer to the AtomTable that returned the atom.
+ * @param atom The atom.
+ */
+static inline const char *atom_text(const AtomTable *table, Atom atom) {
+  return table->entries[atom].text;
+}
+
+#endif // CIJS_ATOM_H_
@@ -0,0 +1,103 @@
+#ifndef CIJS_BATCH_H_
+#define CIJS_BATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ast.h"
+#include "cache.h"
+
+/**
+ * @file batch.h
+ * @brief Parses many files at once across a pool of threads.
+ *
+ * Files are independent: each one gets its own source, lexer, atom table and
+ * arena, so workers share nothing but the queue of files. Every worker starts
+ * on its own contiguous share of the files and, once done, steals files from
+ * the shares of the others, so a few large files do not leave the other
+ * threads idle. Results are stored by input position, which makes them
+ * independent of scheduling. If a thread cannot be started, the others take
+ * over its share.
+ */
+
+/**
+ * @brief The outcome of parsing one file.
+ */
+typedef enum {
+  PARSE_FILE_OK = 0,      /**< The file was loaded and parsed. */
+  PARSE_FILE_ERROR_LOAD,  /**< The file could not be opened or read. */
+  PARSE_FILE_ERROR_INIT,  /**< The AST could not be initialized. */
+  PARSE_FILE_ERROR_MEMORY /**< Memory ran out while parsing. */
+} ParseFileStatus;
+
+/**
+ * @struct ParsedFile
+ * @brief One file of a batch and, once parsed, its tree.
+ *
+ * Only `path` is set by the caller; every other field is filled by
+ * `parse_files` and released by `free_parsed_file`.
+ */
+typedef struct {
+  const char *path;       /**< The path of the file to parse. */
+  ParseFileStatus status; /**< Whether the file was parsed. */
+  int error;              /**< The `SourceOpenError` or `ASTInitError` code
+                             behind a failed status, 0 otherwise. */
+  Source source;          /**< The contents of the file. */
+  AST ast;                /**< The tree, which owns its nodes and names. */
+  CachedProgram cached;   /**< The tree and bytecode found in the cache, if
+                             any; `cached.mapping` is NULL on a miss. */
+  ASTNode *program;       /**< The root of the tree, from `ast` or `cached`,
+                             NULL for an empty file or on failure. */
+  long tokens;            /**< Number of tokens, when measured. */
+  double load_seconds;    /**< Time spent loading the file. */
+  double lex_seconds;     /**< Time spent lexing the file, when measured. */
+  double parse_seconds;   /**< Time spent parsing the file. */
+} ParsedFile;
+
+/**
+ * @struct BatchOptions
+ * @brief Settings of `parse_files`.
+ */
+typedef struct {
+  unsigned threads; /**< Number of threads, 0 for one per online CPU. */
+  bool measure;     /**< Also lex every file on its own, so that lexing is
+                       timed and its tokens counted apart from parsing. */
+  const char *cache_directory; /**< Directory looked up for cached trees
+                                  before parsing, NULL for none. */
+} BatchOptions;
+
+/**
+ * @brief Enum representing possible errors of a batch as a whole.
+ *
+ * Errors of individual files are reported in their `ParsedFile`.
+ */
+typedef enum {
+  BATCH_OK = 0,         /**< Every file was processed. */
+  BATCH_ERROR_NULL_PTR, /**< A NULL pointer was passed to the function. */
+  BATCH_ERROR_MEMORY_ALLOCATION /**< The workers could not be allocated. */
+} BatchError;
+
+/**
+ * @brief Loads and parses a batch of files in parallel.
+ *
+ * @param files The files to parse, with their `path` set.
+ * @param count The number of files.
+ * @param options The settings of the batch, or NULL for the defaults.
+ * @return A `BatchError` code. On `BATCH_OK` every file has a status.
+ */
+BatchError parse_files(ParsedFile *files, size_t count,
+                       const BatchOptions *options);
+
+/**
+ * @brief Releases the tree and the source of a parsed file.
+ *
+ * @param file A pointer to the ParsedFile to free.
+ */
+void free_parsed_file(ParsedFile *file);
+
+/**
+ * @brief Returns the number of online CPUs, at least 1.
+ */
+unsigned batch_default_threads(void);
+
+#endif // CIJS_BATCH_H_
@@ -0,0 +1,165 @@
+#ifndef CIJS_BYTECODE_H_
+#define CIJS_BYTECODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "value.h"
+
+/**
+ * @file bytecode.h
+ * @brief Defines the register-based bytecode executed by the CIJS VM.
+ *
+ * Code is a flat array of 32-bit words. Every instruction is an opcode word
+ * followed by its operands, one word each. Operands name registers or entries
+ * of the constant pool, so instructions read and write registers directly
+ * instead of going through a stack.
+ */
+
+/**
+ * @brief The instructions of the VM.
+ *
+ * Operands are listed in the order they follow the opcode. `dst`, `src`,
+ * `object`, `left` and `right` are registers, `constant` is an index in the
+ * constant pool, `property` an index in the property table and `cache` the
+ * index of the inline cache of the instruction.
+ */
+typedef enum {
+  OP_LOAD_CONSTANT,  /**< dst, constant: dst = constants[constant]. */
+  OP_LOAD_UNDEFINED, /**< dst: dst = undefined. */
+  OP_MOVE,           /**< dst, src: dst = src. */
+  OP_ADD,            /**< dst, left, right: dst = left + right. */
+  OP_SUBTRACT,       /**< dst, left, right: dst = left - right. */
+  OP_MULTIPLY,       /**< dst, left, right: dst = left * right. */
+  OP_DIVIDE,         /**< dst, left, right: dst = left / right. */
+  OP_MODULO,         /**< dst, left, right: dst = left % right. */
+  OP_NEGATE,         /**< dst, src: dst = -src. */
+  OP_TO_NUMBER,      /**< dst, src: dst = +src. */
+  OP_NOT,            /**< dst, src: dst = !src. */
+  OP_NEW_OBJECT,     /**< dst: dst = {}. */
+  OP_GET_PROPERTY,   /**< dst, object, property, cache:
+                          dst = object.property. */
+  OP_SET_PROPERTY,   /**< object, property, src, cache:
+                          object.property = src. */
+  OP_HALT,           /**< Stops the execution. */
+  OP_COUNT           /**< Number of opcodes, not an instruction. */
+} Opcode;
+
+/**
+ * @brief Number of operand words following each opcode.
+ */
+extern const uint8_t opcode_operand_counts[OP_COUNT];
+
+/**
+ * @brief Largest number of operands of an instruction.
+ */
+#define OPCODE_MAX_OPERANDS 4
+
+/**
+ * @brief What the operands of instructions refer to.
+ */
+typedef enum {
+  OPERAND_REGISTER, /**< A register. */
+  OPERAND_CONSTANT, /**< An entry of the constant pool. */
+  OPERAND_PROPERTY, /**< An entry of the property table. */
+  OPERAND_CACHE     /**< An inline cache. */
+} OperandKind;
+
+/**
+ * @brief Kind of each operand of each opcode.
+ */
+extern const uint8_t opcode_operand_kinds[OP_COUNT][OPCODE_MAX_OPERANDS];
+
+/**
+ * @struct Chunk
+ * @brief A compiled program.
+ *
+ * Top-level variables are numbered in declaration order and variable `i`
+ * always lives in register `i`. Registers past the variables hold
+ * temporaries. Property names are numbered in order of first use, and every
+ * property access has an inline cache of its own, numbered in code order.
+ */
+typedef struct {
+  uint32_t *code;           /**< Instruction words. */
+  size_t code_count;        /**< Number of words in `code`. */
+  size_t code_capacity;     /**< Number of words `code` can hold. */
+  Value *constants;         /**< Constant pool. */
+  size_t constant_count;    /**< Number of values in `constants`. */
+  size_t constant_capacity; /**< Number of values `constants` can hold. */
+  char **variables;         /**< Names of the variables, owned by `arena`. */
+  size_t variable_count;    /**< Number of names in `variables`. */
+  size_t variable_capacity; /**< Number of names `variables` can hold. */
+  char **properties;        /**< Names of the properties, owned by `arena`. */
+  size_t property_count;    /**< Number of names in `properties`. */
+  size_t property_capacity; /**< Number of names `properties` can hold. */
+  uint32_t register_count;  /**< Registers needed to run the chunk. */
+  uint32_t cache_count;     /**< Inline caches needed to run the chunk. */
+  uint64_t serial;          /**< Identifies the chunk among all chunks
+                               initialized by the process. */
+  Arena arena;              /**< Memory for the variable and property
+                               names. */
+} Chunk;
+
+/**
+ * @brief Initializes an empty chunk with a new serial.
+ *
+ * @param chunk A pointer to the Chunk to initialize.
+ */
+void init_chunk(Chunk *chunk);
+
+/**
+ * @brief Releases the memory owned by a chunk.
+ *
+ * @param chunk A pointer to the Chunk to free. The Chunk structure itself is
+ * not freed.
+ */
+void free_chunk(Chunk *chunk);
+
+/**
+ * @brief Appends a word to the code of a chunk.
+ *
+ * @param chunk A pointer to the Chunk to append to.
+ * @param word The opcode or operand to append.
+ * @return 1 on success, 0 if the code could not be grown.
+ */
+int chunk_write(Chunk *chunk, uint32_t word);
+
+/**
+ * @brief Appends a value to the constant pool of a chunk.
+ *
+ * @param chunk A pointer to the Chunk to append to.
+ * @param value The constant to append.
+ * @param index Where the index of the constant is stored.
+ * @return 1 on success, 0 if the pool could not be grown.
+ */
+int chunk_add_constant(Chunk *chunk, Value value, uint32_t *index);
+
+/**
+ * @brief Records the name of the next variable of a chunk.
+ *
+ * @param chunk A pointer to the Chunk to append to.
+ * @param name The name of the variable. It is copied into the chunk.
+ * @param index Where the index, and register, of the variable is stored.
+ * @return 1 on success, 0 if the name could not be stored.
+ */
+int chunk_add_variable(Chunk *chunk, const char *name, uint32_t *index);
+
+/**
+ * @brief Records the name of the next property of a chunk.
+ *
+ * @param chunk A pointer to the Chunk to append to.
+ * @param name The name of the property. It is copied into the chunk.
+ * @param index Where the index of the property is stored.
+ * @return 1 on success, 0 if the name could not be stored.
+ */
+int chunk_add_property(Chunk *chunk, const char *name, uint32_t *index);
+
+/**
+ * @brief Prints the instructions of a chunk for debugging purposes.
+ *
+ * @param chunk The chunk to print.
+ */
+void chunk_print(const Chunk *chunk);
+
+#endif // CIJS_BYTECODE_H_
@@ -0,0 +1,98 @@
+#ifndef CIJS_CACHE_H_
+#define CIJS_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ast.h"
+#include "bytecode.h"
+
+/**
+ * @file cache.h
+ * @brief Persistent cache of parsed and compiled scripts.
+ *
+ * The tree and the bytecode of a script are written to one file per script in
+ * a cache directory, named after a 64-bit hash of the source. The file holds
+ * no pointers: nodes are stored in pre-order with their number of children,
+ * names are indices into a table of strings, and the bytecode is stored as
+ * is, followed by a copy of the source. On a hit the file is mapped into
+ * memory and validated: its source must match byte for byte, since different
+ * sources may share a hash, and no value may point to an object. The bytecode
+ * is then run straight from the mapping, and only the nodes and the names are
+ * rebuilt, without tokenizing the source again.
+ */
+
+/**
+ * @struct CachedProgram
+ * @brief A script loaded from the cache.
+ *
+ * `chunk` refers to the mapping and to `arena`: it must be run as it is and
+ * never passed to `free_chunk`. Everything is released by
+ * `free_cached_program`.
+ */
+typedef struct {
+  void *mapping;    /**< The mapped cache file, NULL if none. */
+  size_t size;      /**< Number of bytes in `mapping`. */
+  Arena arena;      /**< Memory for the nodes and the variable table. */
+  AtomTable atoms;  /**< Names of the identifiers of the tree. */
+  ASTNode *program; /**< The root of the rebuilt tree. */
+  Chunk chunk;      /**< The bytecode, read from the mapping. */
+} CachedProgram;
+
+/**
+ * @brief Enum representing possible errors of the cache.
+ */
+typedef enum {
+  CACHE_OK = 0,         /**< The operation succeeded. */
+  CACHE_ERROR_NULL_PTR, /**< A NULL pointer was passed to the function. */
+  CACHE_ERROR_MISS,     /**< No cache file exists for the source. */
+  CACHE_ERROR_INVALID,  /**< The cache file is stale, truncated or was written
+                           by another version or kind of machine. */
+  CACHE_ERROR_IO,       /**< The cache file could not be read or written. */
+  CACHE_ERROR_MEMORY_ALLOCATION /**< Memory allocation failed. */
+} CacheError;
+
+/**
+ * @brief Returns the hash under which a source is cached.
+ *
+ * @param data The bytes of the source.
+ * @param length The number of bytes in `data`.
+ */
+uint64_t cache_hash(const char *data, size_t length);
+
+/**
+ * @brief Writes the tree and bytecode of a source to the cache.
+ *
+ * The file is written under a temporary name and renamed into place, so
+ * concurrent readers never see a partial file.
+ *
+ * @param directory The cache directory, which must exist.
+ * @param source The contiguous source the program was parsed from.
+ * @param program The root of the tree of the source.
+ * @param chunk The bytecode compiled from `program`.
+ * @return A `CacheError` code indicating success or failure.
+ */
+CacheError cache_store(const char *directory, const Source *source,
+                       const ASTNode *program, const Chunk *chunk);
+
+/**
+ * @brief Loads the tree and bytecode of a source from the cache.
+ *
+ * @param directory The cache directory.
+ * @param source The contiguous source to look up.
+ * @param cached The CachedProgram to fill. It is zeroed on failure.
+ * @return `CACHE_OK` on a hit, `CACHE_ERROR_MISS` if the source is not
+ * cached, another `CacheError` code otherwise.
+ */
+CacheError cache_load(const char *directory, const Source *source,
+                      CachedProgram *cached);
+
+/**
+ * @brief Releases a program loaded from the cache.
+ *
+ * @param cached A pointer to the CachedProgram to free. A zeroed
+ * CachedProgram is left untouched.
+ */
+void free_cached_program(CachedProgram *cached);
+
+#endif // CIJS_CACHE_H_
@@ -0,0 +1,43 @@
+#ifndef CIJS_COMPILER_H_
+#define CIJS_COMPILER_H_
+
+#include "ast.h"
+#include "bytecode.h"
+#include "resolver.h"
+
+/**
+ * @file compiler.h
+ * @brief Compiles syntax trees into bytecode for the CIJS VM.
+ *
+ * The compiler walks a tree produced by `ast_parse_program` and resolved by
+ * `resolve_program` once, and emits register-based instructions into a
+ * `Chunk`. Every variable lives in the register of its slot, so the VM never
+ * looks names up.
+ */
+
+/**
+ * @brief Enum representing possible errors during compilation.
+ */
+typedef enum {
+  COMPILE_OK = 0,         /**< The program was compiled successfully. */
+  COMPILE_ERROR_NULL_PTR, /**< A NULL pointer was passed to the function. */
+  COMPILE_ERROR_UNSUPPORTED, /**< The tree contains a construct the compiler
+                                does not handle yet. */
+  COMPILE_ERROR_UNDECLARED,  /**< An identifier refers to a variable that is
+                                not declared before it. */
+  COMPILE_ERROR_UNRESOLVED,  /**< The tree was not resolved. */
+  COMPILE_ERROR_MEMORY_ALLOCATION /**< Memory allocation failed. */
+} CompileError;
+
+/**
+ * @brief Compiles a program into a chunk.
+ *
+ * @param program The root node returned by `ast_parse_program`, resolved by
+ * `resolve_program`.
+ * @param chunk An initialized, empty Chunk receiving the bytecode. The chunk
+ * does not reference the tree, which can be freed afterwards.
+ * @return A `CompileError` code indicating success or failure.
+ */
+CompileError compile_program(const ASTNode *program, Chunk *chunk);
+
+#endif // CIJS_COMPILER_H_
@@ -0,0 +1,160 @@
+#ifndef CIJS_DIAGNOSTIC_H_
+#define CIJS_DIAGNOSTIC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file diagnostic.h
+ * @brief Errors found in a source, and where they are.
+ *
+ * A diagnostic only records the byte offset of the offending token. Lines and
+ * columns are computed when a diagnostic is reported, from a table of the
+ * offsets where lines start that is built the first time it is needed, so
+ * neither the tokenizer nor the parser ever counts lines.
+ */
+
+/**
+ * @brief The kinds of errors a diagnostic describes.
+ */
+typedef enum {
+  DIAGNOSTIC_UNKNOWN_TOKEN = 0,       /**< A character that starts no token. */
+  DIAGNOSTIC_EXPECTED_IDENTIFIER,     /**< A name was expected. */
+  DIAGNOSTIC_EXPECTED_EXPRESSION,     /**< An operand was expected. */
+  DIAGNOSTIC_EXPECTED_PROPERTY_NAME,  /**< A property name was expected. */
+  DIAGNOSTIC_EXPECTED_COLON,          /**< `:` after a property name. */
+  DIAGNOSTIC_EXPECTED_COMMA_OR_BRACE, /**< `,` or `}` after a property. */
+  DIAGNOSTIC_EXPECTED_COMMA_OR_PAREN, /**< `,` or `)` after a parameter. */
+  DIAGNOSTIC_EXPECTED_LEFT_PAREN,     /**< `(` after a function name. */
+  DIAGNOSTIC_EXPECTED_RIGHT_PAREN,    /**< `)` closing a parenthesis. */
+  DIAGNOSTIC_EXPECTED_LEFT_BRACE,     /**< `{` opening a function body. */
+  DIAGNOSTIC_EXPECTED_RIGHT_BRACE,    /**< `}` closing a block. */
+  DIAGNOSTIC_MISSING_INITIALIZER,     /**< A constant without a value. */
+  DIAGNOSTIC_INVALID_ASSIGNMENT,      /**< Assignment to a non-variable. */
+  DIAGNOSTIC_UNSUPPORTED_STATEMENT,   /**< A statement the parser lacks. */
+  DIAGNOSTIC_NESTING_TOO_DEEP,        /**< Functions nested past the limit. */
+  DIAGNOSTIC_TOKEN_TOO_LONG           /**< A token too long to be read. */
+} DiagnosticCode;
+
+/**
+ * @struct Diagnostic
+ * @brief An error and the token it was found at, or the empty range where a
+ * missing part belongs.
+ */
+typedef struct {
+  DiagnosticCode code; /**< What went wrong. */
+  size_t offset;       /**< Offset of the offending token in the source. */
+  size_t length;       /**< Number of bytes of the offending token, 0 for a
+                          missing part. */
+} Diagnostic;
+
+/**
+ * @struct DiagnosticList
+ * @brief A growable array of diagnostics, in source order.
+ *
+ * An empty list owns no memory, so keeping one costs nothing until an error
+ * is found.
+ */
+typedef struct {
+  Diagnostic *items; /**< The diagnostics. */
+  size_t count;      /**< Number of diagnostics in `items`. */
+  size_t capacity;   /**< Number of diagnostics `items` can hold. */
+} DiagnosticList;
+
+/**
+ * @struct SourceLocation
+ * @brief A position in a source, for humans.
+ */
+typedef struct {
+  size_t line;   /**< Line number, starting at 1. */
+  size_t column; /**< Byte offset in the line, starting at 1. */
+} SourceLocation;
+
+/**
+ * @struct LineIndex
+ * @brief Maps offsets in a contiguous source to lines and columns.
+ *
+ * The offset where every line starts is collected by a single vectorized scan
+ * for newlines, the first time a location is asked for. Each lookup is then a
+ * binary search in that table. A line ends with `\n`; a `\r` before it counts
+ * as the last byte of the line.
+ */
+typedef struct {
+  const char *data; /**< The source bytes. */
+  size_t length;    /**< Number of bytes in `data`. */
+  size_t *starts;   /**< Offset of the first byte of every line. */
+  size_t count;     /**< Number of lines in `starts`, 0 until built. */
+} LineIndex;
+
+/**
+ * @brief Enum representing possible errors of a line index.
+ */
+typedef enum {
+  LINE_INDEX_OK = 0,             /**< The location was found. */
+  LINE_INDEX_ERROR_NULL_PTR,     /**< A NULL pointer was passed. */
+  LINE_INDEX_ERROR_OUT_OF_RANGE, /**< The offset is past the source. */
+  LINE_INDEX_ERROR_MEMORY_ALLOCATION /**< The table could not be
+                                        allocated. */
+} LineIndexError;
+
+/**
+ * @brief Initializes an empty diagnostic list.
+ *
+ * @param list A pointer to the DiagnosticList to initialize.
+ */
+void init_diagnostic_list(DiagnosticList *list);
+
+/**
+ * @brief Releases the diagnostics of a list.
+ *
+ * @param list A pointer to the DiagnosticList to free. The structure itself is
+ * not freed.
+ */
+void free_diagnostic_list(DiagnosticList *list);
+
+/**
+ * @brief Appends a diagnostic to a list.
+ *
+ * @return 1 on success, 0 if the list could not be grown.
+ */
+int diagnostic_list_add(DiagnosticList *list, DiagnosticCode code,
+                        size_t offset, size_t length);
+
+/**
+ * @brief Returns a description of a kind of error, such as "expected an
+ * expression".
+ */
+const char *diagnostic_message(DiagnosticCode code);
+
+/**
+ * @brief Initializes a line index over a contiguous source, without scanning
+ * it yet.
+ *
+ * @param index A pointer to the LineIndex to initialize.
+ * @param data The source bytes, which must outlive the index.
+ * @param length Number of bytes in `data`.
+ */
+void init_line_index(LineIndex *index, const char *data, size_t length);
+
+/**
+ * @brief Releases the table of a line index.
+ *
+ * @param index A pointer to the LineIndex to free. The structure itself is not
+ * freed.
+ */
+void free_line_index(LineIndex *index);
+
+/**
+ * @brief Finds the line and column of an offset, building the table of line
+ * starts on first use.
+ *
+ * @param index The index of the source.
+ * @param offset An offset in the source; the length of the source is allowed
+ * and refers to its end.
+ * @param location Where the location is stored.
+ * @return A `LineIndexError` code.
+ */
+LineIndexError line_index_locate(LineIndex *index, size_t offset,
+                                 SourceLocation *location);
+
+#endif // CIJS_DIAGNOSTIC_H_
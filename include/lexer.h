@@ -1,6 +1,9 @@
 #ifndef CIJS_LEXER_H_
 #define CIJS_LEXER_H_
 
+#include <stdint.h>
+
+#include "atom.h"
 #include "tokenizer.h"
 
 /**
@@ -24,33 +27,104 @@
  * operators, and more.
  */
 typedef enum {
-  TOKEN_NUMBER, /**< Numeric constant (e.g., 123, 3.14). */
-  TOKEN_LET,    /**< Keyword let. */
-  TOKEN_PLUS,   /**< Symbol "+". */
-  TOKEN_EQUAL,  /**< Symbol "=". */
-  TOKEN_EOF,    /**< Identifies the end of the source code*/
-  TOKEN_UNKNOWN /**< Unrecognized tokens. */
+  TOKEN_NUMBER,     /**< Numeric constant (e.g., 123, 3.14). */
+  TOKEN_IDENTIFIER, /**< Identifier (e.g., variable or function name). */
+
+  /* Reserved words of ECMAScript, plus `let` and `static`. */
+  TOKEN_AWAIT,      /**< Keyword await. */
+  TOKEN_BREAK,      /**< Keyword break. */
+  TOKEN_CASE,       /**< Keyword case. */
+  TOKEN_CATCH,      /**< Keyword catch. */
+  TOKEN_CLASS,      /**< Keyword class. */
+  TOKEN_CONST,      /**< Keyword const. */
+  TOKEN_CONTINUE,   /**< Keyword continue. */
+  TOKEN_DEBUGGER,   /**< Keyword debugger. */
+  TOKEN_DEFAULT,    /**< Keyword default. */
+  TOKEN_DELETE,     /**< Keyword delete. */
+  TOKEN_DO,         /**< Keyword do. */
+  TOKEN_ELSE,       /**< Keyword else. */
+  TOKEN_ENUM,       /**< Keyword enum. */
+  TOKEN_EXPORT,     /**< Keyword export. */
+  TOKEN_EXTENDS,    /**< Keyword extends. */
+  TOKEN_FALSE,      /**< Keyword false. */
+  TOKEN_FINALLY,    /**< Keyword finally. */
+  TOKEN_FOR,        /**< Keyword for. */
+  TOKEN_FUNCTION,   /**< Keyword function. */
+  TOKEN_IF,         /**< Keyword if. */
+  TOKEN_IMPORT,     /**< Keyword import. */
+  TOKEN_IN,         /**< Keyword in. */
+  TOKEN_INSTANCEOF, /**< Keyword instanceof. */
+  TOKEN_LET,        /**< Keyword let. */
+  TOKEN_NEW,        /**< Keyword new. */
+  TOKEN_NULL,       /**< Keyword null. */
+  TOKEN_RETURN,     /**< Keyword return. */
+  TOKEN_STATIC,     /**< Keyword static. */
+  TOKEN_SUPER,      /**< Keyword super. */
+  TOKEN_SWITCH,     /**< Keyword switch. */
+  TOKEN_THIS,       /**< Keyword this. */
+  TOKEN_THROW,      /**< Keyword throw. */
+  TOKEN_TRUE,       /**< Keyword true. */
+  TOKEN_TRY,        /**< Keyword try. */
+  TOKEN_TYPEOF,     /**< Keyword typeof. */
+  TOKEN_VAR,        /**< Keyword var. */
+  TOKEN_VOID,       /**< Keyword void. */
+  TOKEN_WHILE,      /**< Keyword while. */
+  TOKEN_WITH,       /**< Keyword with. */
+  TOKEN_YIELD,      /**< Keyword yield. */
+
+  TOKEN_PLUS,        /**< Symbol "+". */
+  TOKEN_MINUS,       /**< Symbol "-". */
+  TOKEN_STAR,        /**< Symbol "*". */
+  TOKEN_SLASH,       /**< Symbol "/". */
+  TOKEN_PERCENT,     /**< Symbol "%". */
+  TOKEN_BANG,        /**< Symbol "!". */
+  TOKEN_EQUAL,       /**< Symbol "=". */
+  TOKEN_COMMA,       /**< Symbol ",". */
+  TOKEN_DOT,         /**< Symbol ".". */
+  TOKEN_COLON,       /**< Symbol ":". */
+  TOKEN_LEFT_PAREN,  /**< Symbol "(". */
+  TOKEN_RIGHT_PAREN, /**< Symbol ")". */
+  TOKEN_LEFT_BRACE,  /**< Symbol "{". */
+  TOKEN_RIGHT_BRACE, /**< Symbol "}". */
+  TOKEN_EOF,         /**< Identifies the end of the source code*/
+  TOKEN_UNKNOWN      /**< Unrecognized tokens, and malformed numbers. */
 } TokenType;
 
 /**
  * @struct Token
  * @brief Represents a single token identified by the lexer.
  *
- * The Token structure holds the type of the token and its associated value.
- * Tokens are generated by the lexer during lexical analysis.
+ * The Token structure is a compact, 16-byte record holding the type of the
+ * token, a payload and the location of its text in the source code.
+ * Tokens are generated by the lexer during lexical analysis, never own memory
+ * and are cheap to copy, so they are passed and returned by value.
+ *
+ * @var Token::offset
+ * The offset of the token's first byte in the source code. It shares a word
+ * with the type, which leaves 56 bits: more than any address space maps.
  *
  * @var Token::type
  * The type of the token (e.g., NUMBER).
  *
- * @var Token::value
- * The string value of the token. Dynamically allocated and must be freed
- * after use.
+ * @var Token::length
+ * The number of bytes of source code covered by the token. The tokenizer
+ * stops at a token longer than `TOKENIZER_MAX_TOKEN_LENGTH` bytes, so it
+ * always fits.
+ *
+ * @var Token::payload
+ * Type-specific data. For `TOKEN_IDENTIFIER` tokens of a lexer with an atom
+ * table it is the `Atom` of the name. Otherwise it is 0: the value of a
+ * `TOKEN_NUMBER` token is kept by the lexer, see `lexer_number`.
  */
 typedef struct {
-  TokenType type;               /**< The type of the token. */
-  char value[MAX_TOKEN_LENGTH]; /**< The token's associated string value. */
+  uint64_t offset : 56; /**< Offset of the token text in the source. */
+  uint64_t type : 8;    /**< The `TokenType` of the token. */
+  uint32_t length;      /**< Length of the token text in bytes. */
+  uint32_t payload;     /**< Interned id, depending on `type`. */
 } LexerToken;
 
+_Static_assert(sizeof(LexerToken) <= 16, "LexerToken must stay compact");
+
 /**
  * @struct Lexer
  * @brief Represents the lexer used to process source code.
@@ -62,9 +136,19 @@ typedef struct {
  * @var Lexer::tokenizer
  * The underlying tokenizer used by the lexer to split the source code into raw
  * substrings.
+ *
+ * @var Lexer::atoms
+ * The table identifiers are interned into, or NULL to leave them uninterned.
+ * It is set by the owner of the lexer and is not freed by `free_lexer`.
+ *
+ * @var Lexer::number
+ * The value of the latest `TOKEN_NUMBER` token, which does not fit in the
+ * token itself.
  */
 typedef struct {
   Tokenizer *tokenizer; /**< The tokenizer used by the lexer. */
+  AtomTable *atoms;     /**< Table interning identifiers, may be NULL. */
+  double number;        /**< Value of the latest number token. */
 } Lexer;
 
 /**
@@ -90,6 +174,15 @@ typedef enum {
  */
 LexerInitError init_lexer(Lexer *lexer, const char *source);
 
+/**
+ * @brief Initializes the lexer over a contiguous or streamed source.
+ *
+ * @param lexer A pointer to the Lexer structure to initialize.
+ * @param source The source to be analyzed. See `init_tokenizer_source` for the
+ * lifetime requirements of each kind of source.
+ */
+LexerInitError init_lexer_source(Lexer *lexer, const Source *source);
+
 /**
  * Frees the memory allocated for the Lexer and its associated Tokenizer.
  *
@@ -110,11 +203,50 @@ void free_lexer(Lexer *lexer);
  * type.
  *
  * @param lexer A pointer to the initialized Lexer.
- * @param token A pointer to a Token structure where the next token will be
- * stored. The caller is responsible for freeing the token's `value` field.
- * @return 1 if a token was successfully retrieved, 0 if the end of the source
- * code is reached.
+ * @return The next token. Its text can be read from the tokenizer source at
+ * `offset` for `length` bytes. A token of type `TOKEN_EOF` is returned once the
+ * end of the source code is reached, or once an error stopped the lexer; see
+ * `lexer_error`.
  */
 LexerToken next_lexical_token(Lexer *lexer);
 
+/**
+ * @brief Returns the error that ended the tokens of a lexer early.
+ *
+ * A streamed source fails when the window holding its latest token cannot
+ * grow, and any source at a token longer than `TOKENIZER_MAX_TOKEN_LENGTH`.
+ * The `TOKEN_EOF` token that follows does not mark the end of the source
+ * then; after a token that is too long, it is where that token starts.
+ *
+ * @param lexer A pointer to the Lexer.
+ * @return `TOKENIZER_OK` if every token was read so far, the error otherwise.
+ */
+TokenizerError lexer_error(const Lexer *lexer);
+
+/**
+ * Returns a pointer to the source text of a token.
+ *
+ * The text is not NUL-terminated; it is exactly `token.length` bytes long and
+ * remains valid for as long as the lexer's source does. With a streamed source
+ * only the text of the most recent token is guaranteed to be available.
+ *
+ * @param lexer A pointer to the Lexer that produced the token.
+ * @param token The token whose text should be returned.
+ * @return A pointer into the lexer's source code.
+ */
+const char *lexer_token_text(const Lexer *lexer, LexerToken token);
+
+/**
+ * @brief Returns the value of the latest `TOKEN_NUMBER` token of a lexer.
+ *
+ * Decimal, binary (`0b`), octal (`0o`) and hexadecimal (`0x`) literals, with
+ * fractions, exponents and `_` separators, are converted to the nearest double
+ * as they are lexed; literals that are not valid are `TOKEN_UNKNOWN` tokens.
+ * The value is replaced by the next number token the lexer returns.
+ *
+ * @param lexer The Lexer that just returned a token of type `TOKEN_NUMBER`.
+ * @return The value of the literal.
+ */
+double lexer_number(const Lexer *lexer);
+
 #endif // CIJS_LEXER_H_
@@ -0,0 +1,36 @@
+#ifndef CIJS_NUMBER_H_
+#define CIJS_NUMBER_H_
+
+#include <stddef.h>
+
+/**
+ * @file number.h
+ * @brief Conversion of numeric literals to doubles.
+ *
+ * Decimal literals are converted with the Eisel-Lemire algorithm: the first
+ * 19 significant digits are multiplied by a 128-bit approximation of the
+ * power of ten, which is enough to round correctly in all but a few rare
+ * cases. Those, and literals with more digits whose rounding the algorithm
+ * cannot decide, fall back to `strtod`. Binary, octal and hexadecimal
+ * literals are rounded directly from their bits.
+ *
+ * Every result is the double nearest to the literal, ties to even.
+ */
+
+/**
+ * @brief Converts the text of a JavaScript numeric literal to its value.
+ *
+ * Accepted literals are decimal ones such as `42`, `1.5`, `.5`, `1.` and
+ * `6.02e23`, and integers prefixed with `0b`, `0o` or `0x`, in either case.
+ * Digits may be separated by single underscores, as in `1_000_000`. A
+ * decimal integer with a leading zero, such as `017`, is rejected, like in
+ * strict mode.
+ *
+ * @param text The literal, which does not need to be NUL-terminated.
+ * @param length Number of bytes in `text`.
+ * @param value Where the value is stored.
+ * @return 1 if `text` is a numeric literal, 0 otherwise.
+ */
+int parse_number_literal(const char *text, size_t length, double *value);
+
+#endif // CIJS_NUMBER_H_
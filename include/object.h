@@ -0,0 +1,278 @@
+#ifndef CIJS_OBJECT_H_
+#define CIJS_OBJECT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "value.h"
+
+/**
+ * @file object.h
+ * @brief Objects of the CIJS VM and the hidden classes describing them.
+ *
+ * An object does not store the names of its properties. Its values live in an
+ * array of slots, and its shape (or hidden class) tells which property is in
+ * which slot. Shapes form a tree rooted at the empty shape: adding property
+ * `p` to an object of shape `S` moves it to the child of `S` for `p`, created
+ * the first time. Objects whose properties were added in the same order
+ * therefore share one shape, and a property access that saw that shape before
+ * knows the slot to read without looking the name up.
+ *
+ * Property names are indices into the property table of the chunk being run.
+ *
+ * Objects are garbage collected by a generational collector described with
+ * `Heap`.
+ */
+
+/**
+ * @brief Slot returned for a property a shape does not have.
+ */
+#define SHAPE_NO_SLOT UINT32_MAX
+
+/**
+ * @struct Shape
+ * @brief A hidden class: the ordered list of properties of an object.
+ *
+ * A shape adds one property, `name` in slot `slot_count - 1`, to its parent.
+ * Its children are the shapes adding one more property to it.
+ */
+typedef struct Shape {
+  struct Shape *parent;   /**< The shape without the last property, NULL for
+                             the empty shape. */
+  struct Shape *children; /**< First shape adding a property to this one. */
+  struct Shape *sibling;  /**< Next child of `parent`. */
+  uint32_t name;          /**< The property added by this shape. */
+  uint32_t slot_count;    /**< Number of properties of the shape. */
+} Shape;
+
+/**
+ * @brief Generation of an object.
+ */
+typedef enum {
+  OBJECT_YOUNG = 0, /**< Allocated in the nursery since the last collection. */
+  OBJECT_OLD,       /**< Survived a collection, allocated on its own. */
+  OBJECT_FORWARDED  /**< A nursery object copied out by a collection. */
+} ObjectGeneration;
+
+/**
+ * @struct Object
+ * @brief An object: a shape and the values of its properties.
+ *
+ * The slots of a young object are carved from the nursery next to it, unless
+ * the nursery was full when they grew (`external`). An old object owns its
+ * slots. Once a young object has been copied out of the nursery, `forward`
+ * points to the copy.
+ */
+typedef struct Object {
+  Shape *shape; /**< The hidden class of the object. */
+  union {
+    Value *slots;           /**< The value of each property, in shape order. */
+    struct Object *forward; /**< The copy of a forwarded object. */
+  };
+  uint32_t capacity;  /**< Number of values `slots` can hold. */
+  uint8_t generation; /**< An `ObjectGeneration`. */
+  bool marked;        /**< Reached by the current major collection. */
+  bool remembered;    /**< An old object in the remembered set. */
+  bool external;      /**< A young object whose slots were malloc'd. */
+} Object;
+
+/**
+ * @struct ObjectList
+ * @brief A growable array of object pointers.
+ */
+typedef struct {
+  Object **items;  /**< The objects. */
+  size_t count;    /**< Number of objects in `items`. */
+  size_t capacity; /**< Number of objects `items` can hold. */
+} ObjectList;
+
+/**
+ * @struct HeapStats
+ * @brief What the collector did since the heap was initialized.
+ *
+ * Dividing `bytes_allocated` by the running time gives the allocation rate.
+ */
+typedef struct {
+  uint64_t minor_collections; /**< Collections of the nursery. */
+  uint64_t major_collections; /**< Collections of the old generation. */
+  uint64_t bytes_allocated;   /**< Bytes of objects and slots allocated. */
+  uint64_t bytes_promoted;    /**< Bytes copied out of the nursery. */
+  double pause_seconds;       /**< Time spent collecting. */
+  double max_pause_seconds;   /**< Longest single collection. */
+} HeapStats;
+
+/**
+ * @brief Default size of the nursery, in bytes.
+ */
+#define HEAP_NURSERY_SIZE (256 * 1024)
+
+/**
+ * @brief Bytes of old objects below which no major collection runs.
+ */
+#define HEAP_MIN_OLD_LIMIT (1024 * 1024)
+
+/**
+ * @struct Heap
+ * @brief Owns the shapes and the objects of a VM, and collects the objects
+ * that are no longer reachable.
+ *
+ * Objects are allocated by bumping a pointer in the nursery. When it is full,
+ * a minor collection copies the young objects still reachable to the old
+ * generation and empties the nursery, so its cost depends on the survivors
+ * only. Young objects are reachable from the roots, from other survivors,
+ * or from old objects in the remembered set, which the write barrier fills
+ * with every old object a young object is stored into. Once the old
+ * generation has doubled since the last major collection, a major collection
+ * marks the old objects reachable from the roots and frees the others.
+ *
+ * Collections only run when `heap_new_object` finds the nursery full, so any
+ * object pointer held outside the roots must be reloaded after calling it.
+ *
+ * Shapes live as long as the heap, so that inline caches referring to them
+ * stay valid.
+ */
+typedef struct {
+  Arena arena;           /**< Memory for the shapes. */
+  Shape *root;           /**< The empty shape, NULL until needed. */
+  size_t shape_count;    /**< Number of shapes, the empty one included. */
+  char *nursery;         /**< The nursery, NULL until the first object. */
+  size_t nursery_size;   /**< Size of the nursery in bytes. May be changed
+                            before the first object is allocated. */
+  size_t nursery_used;   /**< Bytes of the nursery handed out. */
+  ObjectList old;        /**< Every old object. */
+  ObjectList remembered; /**< Old objects that may refer to young ones. */
+  ObjectList external;   /**< Young objects whose slots were malloc'd. */
+  ObjectList gray;       /**< Objects marked but not yet scanned. */
+  size_t old_bytes;      /**< Bytes of the old objects and their slots. */
+  size_t old_limit;      /**< `old_bytes` triggering a major collection. */
+  Value *roots;          /**< Values keeping objects alive, such as the
+                            registers of a VM. Updated when objects move. */
+  size_t root_count;     /**< Number of values in `roots`. */
+  HeapStats stats;       /**< Statistics of the collector. */
+} Heap;
+
+/**
+ * @brief Initializes an empty heap.
+ *
+ * @param heap A pointer to the Heap to initialize.
+ */
+void init_heap(Heap *heap);
+
+/**
+ * @brief Releases every object and shape of a heap.
+ *
+ * @param heap A pointer to the Heap to free. The Heap structure itself is not
+ * freed.
+ */
+void free_heap(Heap *heap);
+
+/**
+ * @brief Releases every object of a heap, keeping its shapes and statistics.
+ *
+ * @param heap A pointer to the Heap whose objects to free.
+ */
+void heap_free_objects(Heap *heap);
+
+/**
+ * @brief Allocates an object without properties in the nursery, collecting
+ * garbage first if it is full.
+ *
+ * @param heap The heap owning the object.
+ * @return The new object, or NULL if memory ran out.
+ */
+Object *heap_new_object(Heap *heap);
+
+/**
+ * @brief Collects the nursery, then the old generation if `major` is true or
+ * it outgrew its limit.
+ *
+ * Every object reachable from `heap->roots` survives, and the roots are
+ * updated to point to its new location. If memory runs out while copying,
+ * the objects are left in an unusable state until `heap_free_objects`.
+ *
+ * @param heap The heap to collect.
+ * @param major Whether to collect the old generation too.
+ * @return 1 on success, 0 if memory ran out.
+ */
+int heap_collect(Heap *heap, bool major);
+
+/**
+ * @brief Adds an old object to the remembered set. Used by
+ * `heap_write_barrier`.
+ *
+ * @return 1 on success, 0 if memory ran out.
+ */
+int heap_remember(Heap *heap, Object *object);
+
+/**
+ * @brief Records that `value` is being stored into `object`.
+ *
+ * Must be called for every store into the slots of an object, so that minor
+ * collections find the young objects referred to by old ones.
+ *
+ * @return 1 on success, 0 if memory ran out.
+ */
+static inline int heap_write_barrier(Heap *heap, Object *object, Value value) {
+  if (object->generation != OBJECT_OLD || object->remembered ||
+      !value_is_object(value) ||
+      ((const Object *)value_as_object(value))->generation != OBJECT_YOUNG)
+    return 1;
+
+  return heap_remember(heap, object);
+}
+
+/**
+ * @brief Returns the shape adding a property to a shape, creating it the
+ * first time.
+ *
+ * @param heap The heap owning `shape`.
+ * @param shape The shape to extend.
+ * @param name The property to add, which `shape` must not have.
+ * @return The child shape, or NULL if memory ran out.
+ */
+Shape *shape_transition(Heap *heap, Shape *shape, uint32_t name);
+
+/**
+ * @brief Returns the slot of a property in a shape.
+ *
+ * @param shape The shape to search.
+ * @param name The property to look up.
+ * @return The slot of `name`, or `SHAPE_NO_SLOT` if the shape does not have
+ * it.
+ */
+uint32_t shape_find_slot(const Shape *shape, uint32_t name);
+
+/**
+ * @brief Reads a property of an object by name.
+ *
+ * @param object The object to read.
+ * @param name The property to read.
+ * @return The value of the property, `undefined` if the object does not have
+ * it.
+ */
+Value object_get(const Object *object, uint32_t name);
+
+/**
+ * @brief Writes a property of an object by name, adding it if needed.
+ *
+ * @param heap The heap owning the object.
+ * @param object The object to write.
+ * @param name The property to write.
+ * @param value The value to store.
+ * @param slot Where the slot of the property is stored, if not NULL.
+ * @return 1 on success, 0 if memory ran out.
+ */
+int object_set(Heap *heap, Object *object, uint32_t name, Value value,
+               uint32_t *slot);
+
+/**
+ * @brief Makes room in an object for `count` slots. Never collects, so the
+ * object does not move.
+ *
+ * @return 1 on success, 0 if memory ran out.
+ */
+int object_reserve(Heap *heap, Object *object, uint32_t count);
+
+#endif // CIJS_OBJECT_H_
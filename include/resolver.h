@@ -0,0 +1,54 @@
+#ifndef CIJS_RESOLVER_H_
+#define CIJS_RESOLVER_H_
+
+#include "ast.h"
+
+/**
+ * @file resolver.h
+ * @brief Resolves the identifiers of a syntax tree to variable slots.
+ *
+ * The resolver runs once over a parsed tree and gives every function, the
+ * program included, a frame of numbered slots: its parameters first, then its
+ * `let`, `const` and function declarations in source order. Declarations are
+ * visible in the whole function declaring them, as in JavaScript, so an
+ * identifier refers to the innermost declaration of its name, whether it
+ * comes before or after the use. Each identifier is then annotated with the
+ * number of functions to leave and the slot to read, so executed code reads
+ * variables by index instead of looking names up.
+ */
+
+/**
+ * @brief Enum representing possible errors during resolution.
+ */
+typedef enum {
+  RESOLVE_OK = 0,            /**< Every identifier was resolved. */
+  RESOLVE_ERROR_NULL_PTR,    /**< A NULL pointer was passed to the function. */
+  RESOLVE_ERROR_REDECLARED,  /**< A name is declared twice in a function. */
+  RESOLVE_ERROR_CONSTANT,    /**< A `const` variable is assigned. */
+  RESOLVE_ERROR_MEMORY_ALLOCATION /**< Memory allocation failed. */
+} ResolveError;
+
+/**
+ * @brief Resolves the identifiers of a program.
+ *
+ * Sets the slots of declarations and functions, the frame sizes of functions
+ * and of the program, and the depth and slot of every identifier. Bodies of
+ * functions that are not parsed yet are skipped; `resolve_function` resolves
+ * them once parsed. A program must be resolved again after `ast_reparse`.
+ *
+ * @param program The root node returned by `ast_parse_program`.
+ * @return A `ResolveError` code indicating success or failure.
+ */
+ResolveError resolve_program(ASTNode *program);
+
+/**
+ * @brief Resolves the identifiers of a top-level function whose body was
+ * parsed by `ast_parse_function_body` after its program was resolved.
+ *
+ * @param program The resolved program declaring the function.
+ * @param function A `NODE_FUNCTION_DECLARATION` child of `program`.
+ * @return A `ResolveError` code indicating success or failure.
+ */
+ResolveError resolve_function(ASTNode *program, ASTNode *function);
+
+#endif // CIJS_RESOLVER_H_
@@ -0,0 +1,132 @@
+#ifndef CIJS_SOURCE_H_
+#define CIJS_SOURCE_H_
+
+#include <stddef.h>
+
+/**
+ * @file source.h
+ * @brief Describes where the tokenizer reads JavaScript source code from.
+ *
+ * A source is either a contiguous buffer (a string, a caller-owned buffer or a
+ * memory-mapped file) or a stream that is read in fixed-size chunks, so that
+ * large inputs can be processed without first copying them into memory.
+ */
+
+/**
+ * @brief Callback reading the next chunk of a streamed source.
+ *
+ * @param context The context given to `init_source_stream`.
+ * @param buffer Where the bytes should be written.
+ * @param capacity The maximum number of bytes to write.
+ * @return The number of bytes written, 0 once the stream is exhausted.
+ */
+typedef size_t (*SourceReadFn)(void *context, char *buffer, size_t capacity);
+
+/**
+ * @brief The different kinds of sources.
+ */
+typedef enum {
+  SOURCE_BUFFER, /**< Contiguous memory owned by the caller. */
+  SOURCE_MAPPED, /**< A file mapped into memory by `open_source_file`. */
+  SOURCE_READ,   /**< A file read into the heap by `open_source_file`. */
+  SOURCE_STREAM  /**< Input read on demand through a `SourceReadFn`. */
+} SourceKind;
+
+/**
+ * @struct Source
+ * @brief A JavaScript source, either contiguous or streamed.
+ */
+typedef struct {
+  SourceKind kind;   /**< How the source is accessed and released. */
+  const char *data;  /**< The source bytes, NULL for streams. */
+  size_t length;     /**< Number of bytes in `data`, 0 for streams. */
+  SourceReadFn read; /**< Reader of streamed sources. */
+  void *context;     /**< Context handed to `read`. */
+  size_t chunk_size; /**< Number of bytes requested from `read` at once. */
+} Source;
+
+/**
+ * @struct SourceEdit
+ * @brief Describes an edit of a source: `removed` bytes at `offset` were
+ * replaced by `inserted` new bytes.
+ */
+typedef struct {
+  size_t offset;   /**< Offset of the edit in the old and new source. */
+  size_t removed;  /**< Number of bytes of the old source replaced. */
+  size_t inserted; /**< Number of bytes of the new source replacing them. */
+} SourceEdit;
+
+/**
+ * @brief Enum representing possible errors when opening a source file.
+ */
+typedef enum {
+  SOURCE_OPEN_OK = 0,         /**< The file was opened successfully. */
+  SOURCE_OPEN_ERROR_NULL_PTR, /**< A NULL pointer was passed to the function. */
+  SOURCE_OPEN_ERROR_IO,       /**< The file could not be opened or read. */
+  SOURCE_OPEN_ERROR_MEMORY_ALLOCATION /**< The contents of a file that could
+                                         not be mapped did not fit in
+                                         memory. */
+} SourceOpenError;
+
+/**
+ * @brief Initializes a source over a NUL-terminated string.
+ *
+ * @param source A pointer to the Source to initialize.
+ * @param text The source code. It must outlive the source.
+ */
+void init_source_string(Source *source, const char *text);
+
+/**
+ * @brief Initializes a source over a buffer of known length.
+ *
+ * The buffer does not need to be NUL-terminated.
+ *
+ * @param source A pointer to the Source to initialize.
+ * @param data The source code. It must outlive the source.
+ * @param length The number of bytes in `data`.
+ */
+void init_source_buffer(Source *source, const char *data, size_t length);
+
+/**
+ * @brief Initializes a source that is read in chunks of `chunk_size` bytes.
+ *
+ * Only the chunk being tokenized (and any token crossing into the next one)
+ * is kept in memory.
+ *
+ * @param source A pointer to the Source to initialize.
+ * @param read The callback producing the source bytes.
+ * @param context The context handed to `read`.
+ * @param chunk_size The number of bytes to request from `read` at once.
+ */
+void init_source_stream(Source *source, SourceReadFn read, void *context,
+                        size_t chunk_size);
+
+/**
+ * @brief Opens a file by mapping it into memory.
+ *
+ * Pages are only read from disk as the tokenizer reaches them, so opening a
+ * file does not pay for copying it. Files that cannot be mapped, such as pipes
+ * and terminals, are read into a heap buffer instead.
+ *
+ * @param source A pointer to the Source to initialize.
+ * @param path The path of the file to open.
+ * @return A `SourceOpenError` code indicating success or failure.
+ */
+SourceOpenError open_source_file(Source *source, const char *path);
+
+/**
+ * @brief Releases the resources held by a source.
+ *
+ * Mapped files are unmapped and files read into the heap are freed; other
+ * kinds of sources own nothing.
+ *
+ * @param source A pointer to the Source to free.
+ */
+void free_source(Source *source);
+
+/**
+ * @brief A `SourceReadFn` reading from a `FILE *` passed as the context.
+ */
+size_t source_read_file(void *context, char *buffer, size_t capacity);
+
+#endif // CIJS_SOURCE_H_
@@ -0,0 +1,228 @@
+#ifndef CIJS_TOKEN_ARRAY_H_
+#define CIJS_TOKEN_ARRAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lexer.h"
+
+/**
+ * @file token_array.h
+ * @brief Lexes a whole source into an array of tokens, optionally in
+ * parallel.
+ *
+ * Parallel lexing splits a contiguous source into one chunk per thread,
+ * preferably right after a delimiter, and lexes every chunk on its own into a
+ * private buffer with a private atom table. A chunk may start in the middle of
+ * a token, so the chunks are stitched together in order: tokens the previous
+ * chunk already covered are dropped, and if a token of the chunk straddles
+ * where the previous chunk stopped, the seam is lexed again sequentially until
+ * the two agree on a token boundary. The lexer carries no state besides its
+ * position, so from that point on the chunk's tokens are exactly the ones a
+ * sequential pass produces. Names are re-interned into the caller's table in
+ * order of first appearance, so atoms match those of a sequential pass too.
+ */
+
+/**
+ * @struct TokenArray
+ * @brief A growable structure-of-arrays buffer of lexer tokens, terminated by
+ * a `TOKEN_EOF` token once lexing is complete.
+ *
+ * Each field of the tokens is stored in an array of its own, all four carved
+ * from a single allocation, so a scan over the types touches one byte per
+ * token. Offsets are relative to the start of the source, so the text of
+ * token `i` is `source->data + offsets[i]`.
+ */
+typedef struct {
+  uint8_t *types;     /**< The `TokenType` of each token. */
+  size_t *offsets;    /**< Offset of the text of each token. */
+  size_t *lengths;    /**< Length of the text of each token. */
+  uint64_t *payloads; /**< Payload of each token, see `LexerToken`, or the
+                         bits of the value of a number token. */
+  size_t count;       /**< Number of tokens, including the final EOF. */
+  size_t capacity;    /**< Number of tokens the arrays can hold. */
+} TokenArray;
+
+_Static_assert(TOKEN_UNKNOWN <= UINT8_MAX, "TokenType must fit in a byte");
+
+/**
+ * @struct TokenCursor
+ * @brief A position in a complete token array, giving the parser constant
+ * time lookahead and backtracking.
+ *
+ * Reading past the end keeps returning the final `TOKEN_EOF` token.
+ */
+typedef struct {
+  const TokenArray *array; /**< The tokens, ending with `TOKEN_EOF`. */
+  size_t index;            /**< Index of the next token to read. */
+} TokenCursor;
+
+/**
+ * @struct ParallelLexOptions
+ * @brief Settings of `lex_token_array_parallel`.
+ */
+typedef struct {
+  unsigned threads;  /**< Number of threads, 0 for one per online CPU. */
+  size_t chunk_size; /**< Minimum number of bytes per chunk, 0 for the
+                        default. Smaller sources use fewer threads. */
+} ParallelLexOptions;
+
+/**
+ * @struct TokenArrayChange
+ * @brief The tokens changed by `relex_token_array`.
+ *
+ * Tokens `[first, old_end)` of the old array were replaced by tokens
+ * `[first, new_end)` of the new one. Tokens before `first` are unchanged;
+ * tokens after them moved by `new_end - old_end` places and their offsets by
+ * the size difference of the edit.
+ */
+typedef struct {
+  size_t first;   /**< Index of the first replaced token. */
+  size_t old_end; /**< End of the replaced tokens in the old array. */
+  size_t new_end; /**< End of the replacing tokens in the new array. */
+} TokenArrayChange;
+
+/**
+ * @brief Enum representing possible errors when lexing into a token array.
+ */
+typedef enum {
+  TOKEN_ARRAY_OK = 0,         /**< The whole source was lexed. */
+  TOKEN_ARRAY_ERROR_NULL_PTR, /**< A NULL pointer was passed to the function.
+                               */
+  TOKEN_ARRAY_ERROR_SOURCE,   /**< The source is empty or, for parallel
+                                 lexing, not contiguous. */
+  TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION, /**< Memory allocation failed. */
+  TOKEN_ARRAY_ERROR_TOKEN_TOO_LONG     /**< A token is longer than
+                                          `TOKENIZER_MAX_TOKEN_LENGTH`. */
+} TokenArrayError;
+
+/**
+ * @brief Initializes an empty token array.
+ *
+ * @param array A pointer to the TokenArray to initialize.
+ */
+void init_token_array(TokenArray *array);
+
+/**
+ * @brief Releases the tokens of a token array.
+ *
+ * @param array A pointer to the TokenArray to free. The TokenArray structure
+ * itself is not freed.
+ */
+void free_token_array(TokenArray *array);
+
+/**
+ * @brief Appends a token to a token array.
+ *
+ * @param array The TokenArray to append to.
+ * @param token The token to append.
+ * @param payload The payload stored for the token: the bits of its value for
+ * a number token, `token.payload` otherwise.
+ * @return 1 on success, 0 if the array could not be grown.
+ */
+int token_array_push(TokenArray *array, LexerToken token, uint64_t payload);
+
+/**
+ * @brief Lexes a whole source, on the calling thread, into a token array.
+ *
+ * @param source The source to lex. Streamed sources are supported.
+ * @param atoms The table identifiers are interned into, or NULL.
+ * @param array An initialized, empty TokenArray receiving the tokens.
+ * @return A `TokenArrayError` code indicating success or failure.
+ */
+TokenArrayError lex_token_array(const Source *source, AtomTable *atoms,
+                                TokenArray *array);
+
+/**
+ * @brief Lexes a whole contiguous source on several threads into a token
+ * array.
+ *
+ * The resulting tokens and atoms are identical to those of `lex_token_array`.
+ *
+ * @param source The source to lex. It must be contiguous.
+ * @param atoms The table identifiers are interned into, or NULL.
+ * @param options The settings of the parallel lexer, or NULL for the defaults.
+ * @param array An initialized, empty TokenArray receiving the tokens.
+ * @return A `TokenArrayError` code indicating success or failure.
+ */
+TokenArrayError lex_token_array_parallel(const Source *source,
+                                         AtomTable *atoms,
+                                         const ParallelLexOptions *options,
+                                         TokenArray *array);
+
+/**
+ * @brief Updates the tokens of a source after it was edited.
+ *
+ * Only the tokens around the edit are lexed again: lexing starts after the
+ * last token ending before the edit and stops as soon as it ends a token
+ * where an old token ended, past the edit. The remaining tokens are kept and
+ * shifted. Names are interned into `atoms`, which must be the table the array
+ * was lexed with.
+ *
+ * @param source The edited source. It must be contiguous.
+ * @param atoms The table identifiers are interned into, or NULL.
+ * @param edit The edit turning the old source into `source`.
+ * @param array The complete token array of the old source, updated in place.
+ * @param change Receives the range of tokens that changed.
+ * @return A `TokenArrayError` code indicating success or failure. On failure
+ * `array` is unchanged.
+ */
+TokenArrayError relex_token_array(const Source *source, AtomTable *atoms,
+                                  const SourceEdit *edit, TokenArray *array,
+                                  TokenArrayChange *change);
+
+/**
+ * @brief Returns token `index` of a token array.
+ */
+static inline LexerToken token_array_at(const TokenArray *array,
+                                        size_t index) {
+  uint8_t type = array->types[index];
+  LexerToken token = {
+      .type = type,
+      .offset = array->offsets[index],
+      .length = (uint32_t)array->lengths[index],
+      .payload = type == TOKEN_NUMBER ? 0 : (uint32_t)array->payloads[index]};
+  return token;
+}
+
+/**
+ * @brief Returns the value of token `index` of a token array, which must be a
+ * `TOKEN_NUMBER` token.
+ */
+static inline double token_array_number(const TokenArray *array,
+                                        size_t index) {
+  double value;
+  memcpy(&value, &array->payloads[index], sizeof(value));
+  return value;
+}
+
+/**
+ * @brief Returns the token `ahead` positions after the next one without
+ * consuming anything; `token_cursor_peek(cursor, 0)` is the next token.
+ */
+static inline LexerToken token_cursor_peek(const TokenCursor *cursor,
+                                           size_t ahead) {
+  size_t last = cursor->array->count - 1;
+  size_t index = cursor->index + ahead;
+  return token_array_at(cursor->array, index < last ? index : last);
+}
+
+/**
+ * @brief Consumes and returns the next token.
+ */
+static inline LexerToken token_cursor_next(TokenCursor *cursor) {
+  LexerToken token = token_cursor_peek(cursor, 0);
+  if (cursor->index + 1 < cursor->array->count)
+    cursor->index++;
+  return token;
+}
+
+/**
+ * @brief Moves the cursor back to a position saved from `cursor->index`.
+ */
+static inline void token_cursor_rewind(TokenCursor *cursor, size_t index) {
+  cursor->index = index;
+}
+
+#endif // CIJS_TOKEN_ARRAY_H_
@@ -1,7 +1,9 @@
 #ifndef CIJS_TOKENIZER_H_
 #define CIJS_TOKENIZER_H_
 
-#define MAX_TOKEN_LENGTH 256
+#include <stdint.h>
+
+#include "source.h"
 
 /**
  * @file tokenizer.h
@@ -11,15 +13,87 @@
  * tokenizing JavaScript source code into meaningful tokens.
  */
 
+/**
+ * @brief Enum representing the reasons a tokenizer can stop before the end
+ * of its source.
+ */
+typedef enum {
+  TOKENIZER_OK = 0,                  /**< No error occurred. */
+  TOKENIZER_ERROR_MEMORY_ALLOCATION, /**< The window of a streaming tokenizer
+                                        could not grow to hold a token. */
+  TOKENIZER_ERROR_TOKEN_TOO_LONG     /**< A token is longer than
+                                        `TOKENIZER_MAX_TOKEN_LENGTH`. */
+} TokenizerError;
+
 /**
  * @struct Tokenizer
  * @brief Represents the state of the tokenizer as it processes source code.
+ *
+ * For contiguous sources `source` is the whole input. For streamed sources it
+ * is a window over the input, owned by the tokenizer, that slides forward as
+ * chunks are read; `base` is the offset of the window in the whole input.
+ *
+ * The input is delimited by its length only: it may hold NUL bytes, which are
+ * returned as single-byte tokens, and may be larger than 4 GiB.
  */
 typedef struct {
-  const char *source;
-  int position;
+  const char *source;   /**< The bytes available for tokenizing. */
+  size_t length;        /**< Number of bytes in `source`. */
+  size_t position;      /**< Offset of the next byte to read in `source`. */
+  size_t base;          /**< Offset of `source[0]` in the whole input. */
+  SourceReadFn read;    /**< Reader of the remaining input, NULL once done. */
+  void *context;        /**< Context handed to `read`. */
+  char *buffer;         /**< Window of a streaming tokenizer. */
+  size_t capacity;      /**< Number of bytes allocated for `buffer`. */
+  size_t chunk_size;    /**< Number of bytes requested from `read` at once. */
+  TokenizerError error; /**< Why the tokens ended early, if they did. */
 } Tokenizer;
 
+/**
+ * @brief Number of bytes from the end of a numeric literal that the tokenizer
+ * may read to find where the literal ends: the sign and the digit after an
+ * `e`. Other tokens only read the byte right after them.
+ */
+#define TOKENIZER_LOOKAHEAD 2
+
+/**
+ * @brief Largest number of bytes in a token, so that every length fits in 32
+ * bits. A longer run of identifier or number characters stops the tokenizer
+ * with `TOKENIZER_ERROR_TOKEN_TOO_LONG`.
+ */
+#define TOKENIZER_MAX_TOKEN_LENGTH ((size_t)UINT32_MAX)
+
+/**
+ * @brief Character classes used by the tokenizer and the lexer.
+ *
+ * Classes are bit flags so that a single lookup in `char_classes` can test
+ * several of them at once.
+ */
+typedef enum {
+  CHAR_CLASS_DELIMITER = 1 << 0,        /**< Whitespace and `;`. */
+  CHAR_CLASS_IDENTIFIER_START = 1 << 1, /**< `A-Z`, `a-z`, `_` and `$`. */
+  CHAR_CLASS_DIGIT = 1 << 2             /**< `0-9`. */
+} CharClass;
+
+/**
+ * @brief Locale-independent table mapping every byte to its `CharClass` flags.
+ */
+extern const unsigned char char_classes[256];
+
+/**
+ * @struct TokenSpan
+ * @brief A view of a single raw token inside `Tokenizer.source`.
+ *
+ * Spans never own memory: the token text is returned by
+ * `tokenizer_span_text` and is exactly `length` bytes long (it is not
+ * NUL-terminated). A span with a `length` of 0 marks the end of the source.
+ */
+typedef struct {
+  size_t offset; /**< Offset of the first byte of the token in the input. */
+  size_t length; /**< Number of bytes in the token, 0 at the end of the
+                    source. */
+} TokenSpan;
+
 /**
  * @brief Enum representing possible errors during tokenizer initialization.
  */
@@ -27,8 +101,11 @@ typedef enum {
   TOKENIZER_INIT_OK = 0,         /**< Initialization successful. */
   TOKENIZER_INIT_ERROR_NULL_PTR, /**< A NULL pointer was passed to the function.
                                   */
-  TOKENIZER_INIT_ERROR_INVALID_SOURCE /**< The source string is invalid or
+  TOKENIZER_INIT_ERROR_INVALID_SOURCE, /**< The source string is invalid or
                                          empty. */
+  TOKENIZER_INIT_ERROR_MEMORY_ALLOCATION /**< The window of a streaming
+                                            tokenizer could not be
+                                            allocated. */
 } TokenizerInitError;
 
 /**
@@ -44,15 +121,56 @@ typedef enum {
 TokenizerInitError init_tokenizer(Tokenizer *tokenizer, const char *source);
 
 /**
- * @brief Returns the next token from the source code.
+ * @brief Initializes the tokenizer over a contiguous or streamed source.
  *
  * @param tokenizer A pointer to the Tokenizer instance to initialize.
+ * @param source The source to tokenize. Contiguous sources must outlive the
+ * tokenizer and do not need to be NUL-terminated. Streamed sources are read
+ * chunk by chunk as tokens are requested.
  *
- * Note: The caller must free the memory allocated for the token.
+ * Streaming tokenizers own a buffer that must be released with
+ * `free_tokenizer`.
+ */
+TokenizerInitError init_tokenizer_source(Tokenizer *tokenizer,
+                                         const Source *source);
+
+/**
+ * @brief Frees the memory owned by the tokenizer.
+ *
+ * @param tokenizer A pointer to the Tokenizer instance to free. The Tokenizer
+ * structure itself is not freed.
+ */
+void free_tokenizer(Tokenizer *tokenizer);
+
+/**
+ * @brief Returns the next token from the source code.
+ *
+ * @param tokenizer A pointer to the initialized Tokenizer instance.
+ *
+ * This function returns a span describing the next token from the current
+ * position of the tokenizer. No memory is allocated: the span points back into
+ * the source. Once the source has reached an end the returned span has a
+ * length of 0.
+ *
+ * A token is a run of identifier characters, a numeric literal with its
+ * prefix, fraction, exponent and separators (along with any letters stuck to
+ * it), or a single other character.
+ *
+ * With a streamed source only the text of the latest span is guaranteed to be
+ * available; reading further may slide the window past earlier tokens. If
+ * the window cannot grow to hold the next token, or the token is longer than
+ * `TOKENIZER_MAX_TOKEN_LENGTH`, `error` is set and every span from then on has
+ * a length of 0, like at the end of the source. The span returned for a token
+ * that is too long starts where the token does.
+ */
+TokenSpan next_token(Tokenizer *tokenizer);
+
+/**
+ * @brief Returns a pointer to the text of a span.
  *
- * This function returns the next token from the current position of the
- * tokenizer. It can also return null if the source code has reached an end.
+ * @param tokenizer The Tokenizer that produced the span.
+ * @param span The span whose text should be returned.
  */
-const char *next_token(Tokenizer *tokenizer);
+const char *tokenizer_span_text(const Tokenizer *tokenizer, TokenSpan span);
 
 #endif // CIJS_TOKENIZER_H_
@@ -0,0 +1,230 @@
+#ifndef CIJS_VALUE_H_
+#define CIJS_VALUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @file value.h
+ * @brief Defines the values manipulated by the CIJS runtime.
+ *
+ * Values are NaN-boxed into 64 bits. A number is stored as the bits of its
+ * IEEE 754 double. Every other value is hidden in the payload of a quiet NaN
+ * no arithmetic produces: the singletons `undefined`, `null`, `false` and
+ * `true` use small tags, and heap objects keep their 48-bit address with the
+ * sign bit set. A value fits in a register, is compared with one integer
+ * comparison and can be stored in dense arrays.
+ */
+
+/**
+ * @brief A NaN-boxed runtime value. Use the functions below to build and
+ * inspect values; the bit layout is an implementation detail.
+ */
+typedef uint64_t Value;
+
+_Static_assert(sizeof(Value) == 8, "Value must stay 64 bits");
+
+/**
+ * @brief The different types of values, as returned by `value_type`.
+ */
+typedef enum {
+  VALUE_UNDEFINED, /**< The `undefined` value. */
+  VALUE_NULL,      /**< The `null` value. */
+  VALUE_BOOLEAN,   /**< `true` or `false`. */
+  VALUE_NUMBER,    /**< An IEEE 754 double. */
+  VALUE_OBJECT     /**< A pointer to a heap object. */
+} ValueType;
+
+/** Bits set in every boxed value that is not a number. */
+#define VALUE_QUIET_NAN ((uint64_t)0x7ffc000000000000)
+/** The sign bit, set in boxed object pointers. */
+#define VALUE_SIGN_BIT ((uint64_t)0x8000000000000000)
+/** The NaN every NaN number is canonicalized to. */
+#define VALUE_CANONICAL_NAN ((uint64_t)0x7ff8000000000000)
+
+#define VALUE_TAG_UNDEFINED 1
+#define VALUE_TAG_NULL 2
+#define VALUE_TAG_FALSE 3
+#define VALUE_TAG_TRUE 4
+
+#define VALUE_UNDEFINED_BITS (VALUE_QUIET_NAN | VALUE_TAG_UNDEFINED)
+#define VALUE_NULL_BITS (VALUE_QUIET_NAN | VALUE_TAG_NULL)
+#define VALUE_FALSE_BITS (VALUE_QUIET_NAN | VALUE_TAG_FALSE)
+#define VALUE_TRUE_BITS (VALUE_QUIET_NAN | VALUE_TAG_TRUE)
+
+/**
+ * @brief Returns the `undefined` value.
+ */
+static inline Value value_undefined(void) { return VALUE_UNDEFINED_BITS; }
+
+/**
+ * @brief Returns the `null` value.
+ */
+static inline Value value_null(void) { return VALUE_NULL_BITS; }
+
+/**
+ * @brief Returns a boolean value.
+ */
+static inline Value value_boolean(bool boolean) {
+  return boolean ? VALUE_TRUE_BITS : VALUE_FALSE_BITS;
+}
+
+/**
+ * @brief Returns a number value. Every NaN is stored as the same quiet NaN so
+ * that no number can be mistaken for a boxed value.
+ */
+static inline Value value_number(double number) {
+  Value value;
+  memcpy(&value, &number, sizeof(Value));
+  return number != number ? VALUE_CANONICAL_NAN : value;
+}
+
+/**
+ * @brief Returns a value pointing to a heap object.
+ *
+ * @param object The object. Its address must fit in 48 bits, as user-space
+ * addresses do on current 64-bit platforms.
+ */
+static inline Value value_object(void *object) {
+  return VALUE_SIGN_BIT | VALUE_QUIET_NAN | (uint64_t)(uintptr_t)object;
+}
+
+/**
+ * @brief Returns whether a value is `undefined`.
+ */
+static inline bool value_is_undefined(Value value) {
+  return value == VALUE_UNDEFINED_BITS;
+}
+
+/**
+ * @brief Returns whether a value is `null`.
+ */
+static inline bool value_is_null(Value value) {
+  return value == VALUE_NULL_BITS;
+}
+
+/**
+ * @brief Returns whether a value is `true` or `false`.
+ */
+static inline bool value_is_boolean(Value value) {
+  return value == VALUE_FALSE_BITS || value == VALUE_TRUE_BITS;
+}
+
+/**
+ * @brief Returns whether a value is a number.
+ */
+static inline bool value_is_number(Value value) {
+  return (value & VALUE_QUIET_NAN) != VALUE_QUIET_NAN;
+}
+
+/**
+ * @brief Returns whether a value points to a heap object.
+ */
+static inline bool value_is_object(Value value) {
+  return (value & (VALUE_SIGN_BIT | VALUE_QUIET_NAN)) ==
+         (VALUE_SIGN_BIT | VALUE_QUIET_NAN);
+}
+
+/**
+ * @brief Returns the boolean held by a value for which `value_is_boolean`
+ * holds.
+ */
+static inline bool value_as_boolean(Value value) {
+  return value == VALUE_TRUE_BITS;
+}
+
+/**
+ * @brief Returns the number held by a value for which `value_is_number` holds.
+ */
+static inline double value_as_number(Value value) {
+  double number;
+  memcpy(&number, &value, sizeof(double));
+  return number;
+}
+
+/**
+ * @brief Returns the object pointed to by a value for which `value_is_object`
+ * holds.
+ */
+static inline void *value_as_object(Value value) {
+  return (void *)(uintptr_t)(value & ~(VALUE_SIGN_BIT | VALUE_QUIET_NAN));
+}
+
+/**
+ * @brief Returns the type of a value.
+ */
+ValueType value_type(Value value);
+
+/**
+ * @brief Converts a value to a number as JavaScript's `ToNumber` does.
+ *
+ * @param value The value to convert.
+ * @return The numeric value: NaN for `undefined`, 0 for `null`, 0 or 1 for
+ * booleans.
+ */
+double value_to_number(Value value);
+
+/**
+ * @brief Adds two values as JavaScript's `+` operator does.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The sum of the operands converted to numbers.
+ */
+Value value_add(Value left, Value right);
+
+/**
+ * @brief Subtracts two values as JavaScript's `-` operator does.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The difference of the operands converted to numbers.
+ */
+Value value_subtract(Value left, Value right);
+
+/**
+ * @brief Multiplies two values as JavaScript's `*` operator does.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The product of the operands converted to numbers.
+ */
+Value value_multiply(Value left, Value right);
+
+/**
+ * @brief Divides two values as JavaScript's `/` operator does.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The quotient of the operands converted to numbers.
+ */
+Value value_divide(Value left, Value right);
+
+/**
+ * @brief Computes the remainder of two values as JavaScript's `%` operator
+ * does.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The remainder of the operands converted to numbers, with the sign of
+ * the left one.
+ */
+Value value_modulo(Value left, Value right);
+
+/**
+ * @brief Converts a value to a boolean as JavaScript's `ToBoolean` does.
+ *
+ * @param value The value to convert.
+ * @return false for `undefined`, `null`, `false`, 0 and NaN, true otherwise.
+ */
+bool value_to_boolean(Value value);
+
+/**
+ * @brief Prints a value the way JavaScript converts it to a string.
+ *
+ * @param value The value to print.
+ */
+void value_print(Value value);
+
+#endif // CIJS_VALUE_H_
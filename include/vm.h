@@ -0,0 +1,105 @@
+#ifndef CIJS_VM_H_
+#define CIJS_VM_H_
+
+#include "bytecode.h"
+#include "object.h"
+
+/**
+ * @file vm.h
+ * @brief Defines the virtual machine executing CIJS bytecode.
+ *
+ * The VM runs a `Chunk` in a single dispatch loop over its register file.
+ * When the compiler supports it, dispatch uses computed gotos so that every
+ * instruction jumps straight to the next handler.
+ *
+ * Every property access of a chunk has an inline cache remembering the shapes
+ * of the objects it saw and where the property is for each of them. A cache
+ * hit costs one shape comparison and an indexed load or store; only misses
+ * look the property up in the shape.
+ */
+
+/**
+ * @brief Number of shapes an inline cache remembers. A cache seeing one shape
+ * is monomorphic, up to `IC_WAYS` polymorphic; past that it stops learning
+ * and every new shape misses.
+ */
+#define IC_WAYS 4
+
+/**
+ * @struct InlineCache
+ * @brief What a property access learned about the objects it accessed.
+ *
+ * Entry `i` applies to objects of shape `shapes[i]`: the property is in slot
+ * `slots[i]`, or missing if that is `SHAPE_NO_SLOT`. A store moves the object
+ * to shape `targets[i]`, which differs from `shapes[i]` when the store adds
+ * the property.
+ */
+typedef struct {
+  Shape *shapes[IC_WAYS];  /**< The shapes seen, in the order seen. */
+  Shape *targets[IC_WAYS]; /**< The shape of objects after a store. */
+  uint32_t slots[IC_WAYS]; /**< The slot of the property for each shape. */
+  uint32_t count;          /**< Number of entries used. */
+} InlineCache;
+
+/**
+ * @struct VM
+ * @brief The state of the virtual machine.
+ *
+ * `ic_hits` and `ic_misses` count the property accesses of every run since
+ * the VM was initialized, and `heap.stats` the work of the garbage collector.
+ */
+typedef struct {
+  Value *registers;        /**< The register file. */
+  uint32_t register_count; /**< Number of values in `registers`. */
+  Heap heap;               /**< The objects and shapes of the VM. */
+  InlineCache *caches;     /**< The inline caches of the chunk last run. */
+  uint32_t cache_count;    /**< Number of caches in `caches`. */
+  uint64_t chunk_serial;   /**< Serial of the chunk the caches belong to. */
+  uint64_t ic_hits;        /**< Property accesses served by their cache. */
+  uint64_t ic_misses;      /**< Property accesses that missed their cache. */
+} VM;
+
+/**
+ * @brief Enum representing possible results of running a chunk.
+ */
+typedef enum {
+  VM_RUN_OK = 0,         /**< The chunk ran to completion. */
+  VM_RUN_ERROR_NULL_PTR, /**< A NULL pointer was passed to the function. */
+  VM_RUN_ERROR_TYPE,     /**< A property of `undefined` or `null` was
+                            accessed. */
+  VM_RUN_ERROR_MEMORY_ALLOCATION /**< The registers, an object or a shape could
+                                    not be allocated. */
+} VMRunResult;
+
+/**
+ * @brief Initializes a VM without registers.
+ *
+ * @param vm A pointer to the VM to initialize.
+ */
+void init_vm(VM *vm);
+
+/**
+ * @brief Releases the registers, objects, shapes and caches of a VM.
+ *
+ * @param vm A pointer to the VM to free. The VM structure itself is not freed.
+ */
+void free_vm(VM *vm);
+
+/**
+ * @brief Runs a chunk.
+ *
+ * The register file is sized for the chunk and every register starts as
+ * `undefined`. Once the chunk has run, variable `i` of the chunk can be read
+ * from `vm->registers[i]`, and the objects it refers to stay alive until the
+ * next run. While the chunk runs, objects no longer reachable from the
+ * registers are garbage collected. Objects of the previous run are released
+ * first; shapes are kept, and so are the inline caches when the same chunk
+ * is run again.
+ *
+ * @param vm A pointer to the initialized VM.
+ * @param chunk The chunk to run, as produced by `compile_program`.
+ * @return A `VMRunResult` code indicating success or failure.
+ */
+VMRunResult vm_run(VM *vm, const Chunk *chunk);
+
+#endif // CIJS_VM_H_
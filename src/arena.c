@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/arena.h"
+
+/*
+ * Size of the first block of an arena. Later blocks double in size up to
+ * ARENA_MAX_BLOCK_SIZE, unless a single allocation needs more.
+ */
+#define ARENA_MIN_BLOCK_SIZE (64 * 1024)
+#define ARENA_MAX_BLOCK_SIZE (16 * 1024 * 1024)
+
+/*
+ * Helper function to round a size up to the alignment of any type
+ */
+static inline size_t arena_align(size_t size) {
+  const size_t alignment = _Alignof(max_align_t);
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * Initializes an empty arena.
+ *
+ * @param arena A pointer to the Arena to initialize.
+ */
+void init_arena(Arena *arena) {
+  if (!arena)
+    return;
+
+  arena->current = NULL;
+  arena->allocated = 0;
+}
+
+/**
+ * Releases every block owned by the arena.
+ *
+ * @param arena A pointer to the Arena to free.
+ */
+void free_arena(Arena *arena) {
+  if (!arena)
+    return;
+
+  ArenaBlock *block = arena->current;
+  while (block) {
+    ArenaBlock *previous = block->previous;
+    free(block);
+    block = previous;
+  }
+
+  arena->current = NULL;
+  arena->allocated = 0;
+}
+
+/*
+ * Helper function to add a block able to hold at least `size` bytes
+ */
+static ArenaBlock *arena_grow(Arena *arena, size_t size) {
+  size_t capacity = ARENA_MIN_BLOCK_SIZE;
+  if (arena->current) {
+    capacity = arena->current->capacity * 2;
+    if (capacity > ARENA_MAX_BLOCK_SIZE)
+      capacity = ARENA_MAX_BLOCK_SIZE;
+  }
+
+  if (capacity < size)
+    capacity = size;
+
+  ArenaBlock *block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + capacity);
+  if (!block)
+    return NULL;
+
+  block->previous = arena->current;
+  block->capacity = capacity;
+  block->used = 0;
+
+  arena->current = block;
+  arena->allocated += capacity;
+
+  return block;
+}
+
+/**
+ * Allocates uninitialized, maximally aligned memory from the arena.
+ *
+ * @param arena A pointer to the Arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return A pointer to the memory, or NULL on allocation failure.
+ */
+void *arena_alloc(Arena *arena, size_t size) {
+  if (!arena)
+    return NULL;
+
+  size = arena_align(size);
+
+  ArenaBlock *block = arena->current;
+  if (!block || block->capacity - block->used < size) {
+    block = arena_grow(arena, size);
+    if (!block)
+      return NULL;
+  }
+
+  void *memory = (char *)block->data + block->used;
+  block->used += size;
+
+  return memory;
+}
+
+/**
+ * Copies `length` characters of `text` into the arena and terminates them.
+ *
+ * @param arena A pointer to the Arena to allocate from.
+ * @param text The characters to copy.
+ * @param length The number of characters to copy.
+ * @return The NUL-terminated copy, or NULL on allocation failure.
+ */
+char *arena_strndup(Arena *arena, const char *text, size_t length) {
+  char *copy = (char *)arena_alloc(arena, length + 1);
+  if (!copy)
+    return NULL;
+
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+
+  return copy;
+}
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,41 +19,1343 @@
  * @retval AST_INIT_OK If initialization is successful.
  * @retval AST_INIT_ERROR_NULL_PTR If the provided AST pointer is NULL.
  * @retval AST_INIT_ERROR_LEXER_FAIL If initializing the lexer fails.
+ * @retval AST_INIT_ERROR_MEMORY_FAIL If the lexer could not be allocated.
  */
 ASTInitError init_ast(AST *ast, const char *source) {
-  if (ast == NULL) {
+  if (ast == NULL || source == NULL) {
+    return AST_INIT_ERROR_NULL_PTR;
+  }
+
+  Source text;
+  init_source_string(&text, source);
+
+  return init_ast_source(ast, &text);
+}
+
+/**
+ * @brief Resets every member of the AST to an empty state.
+ */
+static void ast_init_state(AST *ast) {
+  LexerToken none = {.type = TOKEN_EOF, .offset = 0, .length = 0, .payload = 0};
+
+  ast->lexer = NULL;
+  init_token_array(&ast->tokens);
+  ast->cursor.array = &ast->tokens;
+  ast->cursor.index = 0;
+  ast->ranges = NULL;
+  ast->range_count = 0;
+  ast->range_capacity = 0;
+  ast->stop = 0;
+  ast->lazy_functions = false;
+  ast->function_depth = 0;
+  ast->depth = 0;
+  ast->number = 0.0;
+  ast->last_token = none;
+  ast->previous_end = 0;
+
+  init_arena(&ast->arena);
+  init_atom_table(&ast->atoms);
+
+  ast->pending = NULL;
+  ast->pending_count = 0;
+  ast->pending_capacity = 0;
+
+  ast->operators = NULL;
+  ast->operator_count = 0;
+  ast->operator_capacity = 0;
+
+  ast->root.type = 0;
+  memset(&ast->root.data, 0, sizeof(ASTNodeData));
+
+  init_diagnostic_list(&ast->diagnostics);
+  init_diagnostic_list(&ast->body_diagnostics);
+}
+
+/**
+ * @brief Initializes the AST over a contiguous or streamed source.
+ *
+ * Identifiers are interned into the AST's atom table and literals are folded
+ * into values while parsing, so the tree stays valid after a streamed source
+ * has moved past them.
+ *
+ * @param ast A pointer to the AST structure to initialize.
+ * @param source The source to parse. Must not be NULL.
+ * @return An `ASTInitError` code indicating the success or failure of
+ * initialization.
+ */
+ASTInitError init_ast_source(AST *ast, const Source *source) {
+  if (ast == NULL || source == NULL) {
     return AST_INIT_ERROR_NULL_PTR;
   }
 
   Lexer *lexer = (Lexer *)malloc(sizeof(Lexer));
-  if (init_lexer(lexer, source) != LEXER_INIT_OK) {
-    free_lexer(lexer);
+  if (!lexer) {
+    return AST_INIT_ERROR_MEMORY_FAIL;
+  }
+
+  if (init_lexer_source(lexer, source) != LEXER_INIT_OK) {
+    free(lexer);
+    return AST_INIT_ERROR_LEXER_FAIL;
+  }
+
+  ast_init_state(ast);
+  ast->lexer = lexer;
+  lexer->atoms = &ast->atoms;
+
+  return AST_INIT_OK;
+}
+
+/**
+ * @brief Initializes the AST over a contiguous source lexed into a token
+ * array before parsing.
+ *
+ * @param ast A pointer to the AST structure to initialize.
+ * @param source The contiguous source to parse. Must not be NULL.
+ * @param options The settings of a parallel lexer, or NULL for a sequential
+ * one.
+ * @return An `ASTInitError` code indicating the success or failure of
+ * initialization.
+ */
+ASTInitError init_ast_tokens(AST *ast, const Source *source,
+                             const ParallelLexOptions *options) {
+  if (ast == NULL || source == NULL) {
+    return AST_INIT_ERROR_NULL_PTR;
+  }
+
+  if (source->kind == SOURCE_STREAM) {
     return AST_INIT_ERROR_LEXER_FAIL;
   }
 
-  ast->lexer = lexer;
+  ast_init_state(ast);
+
+  TokenArrayError error =
+      options ? lex_token_array_parallel(source, &ast->atoms, options,
+                                         &ast->tokens)
+              : lex_token_array(source, &ast->atoms, &ast->tokens);
+
+  if (error != TOKEN_ARRAY_OK) {
+    free_ast(ast);
+    if (error == TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION)
+      return AST_INIT_ERROR_MEMORY_FAIL;
+    return error == TOKEN_ARRAY_ERROR_TOKEN_TOO_LONG
+               ? AST_INIT_ERROR_TOKEN_TOO_LONG
+               : AST_INIT_ERROR_LEXER_FAIL;
+  }
+
+  return AST_INIT_OK;
+}
+
+/**
+ * @brief Frees the memory allocated for the AST structure and its internal
+ * components.
+ *
+ * This function frees the memory used by the AST, including the lexer. Every
+ * node and child array of the tree lives in the AST's arena and every name in
+ * its atom table, so the whole tree is released at once without walking it.
+ *
+ * @param ast A pointer to the AST to free.
+ */
+void free_ast(AST *ast) {
+  if (!ast)
+    return;
+
+  if (ast->lexer) {
+    free_lexer(ast->lexer);
+    free(ast->lexer);
+    ast->lexer = NULL;
+  }
+
+  free_token_array(&ast->tokens);
+  free(ast->ranges);
+  ast->ranges = NULL;
+  ast->range_count = 0;
+  ast->range_capacity = 0;
+  free_arena(&ast->arena);
+  free_atom_table(&ast->atoms);
+
+  free(ast->pending);
+  ast->pending = NULL;
+  ast->pending_count = 0;
+  ast->pending_capacity = 0;
+
+  free(ast->operators);
+  ast->operators = NULL;
+  ast->operator_count = 0;
+  ast->operator_capacity = 0;
+
+  free_diagnostic_list(&ast->diagnostics);
+  free_diagnostic_list(&ast->body_diagnostics);
+}
+
+/**
+ * @brief Consumes and returns the next token.
+ */
+static LexerToken ast_next_token(AST *ast) {
+  LexerToken token = ast->lexer ? next_lexical_token(ast->lexer)
+                                : token_cursor_next(&ast->cursor);
+
+  /* Braces are counted so that recovering from an error skips whole
+   * blocks. */
+  ast->previous_end = ast->last_token.offset + ast->last_token.length;
+  ast->last_token = token;
+
+  if (token.type == TOKEN_LEFT_BRACE) {
+    ast->depth++;
+  } else if (token.type == TOKEN_RIGHT_BRACE && ast->depth > 0) {
+    ast->depth--;
+  } else if (token.type == TOKEN_NUMBER) {
+    /* Values do not fit in tokens; a number is never the final EOF, so the
+     * cursor moved past it. */
+    ast->number = ast->lexer ? lexer_number(ast->lexer)
+                             : token_array_number(ast->cursor.array,
+                                                  ast->cursor.index - 1);
+  }
+
+  return token;
+}
+
+/**
+ * @brief Returns the next token without consuming it.
+ */
+static LexerToken ast_peek_token(AST *ast) {
+  if (!ast->lexer)
+    return token_cursor_peek(&ast->cursor, 0);
+
+  Tokenizer *tokenizer = ast->lexer->tokenizer;
+
+  /* A streaming tokenizer keeps the bytes from where a call started, so the
+   * position is still inside the window, possibly at a new offset. */
+  size_t position = tokenizer->base + tokenizer->position;
+  LexerToken token = next_lexical_token(ast->lexer);
+  tokenizer->position = position - tokenizer->base;
+
+  return token;
+}
+
+/**
+ * @brief Allocates a node without children from the AST's arena.
+ */
+static ASTNode *ast_new_node(AST *ast, ASTNodeType type) {
+  ASTNode *node = (ASTNode *)arena_alloc(&ast->arena, sizeof(ASTNode));
+  if (!node)
+    return NULL;
+
+  memset(node, 0, sizeof(ASTNode));
+  node->type = type;
+
+  return node;
+}
+
+static bool ast_is_statement_keyword(TokenType type);
+
+/**
+ * @brief Records a syntax error at `token`.
+ *
+ * When something is missing and `token` starts the next statement or is the
+ * end of the program, the error is recorded right after the token read before
+ * it instead, where the missing part belongs.
+ *
+ * Parsing functions fail with `return ast_error(...)` on a syntax error and
+ * with a plain `return 0` when memory runs out, which is told apart by the
+ * diagnostic left behind.
+ *
+ * @return 0.
+ */
+static int ast_error(AST *ast, DiagnosticCode code, LexerToken token) {
+  size_t offset = token.offset;
+  size_t length = token.length;
+
+  /* The tokens end early where a token is too long to be read. */
+  if (token.type == TOKEN_EOF && ast->lexer &&
+      lexer_error(ast->lexer) == TOKENIZER_ERROR_TOKEN_TOO_LONG)
+    code = DIAGNOSTIC_TOKEN_TOO_LONG;
+
+  bool missing = code != DIAGNOSTIC_UNKNOWN_TOKEN &&
+                 code != DIAGNOSTIC_INVALID_ASSIGNMENT &&
+                 code != DIAGNOSTIC_UNSUPPORTED_STATEMENT &&
+                 code != DIAGNOSTIC_NESTING_TOO_DEEP &&
+                 code != DIAGNOSTIC_TOKEN_TOO_LONG;
+  if (missing && (token.type == TOKEN_EOF ||
+                  ast_is_statement_keyword(token.type))) {
+    /* The token was either the latest one read or peeked after it. */
+    LexerToken last = ast->last_token;
+    bool read = token.type == last.type && token.offset == last.offset;
+    offset = read ? ast->previous_end : last.offset + last.length;
+    length = 0;
+  }
+
+  diagnostic_list_add(&ast->diagnostics, code, offset, length);
+  return 0;
+}
+
+/**
+ * @brief Pushes a finished node onto the AST's pending stack.
+ *
+ * Children are collected on the pending stack while their parent is being
+ * parsed and moved into one contiguous block by `ast_pop_children` once the
+ * parent is complete, so appending a child is amortized O(1).
+ *
+ * @return 1 on success, 0 if the stack could not be grown.
+ */
+static int ast_push_pending(AST *ast, const ASTNode *node) {
+  if (ast->pending_count == ast->pending_capacity) {
+    size_t capacity = ast->pending_capacity ? ast->pending_capacity * 2 : 64;
+
+    ASTNode *pending =
+        (ASTNode *)realloc(ast->pending, sizeof(ASTNode) * capacity);
+    if (!pending)
+      return 0;
+
+    ast->pending = pending;
+    ast->pending_capacity = capacity;
+  }
+
+  ast->pending[ast->pending_count++] = *node;
+
+  return 1;
+}
+
+/**
+ * @brief Moves the nodes pushed since `base` into the children of `parent`.
+ *
+ * @return 1 on success, 0 if the children could not be allocated.
+ */
+static int ast_pop_children(AST *ast, ASTNode *parent, size_t base) {
+  size_t count = ast->pending_count - base;
+
+  parent->children = NULL;
+  parent->children_count = 0;
+
+  if (count == 0)
+    return 1;
+
+  ASTNode *children =
+      (ASTNode *)arena_alloc(&ast->arena, sizeof(ASTNode) * count);
+  if (!children)
+    return 0;
+
+  memcpy(children, ast->pending + base, sizeof(ASTNode) * count);
+
+  parent->children = children;
+  parent->children_count = count;
+  ast->pending_count = base;
+
+  return 1;
+}
+
+/**
+ * @brief Builds a leaf node for an identifier or literal token.
+ *
+ * @return 1 on success, 0 if the token is not a value or memory ran out.
+ */
+static int ast_parse_value(AST *ast, LexerToken token, ASTNode *node) {
+  memset(node, 0, sizeof(ASTNode));
+
+  switch (token.type) {
+  case TOKEN_IDENTIFIER:
+    if (token.payload == ATOM_INVALID)
+      return 0;
+
+    node->type = NODE_IDENTIFIER;
+    node->data.identifier.atom = token.payload;
+    node->data.identifier.value = atom_text(&ast->atoms, token.payload);
+    return 1;
+
+  case TOKEN_NUMBER:
+    /* The lexer already converted the literal, which is always the latest
+     * token read. */
+    node->type = NODE_LITERAL;
+    node->data.literal.value = value_number(ast->number);
+    return 1;
+
+  case TOKEN_TRUE:
+  case TOKEN_FALSE:
+    node->type = NODE_LITERAL;
+    node->data.literal.value = value_boolean(token.type == TOKEN_TRUE);
+    return 1;
+
+  case TOKEN_NULL:
+    node->type = NODE_LITERAL;
+    node->data.literal.value = value_null();
+    return 1;
+
+  default:
+    return ast_error(ast,
+                     token.type == TOKEN_UNKNOWN
+                         ? DIAGNOSTIC_UNKNOWN_TOKEN
+                         : DIAGNOSTIC_EXPECTED_EXPRESSION,
+                     token);
+  }
+}
+
+/*
+ * How tightly every binary operator binds its left and right operands, 0 for
+ * tokens that are not binary operators. An operator on the operator stack is
+ * applied before pushing the next one when its right power is greater than
+ * the next one's left power: left-associative operators bind their right
+ * operand tighter, right-associative assignment its left one.
+ */
+static const struct {
+  uint8_t left;
+  uint8_t right;
+} binary_powers[TOKEN_UNKNOWN + 1] = {
+    [TOKEN_EQUAL] = {2, 1},   [TOKEN_PLUS] = {3, 4},  [TOKEN_MINUS] = {3, 4},
+    [TOKEN_STAR] = {5, 6},    [TOKEN_SLASH] = {5, 6}, [TOKEN_PERCENT] = {5, 6},
+};
+
+/*
+ * How tightly prefix operators bind their operand: tighter than any binary
+ * operator.
+ */
+#define PREFIX_POWER 7
+
+/**
+ * @brief Tells whether a token is a unary prefix operator.
+ */
+static bool ast_is_prefix_operator(TokenType type) {
+  return type == TOKEN_MINUS || type == TOKEN_PLUS || type == TOKEN_BANG;
+}
+
+/**
+ * @brief Pushes an operator onto the AST's operator stack.
+ *
+ * @return 1 on success, 0 if the stack could not be grown.
+ */
+static int ast_push_operator(AST *ast, LexerToken token, uint8_t power,
+                             bool prefix) {
+  if (ast->operator_count == ast->operator_capacity) {
+    size_t capacity = ast->operator_capacity ? ast->operator_capacity * 2 : 64;
+
+    ASTOperator *operators =
+        (ASTOperator *)realloc(ast->operators, sizeof(ASTOperator) * capacity);
+    if (!operators)
+      return 0;
+
+    ast->operators = operators;
+    ast->operator_capacity = capacity;
+  }
+
+  ast->operators[ast->operator_count++] =
+      (ASTOperator){token.type, power, prefix, token.offset, 0};
+
+  return 1;
+}
+
+/**
+ * @brief Computes an operation on literals at parse time, with the same
+ * semantics as the VM.
+ */
+static Value ast_fold(TokenType operator, bool prefix, Value left,
+                      Value right) {
+  if (prefix) {
+    switch (operator) {
+    case TOKEN_MINUS:
+      return value_number(-value_to_number(left));
+    case TOKEN_BANG:
+      return value_boolean(!value_to_boolean(left));
+    default:
+      return value_number(value_to_number(left));
+    }
+  }
+
+  switch (operator) {
+  case TOKEN_MINUS:
+    return value_subtract(left, right);
+  case TOKEN_STAR:
+    return value_multiply(left, right);
+  case TOKEN_SLASH:
+    return value_divide(left, right);
+  case TOKEN_PERCENT:
+    return value_modulo(left, right);
+  default:
+    return value_add(left, right);
+  }
+}
+
+/**
+ * @brief Applies the operator on top of the operator stack to the operands on
+ * top of the pending stack, replacing them with the resulting node.
+ *
+ * An operation whose operands are all literals is folded into a literal.
+ *
+ * @return 1 on success, 0 if an assignment does not assign to an identifier
+ * or a property, or memory ran out.
+ */
+static int ast_reduce(AST *ast) {
+  ASTOperator op = ast->operators[--ast->operator_count];
+  size_t base = ast->pending_count - (op.prefix ? 1 : 2);
+  const ASTNode *operands = &ast->pending[base];
+
+  ASTNode node;
+  memset(&node, 0, sizeof(ASTNode));
+
+  if (op.operator == TOKEN_EQUAL) {
+    if (operands[0].type != NODE_IDENTIFIER &&
+        operands[0].type != NODE_MEMBER_EXPRESSION) {
+      diagnostic_list_add(&ast->diagnostics, DIAGNOSTIC_INVALID_ASSIGNMENT,
+                          op.offset, 1);
+      return 0;
+    }
+    node.type = NODE_ASSIGNMENT_EXPRESSION;
+  } else if (operands[0].type == NODE_LITERAL &&
+             (op.prefix || operands[1].type == NODE_LITERAL)) {
+    Value left = operands[0].data.literal.value;
+    Value right = op.prefix ? left : operands[1].data.literal.value;
+
+    node.type = NODE_LITERAL;
+    node.data.literal.value = ast_fold(op.operator, op.prefix, left, right);
+    ast->pending_count = base;
+    return ast_push_pending(ast, &node);
+  } else if (op.prefix) {
+    node.type = NODE_UNARY_EXPRESSION;
+    node.data.unary.operator = op.operator;
+  } else {
+    node.type = NODE_BINARY_EXPRESSION;
+    node.data.binary.operator = op.operator;
+  }
+
+  return ast_pop_children(ast, &node, base) && ast_push_pending(ast, &node);
+}
+
+/**
+ * @brief Starts a property of the object literal on top of the operator
+ * stack: reads its name and colon, and pushes the property onto the pending
+ * stack and a `:` group onto the operator stack until its value is parsed.
+ *
+ * @return 1 on success, 0 if the name or colon is missing or memory ran out.
+ */
+static int ast_open_property(AST *ast) {
+  LexerToken name = ast_next_token(ast);
+  if (name.type != TOKEN_IDENTIFIER)
+    return ast_error(ast, DIAGNOSTIC_EXPECTED_PROPERTY_NAME, name);
+  if (name.payload == ATOM_INVALID)
+    return 0;
+
+  LexerToken colon = ast_next_token(ast);
+  if (colon.type != TOKEN_COLON)
+    return ast_error(ast, DIAGNOSTIC_EXPECTED_COLON, colon);
+
+  ASTNode property;
+  memset(&property, 0, sizeof(ASTNode));
+  property.type = NODE_PROPERTY;
+  property.data.property.atom = name.payload;
+  property.data.property.name = atom_text(&ast->atoms, name.payload);
+
+  return ast_push_pending(ast, &property) &&
+         ast_push_operator(ast, colon, 0, false);
+}
+
+/**
+ * @brief Ends the property on top of the operator stack, moving its value
+ * from the top of the pending stack into it.
+ *
+ * @return 1 on success, 0 if memory ran out.
+ */
+static int ast_close_property(AST *ast) {
+  size_t value = ast->pending_count - 1;
+  ASTNode property = ast->pending[value - 1];
+
+  ast->operator_count--;
+  if (!ast_pop_children(ast, &property, value))
+    return 0;
+
+  ast->pending[value - 1] = property;
+  return 1;
+}
+
+/**
+ * @brief Ends the object literal on top of the operator stack, replacing its
+ * properties on the pending stack with the object.
+ *
+ * @return 1 on success, 0 if memory ran out.
+ */
+static int ast_close_object(AST *ast) {
+  ASTNode object;
+  memset(&object, 0, sizeof(ASTNode));
+  object.type = NODE_OBJECT_LITERAL;
+
+  size_t base = ast->operators[--ast->operator_count].base;
+  return ast_pop_children(ast, &object, base) &&
+         ast_push_pending(ast, &object);
+}
+
+/**
+ * @brief Replaces the operand on top of the pending stack with an access to
+ * the property named by the next token.
+ *
+ * @return 1 on success, 0 if the next token is not a property name or memory
+ * ran out.
+ */
+static int ast_parse_member(AST *ast) {
+  LexerToken name = ast_next_token(ast);
+  if (name.type != TOKEN_IDENTIFIER)
+    return ast_error(ast, DIAGNOSTIC_EXPECTED_PROPERTY_NAME, name);
+  if (name.payload == ATOM_INVALID)
+    return 0;
+
+  ASTNode member;
+  memset(&member, 0, sizeof(ASTNode));
+  member.type = NODE_MEMBER_EXPRESSION;
+  member.data.property.atom = name.payload;
+  member.data.property.name = atom_text(&ast->atoms, name.payload);
+
+  return ast_pop_children(ast, &member, ast->pending_count - 1) &&
+         ast_push_pending(ast, &member);
+}
+
+/**
+ * @brief Parses the operators and operands of an expression starting at
+ * `token`, leaving the expression on top of the pending stack.
+ *
+ * This is a table-driven precedence climbing parser that keeps its operators
+ * on the AST's operator stack and its operands on the pending stack instead of
+ * the call stack, so neither long chains nor deeply nested parentheses and
+ * object literals can overflow it. Parentheses, object literals and
+ * properties are groups on the operator stack: the value of a property is
+ * parsed as an operand, and the property is ended where a parenthesis would
+ * be closed.
+ */
+static int ast_parse_operations(AST *ast, LexerToken token) {
+  size_t base = ast->operator_count;
+
+  while (1) {
+    /* Prefix operators, opening parentheses and the starts of properties,
+     * then an operand. */
+    while (ast_is_prefix_operator(token.type) ||
+           token.type == TOKEN_LEFT_PAREN ||
+           (token.type == TOKEN_LEFT_BRACE &&
+            ast_peek_token(ast).type != TOKEN_RIGHT_BRACE)) {
+      bool prefix = ast_is_prefix_operator(token.type);
+      if (!ast_push_operator(ast, token, prefix ? PREFIX_POWER : 0, prefix))
+        return 0;
+      if (token.type == TOKEN_LEFT_BRACE) {
+        ast->operators[ast->operator_count - 1].base = ast->pending_count;
+        if (!ast_open_property(ast))
+          return 0;
+      }
+      token = ast_next_token(ast);
+    }
+
+    if (token.type == TOKEN_LEFT_BRACE) {
+      /* An empty object. */
+      if (!ast_push_operator(ast, token, 0, false))
+        return 0;
+      ast->operators[ast->operator_count - 1].base = ast->pending_count;
+      ast_next_token(ast);
+      if (!ast_close_object(ast))
+        return 0;
+    } else {
+      ASTNode operand;
+      if (!ast_parse_value(ast, token, &operand) ||
+          !ast_push_pending(ast, &operand))
+        return 0;
+    }
+
+    /* Property accesses and closing parentheses, then a binary operator or
+     * the end. */
+    while (1) {
+      LexerToken next = ast_peek_token(ast);
+      uint8_t power = binary_powers[next.type].left;
+
+      if (next.type == TOKEN_DOT) {
+        ast_next_token(ast);
+        if (!ast_parse_member(ast))
+          return 0;
+        continue;
+      }
+
+      if (power > 0) {
+        while (ast->operator_count > base &&
+               ast->operators[ast->operator_count - 1].power > power) {
+          if (!ast_reduce(ast))
+            return 0;
+        }
+
+        if (!ast_push_operator(ast, next, binary_powers[next.type].right,
+                               false))
+          return 0;
+        ast_next_token(ast);
+        break;
+      }
+
+      while (ast->operator_count > base &&
+             ast->operators[ast->operator_count - 1].power > 0) {
+        if (!ast_reduce(ast))
+          return 0;
+      }
+
+      if (ast->operator_count == base)
+        return 1;
+
+      TokenType group = ast->operators[ast->operator_count - 1].operator;
+
+      if (group == TOKEN_LEFT_PAREN) {
+        if (next.type != TOKEN_RIGHT_PAREN)
+          return ast_error(ast, DIAGNOSTIC_EXPECTED_RIGHT_PAREN, next);
+        ast->operator_count--;
+        ast_next_token(ast);
+        continue;
+      }
+
+      /* The value of a property is complete. Properties are separated by
+       * commas, with an optional trailing one. */
+      if (!ast_close_property(ast))
+        return 0;
+
+      if (next.type == TOKEN_COMMA) {
+        ast_next_token(ast);
+        next = ast_peek_token(ast);
+        if (next.type != TOKEN_RIGHT_BRACE) {
+          if (!ast_open_property(ast))
+            return 0;
+          break;
+        }
+      } else if (next.type != TOKEN_RIGHT_BRACE) {
+        return ast_error(ast, DIAGNOSTIC_EXPECTED_COMMA_OR_BRACE, next);
+      }
+
+      ast_next_token(ast);
+      if (!ast_close_object(ast))
+        return 0;
+    }
+
+    token = ast_next_token(ast);
+  }
+}
+
+/**
+ * @brief Parses the expression starting at `token` into `node`.
+ *
+ * @return 1 on success, 0 if the expression could not be parsed.
+ */
+static int ast_parse_expression(AST *ast, LexerToken token, ASTNode *node) {
+  size_t base = ast->pending_count;
+  size_t operator_base = ast->operator_count;
+
+  if (!ast_parse_operations(ast, token)) {
+    ast->pending_count = base;
+    ast->operator_count = operator_base;
+    return 0;
+  }
+
+  *node = ast->pending[base];
+  ast->pending_count = base;
+
+  return 1;
+}
+
+/**
+ * @brief Tells whether a token starts a statement.
+ */
+static bool ast_starts_statement(TokenType type) {
+  switch (type) {
+  case TOKEN_LET:
+  case TOKEN_CONST:
+  case TOKEN_FUNCTION:
+  case TOKEN_IDENTIFIER:
+  case TOKEN_NUMBER:
+  case TOKEN_TRUE:
+  case TOKEN_FALSE:
+  case TOKEN_NULL:
+  case TOKEN_LEFT_PAREN:
+    return true;
+  default:
+    return ast_is_prefix_operator(type);
+  }
+}
+
+/**
+ * @brief Tells whether a token is a keyword that only ever starts a
+ * statement, supported or not, which is where parsing resumes after an error.
+ */
+static bool ast_is_statement_keyword(TokenType type) {
+  switch (type) {
+  case TOKEN_BREAK:
+  case TOKEN_CLASS:
+  case TOKEN_CONST:
+  case TOKEN_CONTINUE:
+  case TOKEN_DEBUGGER:
+  case TOKEN_DO:
+  case TOKEN_EXPORT:
+  case TOKEN_FOR:
+  case TOKEN_FUNCTION:
+  case TOKEN_IF:
+  case TOKEN_IMPORT:
+  case TOKEN_LET:
+  case TOKEN_RETURN:
+  case TOKEN_SWITCH:
+  case TOKEN_THROW:
+  case TOKEN_TRY:
+  case TOKEN_VAR:
+  case TOKEN_WHILE:
+  case TOKEN_WITH:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static int ast_parse_statement_into(AST *ast, LexerToken token,
+                                    ASTNode *stmt);
+
+static void ast_recover(AST *ast, size_t index, LexerToken start,
+                        size_t depth, bool block);
+
+/**
+ * @brief Parses statements onto the pending stack up to the brace closing the
+ * current block, which is consumed.
+ *
+ * A statement with a syntax error is recorded in the diagnostics and skipped,
+ * as at the top level, and so is a statement that holds one in a nested
+ * function.
+ *
+ * @return 1 once the block is closed, 0 if memory ran out or the end of the
+ * program was reached first.
+ */
+static int ast_parse_block(AST *ast) {
+  while (1) {
+    size_t index = ast->cursor.index;
+    size_t depth = ast->depth;
+    LexerToken token = ast_next_token(ast);
+
+    if (token.type == TOKEN_EOF)
+      return ast_error(ast, DIAGNOSTIC_EXPECTED_RIGHT_BRACE, token);
+    if (token.type == TOKEN_RIGHT_BRACE)
+      return 1;
+
+    size_t reported = ast->diagnostics.count;
+    ASTNode stmt;
+
+    if (ast_parse_statement_into(ast, token, &stmt)) {
+      if (ast->diagnostics.count == reported && !ast_push_pending(ast, &stmt))
+        return 0;
+      continue;
+    }
+
+    /* Syntax errors always leave a diagnostic behind. */
+    if (ast->diagnostics.count == reported)
+      return 0;
+
+    /* The block is not closed, which the error already accounts for. */
+    ast_recover(ast, index, token, depth, true);
+    if (ast_peek_token(ast).type == TOKEN_EOF)
+      return 0;
+  }
+}
+
+/**
+ * @brief Tells whether a token can start an operand, prefix operators
+ * included.
+ */
+static bool ast_starts_operand(TokenType type) {
+  switch (type) {
+  case TOKEN_IDENTIFIER:
+  case TOKEN_NUMBER:
+  case TOKEN_TRUE:
+  case TOKEN_FALSE:
+  case TOKEN_NULL:
+  case TOKEN_LEFT_PAREN:
+  case TOKEN_LEFT_BRACE:
+    return true;
+  default:
+    return ast_is_prefix_operator(type);
+  }
+}
+
+/**
+ * @brief Records a syntax error found while pre-parsing a body at token
+ * `index`, located as if the body had been read up to it.
+ *
+ * @return 0.
+ */
+static int ast_reject_body(AST *ast, size_t base, size_t index,
+                           DiagnosticCode code) {
+  ast->operator_count = base;
+  ast->last_token = token_array_at(&ast->tokens, index - 1);
+  return ast_error(ast, code, token_array_at(&ast->tokens, index));
+}
+
+/**
+ * @brief Finds the brace closing the block whose first token is `first`,
+ * without building anything.
+ *
+ * Only errors visible from two neighbouring tokens are looked for: unknown
+ * tokens and unsupported keywords, parentheses and braces that do not match,
+ * a missing name after `let`, `const`, `function` or `.`, and a missing
+ * operand after an operator, `=`, `:` or `(`. The open parentheses and braces
+ * are kept on the operator stack.
+ *
+ * @return 1 with the index of the closing brace in `end`, 0 if an error was
+ * recorded or memory ran out.
+ */
+static int ast_match_brace(AST *ast, size_t first, size_t *end) {
+  const uint8_t *types = ast->tokens.types;
+  size_t base = ast->operator_count;
+  TokenType previous = TOKEN_LEFT_BRACE;
+
+  for (size_t i = first;; i++) {
+    TokenType type = types[i];
+
+    if (previous == TOKEN_LET || previous == TOKEN_CONST ||
+        previous == TOKEN_FUNCTION) {
+      if (type != TOKEN_IDENTIFIER)
+        return ast_reject_body(ast, base, i, DIAGNOSTIC_EXPECTED_IDENTIFIER);
+    } else if (previous == TOKEN_DOT) {
+      if (type != TOKEN_IDENTIFIER)
+        return ast_reject_body(ast, base, i,
+                               DIAGNOSTIC_EXPECTED_PROPERTY_NAME);
+    } else if (binary_powers[previous].left > 0 ||
+               ast_is_prefix_operator(previous) || previous == TOKEN_COLON ||
+               previous == TOKEN_LEFT_PAREN) {
+      /* The parameters of a function may be empty. */
+      bool parameters = previous == TOKEN_LEFT_PAREN && i >= first + 2 &&
+                        types[i - 2] == TOKEN_IDENTIFIER &&
+                        types[i - 3] == TOKEN_FUNCTION;
+      if (!ast_starts_operand(type) &&
+          !(parameters && type == TOKEN_RIGHT_PAREN))
+        return ast_reject_body(ast, base, i, DIAGNOSTIC_EXPECTED_EXPRESSION);
+    }
+
+    switch (type) {
+    case TOKEN_EOF:
+      return ast_reject_body(ast, base, i, DIAGNOSTIC_EXPECTED_RIGHT_BRACE);
+
+    case TOKEN_UNKNOWN:
+      return ast_reject_body(ast, base, i, DIAGNOSTIC_UNKNOWN_TOKEN);
+
+    case TOKEN_LEFT_PAREN:
+    case TOKEN_LEFT_BRACE:
+      if (!ast_push_operator(ast, token_array_at(&ast->tokens, i), 0, false)) {
+        ast->operator_count = base;
+        return 0;
+      }
+      break;
+
+    case TOKEN_RIGHT_PAREN:
+      if (ast->operator_count == base ||
+          ast->operators[ast->operator_count - 1].operator !=
+              TOKEN_LEFT_PAREN)
+        return ast_reject_body(ast, base, i,
+                               DIAGNOSTIC_UNSUPPORTED_STATEMENT);
+      ast->operator_count--;
+      break;
+
+    case TOKEN_RIGHT_BRACE:
+      if (ast->operator_count == base) {
+        *end = i;
+        return 1;
+      }
+      if (ast->operators[ast->operator_count - 1].operator != TOKEN_LEFT_BRACE)
+        return ast_reject_body(ast, base, i, DIAGNOSTIC_EXPECTED_RIGHT_PAREN);
+      ast->operator_count--;
+      break;
+
+    default:
+      /* Keywords the parser supports all start statements. */
+      if (type >= TOKEN_AWAIT && type <= TOKEN_YIELD &&
+          !ast_starts_statement(type))
+        return ast_reject_body(ast, base, i,
+                               DIAGNOSTIC_UNSUPPORTED_STATEMENT);
+      break;
+    }
+
+    previous = type;
+  }
+}
+
+/**
+ * @brief Parses the body of a function, after its opening brace, into `body`.
+ *
+ * The body of a top-level function is only pre-parsed when the AST asks for
+ * lazy functions: its braces are matched over the token types, checking what
+ * neighbouring tokens tell, and its tokens recorded, leaving the statements
+ * to `ast_parse_function_body`.
+ *
+ * @return 1 on success, 0 if the body could not be parsed.
+ */
+static int ast_parse_body(AST *ast, ASTNode *body) {
+  memset(body, 0, sizeof(ASTNode));
+  body->type = NODE_FUNCTION_BODY;
+
+  size_t first = ast->cursor.index;
+
+  if (ast->lazy_functions && !ast->lexer && ast->function_depth == 0) {
+    size_t end;
+    if (!ast_match_brace(ast, first, &end))
+      return 0;
+
+    body->data.body.first = first;
+    body->data.body.end = end;
+    ast->cursor.index = end + 1;
+    ast->depth--;
+    return 1;
+  }
+
+  size_t base = ast->pending_count;
 
-  ast->root.type = 0;
-  memset(&ast->root.data, 0, sizeof(ASTNodeData));
+  ast->function_depth++;
+  int parsed = ast_parse_block(ast);
+  ast->function_depth--;
 
-  return AST_INIT_OK;
+  if (!parsed || !ast_pop_children(ast, body, base)) {
+    ast->pending_count = base;
+    return 0;
+  }
+
+  if (!ast->lexer) {
+    body->data.body.first = first;
+    body->data.body.end = ast->cursor.index - 1;
+  }
+  body->data.body.parsed = true;
+
+  return 1;
 }
 
 /**
- * @brief Frees the memory allocated for the AST structure and its internal
- * components.
+ * @brief Parses a function declaration, after its `function` keyword, into
+ * `stmt`.
  *
- * This function frees the memory used by the AST, including the lexer and other
- * dynamically allocated structures.
+ * @return 1 on success, 0 if the function could not be parsed.
+ */
+static int ast_parse_function(AST *ast, ASTNode *stmt) {
+  LexerToken name = ast_next_token(ast);
+  if (name.type != TOKEN_IDENTIFIER)
+    return ast_error(ast, DIAGNOSTIC_EXPECTED_IDENTIFIER, name);
+  if (name.payload == ATOM_INVALID)
+    return 0;
+
+  stmt->type = NODE_FUNCTION_DECLARATION;
+  stmt->data.function.atom = name.payload;
+  stmt->data.function.name = atom_text(&ast->atoms, name.payload);
+
+  LexerToken token = ast_next_token(ast);
+  if (token.type != TOKEN_LEFT_PAREN)
+    return ast_error(ast, DIAGNOSTIC_EXPECTED_LEFT_PAREN, token);
+
+  size_t base = ast->pending_count;
+  token = ast_next_token(ast);
+
+  /* Parameters: identifiers separated by commas. */
+  while (token.type != TOKEN_RIGHT_PAREN) {
+    if (token.type != TOKEN_IDENTIFIER) {
+      ast->pending_count = base;
+      return ast_error(ast, DIAGNOSTIC_EXPECTED_IDENTIFIER, token);
+    }
+
+    ASTNode parameter;
+    if (!ast_parse_value(ast, token, &parameter) ||
+        !ast_push_pending(ast, &parameter)) {
+      ast->pending_count = base;
+      return 0;
+    }
+
+    token = ast_next_token(ast);
+    if (token.type == TOKEN_COMMA) {
+      token = ast_next_token(ast);
+      if (token.type == TOKEN_RIGHT_PAREN) {
+        ast->pending_count = base;
+        return ast_error(ast, DIAGNOSTIC_EXPECTED_IDENTIFIER, token);
+      }
+    } else if (token.type != TOKEN_RIGHT_PAREN) {
+      ast->pending_count = base;
+      return ast_error(ast, DIAGNOSTIC_EXPECTED_COMMA_OR_PAREN, token);
+    }
+  }
+
+  token = ast_next_token(ast);
+  if (token.type != TOKEN_LEFT_BRACE) {
+    ast->pending_count = base;
+    return ast_error(ast, DIAGNOSTIC_EXPECTED_LEFT_BRACE, token);
+  }
+
+  if (ast->function_depth >= AST_MAX_FUNCTION_DEPTH) {
+    ast->pending_count = base;
+    return ast_error(ast, DIAGNOSTIC_NESTING_TOO_DEEP, name);
+  }
+
+  ASTNode body;
+  if (!ast_parse_body(ast, &body) || !ast_push_pending(ast, &body)) {
+    ast->pending_count = base;
+    return 0;
+  }
+
+  return ast_pop_children(ast, stmt, base);
+}
+
+/**
+ * @brief Parses the statement starting at `token` into `stmt`.
  *
- * @param ast A pointer to the AST to free.
+ * @return 1 on success, 0 if the statement could not be parsed.
  */
-void free_ast(AST *ast) {
-  if (!ast)
-    return;
+static int ast_parse_statement_into(AST *ast, LexerToken token,
+                                    ASTNode *stmt) {
+  memset(stmt, 0, sizeof(ASTNode));
 
-  if (ast->lexer) {
-    free_lexer(ast->lexer);
+  switch (token.type) {
+  case TOKEN_LET:
+  case TOKEN_CONST: {
+    LexerToken name = ast_next_token(ast);
+    if (name.type != TOKEN_IDENTIFIER) {
+      return ast_error(ast, DIAGNOSTIC_EXPECTED_IDENTIFIER, name);
+    }
+
+    if (name.payload == ATOM_INVALID)
+      return 0;
+
+    stmt->type = NODE_VARIABLE_DECLARATION;
+    stmt->data.declaration.atom = name.payload;
+    stmt->data.declaration.name = atom_text(&ast->atoms, name.payload);
+    stmt->data.declaration.constant = token.type == TOKEN_CONST;
+
+    /* A constant must be initialized. */
+    if (ast_peek_token(ast).type != TOKEN_EQUAL) {
+      return token.type == TOKEN_LET ||
+             ast_error(ast, DIAGNOSTIC_MISSING_INITIALIZER, name);
+    }
+
+    ast_next_token(ast);
+
+    size_t base = ast->pending_count;
+    ASTNode init;
+    if (!ast_parse_expression(ast, ast_next_token(ast), &init) ||
+        !ast_push_pending(ast, &init)) {
+      ast->pending_count = base;
+      return 0;
+    }
+
+    return ast_pop_children(ast, stmt, base);
+  }
+
+  case TOKEN_FUNCTION:
+    return ast_parse_function(ast, stmt);
+
+  default: {
+    if (token.type == TOKEN_UNKNOWN)
+      return ast_error(ast, DIAGNOSTIC_UNKNOWN_TOKEN, token);
+    if (!ast_starts_statement(token.type))
+      return ast_error(ast, DIAGNOSTIC_UNSUPPORTED_STATEMENT, token);
+
+    stmt->type = NODE_EXPRESSION_STATEMENT;
+
+    size_t base = ast->pending_count;
+    ASTNode expression;
+    if (!ast_parse_expression(ast, token, &expression) ||
+        !ast_push_pending(ast, &expression)) {
+      ast->pending_count = base;
+      return 0;
+    }
+
+    return ast_pop_children(ast, stmt, base);
+  }
+  }
+}
+
+/*
+ * The top-level statements of a previous parse, and how the indices of its
+ * tokens map to the edited tokens: token `k >= new_end` of the edited array
+ * is token `k - new_end + old_end` of the previous one.
+ */
+typedef struct {
+  const ASTNode *statements;
+  const ASTTokenRange *ranges;
+  size_t count;
+  size_t stop;
+  size_t old_end;
+  size_t new_end;
+} ASTResync;
+
+/*
+ * Why `ast_parse_statements` returned.
+ */
+typedef enum {
+  AST_STOP_END,    /* The end of the program. */
+  AST_STOP_RESYNC, /* Back in step with the previous parse. */
+  AST_STOP_MEMORY  /* Memory ran out. */
+} ASTStop;
+
+/**
+ * @brief Records the token range of a top-level statement.
+ *
+ * @return 1 on success, 0 if the ranges could not be grown.
+ */
+static int ast_push_range(AST *ast, size_t first, size_t end) {
+  if (ast->range_count == ast->range_capacity) {
+    size_t capacity = ast->range_capacity ? ast->range_capacity * 2 : 64;
+
+    ASTTokenRange *ranges =
+        (ASTTokenRange *)realloc(ast->ranges, sizeof(ASTTokenRange) * capacity);
+    if (!ranges)
+      return 0;
+
+    ast->ranges = ranges;
+    ast->range_capacity = capacity;
+  }
+
+  ast->ranges[ast->range_count++] = (ASTTokenRange){first, end};
+
+  return 1;
+}
+
+/**
+ * @brief Returns the index of the first statement starting at or after token
+ * `index`.
+ */
+static size_t ast_find_statement(const ASTTokenRange *ranges, size_t count,
+                                 size_t index) {
+  size_t low = 0;
+  size_t high = count;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (ranges[middle].first < index) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+/**
+ * @brief Skips the rest of a statement with a syntax error, up to the next
+ * statement keyword from where the error was reported, or in a block up to
+ * the brace closing it. Braces opened on the way are skipped along with their
+ * contents.
+ *
+ * The parser may have read past the token of the error before failing, so
+ * the statement is read again from its first token: by index from a token
+ * array, and by moving the tokenizer back when that token is still in its
+ * window. Otherwise the tokenizer is only moved back to a statement keyword
+ * the error was found at.
+ *
+ * @param index Index of the first token of the statement in a token array.
+ * @param start The first token of the statement.
+ * @param depth Brace depth before the first token of the statement.
+ * @param block Whether the statement is inside a block.
+ */
+static void ast_recover(AST *ast, size_t index, LexerToken start,
+                        size_t depth, bool block) {
+  size_t offset = ast->diagnostics.items[ast->diagnostics.count - 1].offset;
+  bool rewound = !ast->lexer;
+
+  if (!ast->lexer) {
+    ast->cursor.index = index;
+  } else {
+    Tokenizer *tokenizer = ast->lexer->tokenizer;
+
+    if (start.offset >= tokenizer->base) {
+      tokenizer->position = start.offset - tokenizer->base;
+      rewound = true;
+    } else if (ast_is_statement_keyword(ast->last_token.type) &&
+               ast->last_token.offset >= offset &&
+               ast->last_token.offset >= tokenizer->base) {
+      /* The error was found at the start of the next statement, which must
+       * not be skipped. */
+      tokenizer->position = ast->last_token.offset - tokenizer->base;
+    }
+  }
+
+  if (rewound) {
+    ast->depth = depth;
+    ast_next_token(ast);
+
+    while (1) {
+      LexerToken token = ast_peek_token(ast);
+      if (token.type == TOKEN_EOF || token.offset >= offset)
+        break;
+      ast_next_token(ast);
+    }
+  }
+
+  while (1) {
+    TokenType type = ast_peek_token(ast).type;
+    if (type == TOKEN_EOF)
+      return;
+    if (ast->depth <= depth &&
+        (ast_is_statement_keyword(type) ||
+         (block && type == TOKEN_RIGHT_BRACE)))
+      return;
+
+    ast_next_token(ast);
+  }
+}
+
+/**
+ * @brief Parses top-level statements onto the pending stack until the end of
+ * the program.
+ *
+ * When parsing from tokens the range of every statement is recorded. With
+ * `resync`, parsing also stops at the first position past the edited tokens
+ * where the previous parse was between two statements: from there on it would
+ * build the same statements again. Only positions up to the first error of the
+ * previous parse qualify, since past it the previous parse may have been
+ * skipping tokens.
+ *
+ * A statement with a syntax error is recorded in the diagnostics and skipped.
+ *
+ * @return Why parsing stopped; on `AST_STOP_RESYNC`, the index of the first
+ * previous statement to reuse is stored in `resumed`.
+ */
+static ASTStop ast_parse_statements(AST *ast, const ASTResync *resync,
+                                    size_t *resumed) {
+  while (1) {
+    size_t index = ast->cursor.index;
+
+    if (resync && index >= resync->new_end) {
+      size_t old_index = index - resync->new_end + resync->old_end;
+      size_t next =
+          ast_find_statement(resync->ranges, resync->count, old_index);
+
+      if (old_index <= resync->stop &&
+          (next == 0 || resync->ranges[next - 1].end <= old_index)) {
+        *resumed = next;
+        return AST_STOP_RESYNC;
+      }
+    }
+
+    size_t depth = ast->depth;
+    LexerToken token = ast_next_token(ast);
+
+    if (token.type == TOKEN_EOF) {
+      /* A lexer that failed ends early, maybe in the middle of a statement
+       * that already reported a token too long to be read. */
+      TokenizerError error =
+          ast->lexer ? lexer_error(ast->lexer) : TOKENIZER_OK;
+      if (error == TOKENIZER_ERROR_TOKEN_TOO_LONG &&
+          (ast->diagnostics.count == 0 ||
+           ast->diagnostics.items[ast->diagnostics.count - 1].code !=
+               DIAGNOSTIC_TOKEN_TOO_LONG))
+        ast_error(ast, DIAGNOSTIC_TOKEN_TOO_LONG, token);
+      else if (error == TOKENIZER_ERROR_MEMORY_ALLOCATION)
+        return AST_STOP_MEMORY;
+      if (ast->diagnostics.count == 0)
+        ast->stop = index;
+      return AST_STOP_END;
+    }
+
+    size_t reported = ast->diagnostics.count;
+    ASTNode stmt;
+
+    if (ast_parse_statement_into(ast, token, &stmt)) {
+      if (ast->diagnostics.count == reported) {
+        if (!ast_push_pending(ast, &stmt) ||
+            (!ast->lexer && !ast_push_range(ast, index, ast->cursor.index)))
+          return AST_STOP_MEMORY;
+        continue;
+      }
+    } else {
+      /* Syntax errors always leave a diagnostic behind. */
+      if (ast->diagnostics.count == reported)
+        return AST_STOP_MEMORY;
+
+      ast_recover(ast, index, token, depth, false);
+    }
+
+    /* The statement has an error, possibly in a function it declares whose
+     * body recovered from it. */
+    if (reported == 0)
+      ast->stop = index;
   }
 }
 
@@ -66,35 +1369,215 @@ void free_ast(AST *ast) {
  * @return A pointer to the root `ASTNode` representing the program.
  */
 ASTNode *ast_parse_program(AST *ast) {
-  ASTNode *program = (ASTNode *)malloc(sizeof(ASTNode));
+  ASTNode *program = ast_new_node(ast, NODE_SOURCE_FILE);
   if (!program)
     return NULL;
 
-  program->type = NODE_SOURCE_FILE;
-  program->children = NULL;
-  program->children_count = 0;
+  /* The cursor refers to the AST's own tokens, which may have moved with it
+   * since initialization. */
+  ast->cursor.array = &ast->tokens;
+  ast->range_count = 0;
+  ast->depth = 0;
+  ast->diagnostics.count = 0;
 
-  while (1) {
-    LexerToken token = next_lexical_token(ast->lexer);
+  size_t base = ast->pending_count;
+  if (ast_parse_statements(ast, NULL, NULL) == AST_STOP_MEMORY ||
+      !ast_pop_children(ast, program, base)) {
+    ast->pending_count = base;
+    return NULL;
+  }
 
-    if (token.type == TOKEN_EOF || token.type == TOKEN_UNKNOWN) {
-      break;
+  return program;
+}
+
+/**
+ * @brief Moves the recorded tokens of a reused top-level function by `delta`
+ * tokens, which wraps around for a negative shift.
+ */
+static void ast_shift_body(const ASTNode *stmt, size_t delta) {
+  if (stmt->type != NODE_FUNCTION_DECLARATION)
+    return;
+
+  ASTNode *body = &stmt->children[stmt->children_count - 1];
+  body->data.body.first += delta;
+  body->data.body.end += delta;
+}
+
+/**
+ * @brief Updates a program after an edit of its source.
+ *
+ * The statements before the edit and after the point where parsing resyncs are
+ * copied by value, so their subtrees are shared with the previous tree. The
+ * only work proportional to the size of the file is copying top-level nodes
+ * and ranges and shifting the tokens that follow the edit, all plain memory
+ * moves.
+ *
+ * The diagnostics follow the statements: those found before the kept
+ * statements are kept, and when parsing resyncs, those of the reused
+ * statements are moved like their tokens.
+ */
+ASTNode *ast_reparse(AST *ast, ASTNode *program, const Source *source,
+                     const SourceEdit *edit) {
+  if (!ast || !program || !source || !edit || ast->lexer ||
+      program->children_count != ast->range_count) {
+    return NULL;
+  }
+
+  TokenArrayChange change;
+  if (relex_token_array(source, &ast->atoms, edit, &ast->tokens, &change) !=
+      TOKEN_ARRAY_OK) {
+    return NULL;
+  }
+
+  ast->cursor.array = &ast->tokens;
+
+  ASTResync resync = {.statements = program->children,
+                      .ranges = ast->ranges,
+                      .count = ast->range_count,
+                      .stop = ast->stop,
+                      .old_end = change.old_end,
+                      .new_end = change.new_end};
+
+  ast->ranges = NULL;
+  ast->range_count = 0;
+  ast->range_capacity = 0;
+
+  /* A statement is kept if neither its tokens nor the token it peeked at
+   * changed. */
+  size_t kept = 0;
+  while (kept < resync.count && resync.ranges[kept].end < change.first) {
+    kept++;
+  }
+
+  size_t base = ast->pending_count;
+  bool ok = true;
+
+  for (size_t i = 0; ok && i < kept; i++) {
+    ok = ast_push_pending(ast, &resync.statements[i]) &&
+         ast_push_range(ast, resync.ranges[i].first, resync.ranges[i].end);
+  }
+
+  ast->cursor.index = kept > 0 ? resync.ranges[kept - 1].end : 0;
+  ast->depth = 0;
+
+  /* Diagnostics are in source order, so those found before the first token
+   * parsed again come first. */
+  DiagnosticList previous = ast->diagnostics;
+  init_diagnostic_list(&ast->diagnostics);
+
+  size_t restart = ast->tokens.offsets[ast->cursor.index];
+  size_t reported = 0;
+
+  while (ok && reported < previous.count &&
+         previous.items[reported].offset < restart) {
+    const Diagnostic *diagnostic = &previous.items[reported++];
+    ok = diagnostic_list_add(&ast->diagnostics, diagnostic->code,
+                             diagnostic->offset, diagnostic->length);
+  }
+
+  size_t resumed = 0;
+  ASTStop stop =
+      ok ? ast_parse_statements(ast, &resync, &resumed) : AST_STOP_MEMORY;
+
+  if (stop == AST_STOP_RESYNC) {
+    for (size_t i = resumed; ok && i < resync.count; i++) {
+      ast_shift_body(&resync.statements[i], change.new_end - change.old_end);
+      ok = ast_push_pending(ast, &resync.statements[i]) &&
+           ast_push_range(
+               ast, resync.ranges[i].first - change.old_end + change.new_end,
+               resync.ranges[i].end - change.old_end + change.new_end);
     }
 
-    if (token.type == TOKEN_LET) {
-      ASTNode *stmt = ast_parse_statement(ast, token);
-      if (!stmt)
-        break;
+    /* Parsing only resyncs before the first error of the previous parse, so
+     * every previous diagnostic belongs to the reused statements. */
+    if (ast->diagnostics.count == 0)
+      ast->stop = resync.stop - change.old_end + change.new_end;
 
-      program->children = realloc(
-          program->children, sizeof(ASTNode *) * (program->children_count + 1));
-      program->children[program->children_count++] = stmt;
+    size_t delta = edit->inserted - edit->removed;
+    for (size_t i = reported; ok && i < previous.count; i++) {
+      ok = diagnostic_list_add(&ast->diagnostics, previous.items[i].code,
+                               previous.items[i].offset + delta,
+                               previous.items[i].length);
     }
   }
 
+  free((void *)resync.ranges);
+  free_diagnostic_list(&previous);
+
+  if (!ok || stop == AST_STOP_MEMORY ||
+      !ast_pop_children(ast, program, base)) {
+    ast->pending_count = base;
+    return NULL;
+  }
+
   return program;
 }
 
+/**
+ * @brief Builds the statements of a pre-parsed function body.
+ *
+ * The cursor is moved to the recorded tokens of the body and put back once
+ * the statements are built, so this can run at any time after parsing.
+ */
+ASTBodyError ast_parse_function_body(AST *ast, ASTNode *function) {
+  if (!ast || !function || function->type != NODE_FUNCTION_DECLARATION ||
+      function->children_count == 0) {
+    return AST_BODY_ERROR_INVALID;
+  }
+
+  ast->body_diagnostics.count = 0;
+
+  ASTNode *body = &function->children[function->children_count - 1];
+  if (body->data.body.parsed)
+    return AST_BODY_OK;
+
+  if (ast->lexer)
+    return AST_BODY_ERROR_INVALID;
+
+  size_t index = ast->cursor.index;
+  size_t depth = ast->depth;
+  size_t base = ast->pending_count;
+  size_t reported = ast->diagnostics.count;
+
+  ast->cursor.array = &ast->tokens;
+  ast->cursor.index = body->data.body.first;
+  ast->depth = 0;
+
+  ast->function_depth++;
+  int parsed = ast_parse_block(ast);
+  ast->function_depth--;
+
+  ast->cursor.index = index;
+  ast->depth = depth;
+
+  /* The diagnostics of the program describe it as parsed: those of the body
+   * are moved apart. */
+  size_t found = ast->diagnostics.count - reported;
+  ast->diagnostics.count = reported;
+  for (size_t i = 0; i < found; i++) {
+    const Diagnostic *diagnostic = &ast->diagnostics.items[reported + i];
+    if (!diagnostic_list_add(&ast->body_diagnostics, diagnostic->code,
+                             diagnostic->offset, diagnostic->length)) {
+      ast->pending_count = base;
+      return AST_BODY_ERROR_MEMORY;
+    }
+  }
+
+  if (found > 0 || !parsed) {
+    ast->pending_count = base;
+    return found > 0 ? AST_BODY_ERROR_SYNTAX : AST_BODY_ERROR_MEMORY;
+  }
+
+  if (!ast_pop_children(ast, body, base)) {
+    ast->pending_count = base;
+    return AST_BODY_ERROR_MEMORY;
+  }
+
+  body->data.body.parsed = true;
+
+  return AST_BODY_OK;
+}
+
 /**
  * @brief Parses a statement and creates an AST node for it.
  *
@@ -107,55 +1590,156 @@ ASTNode *ast_parse_program(AST *ast) {
  * if parsing fails.
  */
 ASTNode *ast_parse_statement(AST *ast, LexerToken token) {
-  ASTNode *stmt = (ASTNode *)malloc(sizeof(ASTNode));
+  ASTNode *stmt = (ASTNode *)arena_alloc(&ast->arena, sizeof(ASTNode));
   if (!stmt)
     return NULL;
 
-  stmt->children = NULL;
-  stmt->children_count = 0;
-
-  switch (token.type) {
-  case TOKEN_LET: {
-    stmt->type = NODE_VARIABLE_DECLARATION;
-    break;
-  }
-
-  default:
-    free(stmt);
+  if (!ast_parse_statement_into(ast, token, stmt))
     return NULL;
-  }
+
   return stmt;
 }
 
 /**
- * @brief Prints the contents of an AST node for debugging purposes.
- *
- * This function recursively prints the structure of the AST node, including its
- * type and relevant data. It is useful for inspecting the AST and debugging the
- * program's structure.
- *
- * @param node A pointer to the AST node to print.
+ * @brief Returns the text of an operator token.
  */
-void ast_node_print(ASTNode *node) {
-  if (node == NULL) {
-    return;
+static const char *ast_operator_text(TokenType operator) {
+  switch (operator) {
+  case TOKEN_PLUS:
+    return "+";
+  case TOKEN_MINUS:
+    return "-";
+  case TOKEN_STAR:
+    return "*";
+  case TOKEN_SLASH:
+    return "/";
+  case TOKEN_PERCENT:
+    return "%";
+  case TOKEN_BANG:
+    return "!";
+  default:
+    return "?";
   }
+}
 
+/**
+ * @brief Prints the type and data of a single node.
+ */
+static void ast_print_one(const ASTNode *node) {
   switch (node->type) {
   case NODE_SOURCE_FILE:
     printf("SOURCE NODE\n");
     break;
 
   case NODE_VARIABLE_DECLARATION:
-    printf("declaration: \n");
+    printf("%s: %s\n",
+           node->data.declaration.constant ? "constant" : "declaration",
+           node->data.declaration.name);
+    break;
+
+  case NODE_IDENTIFIER:
+    printf("identifier: %s\n", node->data.identifier.value);
+    break;
+
+  case NODE_LITERAL:
+    printf("literal: ");
+    value_print(node->data.literal.value);
+    printf("\n");
+    break;
+
+  case NODE_BINARY_EXPRESSION:
+    printf("binary: %s\n", ast_operator_text(node->data.binary.operator));
+    break;
+
+  case NODE_UNARY_EXPRESSION:
+    printf("unary: %s\n", ast_operator_text(node->data.unary.operator));
+    break;
+
+  case NODE_ASSIGNMENT_EXPRESSION:
+    printf("assignment\n");
+    break;
+
+  case NODE_EXPRESSION_STATEMENT:
+    printf("expression\n");
+    break;
+
+  case NODE_OBJECT_LITERAL:
+    printf("object\n");
+    break;
+
+  case NODE_PROPERTY:
+    printf("property: %s\n", node->data.property.name);
+    break;
+
+  case NODE_MEMBER_EXPRESSION:
+    printf("member: %s\n", node->data.property.name);
+    break;
+
+  case NODE_FUNCTION_DECLARATION:
+    printf("function: %s\n", node->data.function.name);
+    break;
+
+  case NODE_FUNCTION_BODY:
+    if (node->data.body.parsed) {
+      printf("body\n");
+    } else {
+      printf("body: not parsed (tokens %zu-%zu)\n", node->data.body.first,
+             node->data.body.end);
+    }
     break;
 
   default:
     printf("Unknown Node Type\n");
     break;
   }
+}
+
+/**
+ * @brief Prints the contents of an AST node for debugging purposes.
+ *
+ * This function prints the structure of the AST node, including its type and
+ * relevant data, followed by its descendants in source order. Nodes are
+ * visited from an explicit stack, so trees of any depth can be printed. It is
+ * useful for inspecting the AST and debugging the program's structure.
+ *
+ * @param node A pointer to the AST node to print.
+ */
+void ast_node_print(ASTNode *node) {
+  if (node == NULL) {
+    return;
+  }
+
+  const ASTNode *current = node;
+  const ASTNode **stack = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+
+  while (1) {
+    ast_print_one(current);
+
+    if (count + current->children_count > capacity) {
+      size_t grown = capacity ? capacity : 64;
+      while (grown < count + current->children_count)
+        grown *= 2;
 
-  for (size_t i = 0; i < node->children_count; i++) {
-    ast_node_print(node->children[i]);
+      const ASTNode **nodes =
+          (const ASTNode **)realloc(stack, sizeof(ASTNode *) * grown);
+      if (!nodes)
+        break;
+
+      stack = nodes;
+      capacity = grown;
+    }
+
+    /* Pushed in reverse, so that they are printed in source order. */
+    for (size_t i = current->children_count; i > 0; i--) {
+      stack[count++] = &current->children[i - 1];
+    }
+
+    if (count == 0)
+      break;
+    current = stack[--count];
   }
+
+  free(stack);
 }
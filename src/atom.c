@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/atom.h"
+
+/*
+ * Helper function hashing a name with FNV-1a.
+ */
+static inline uint32_t atom_hash(const char *text, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)text[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Initializes an empty atom table.
+ *
+ * @param table A pointer to the AtomTable to initialize.
+ */
+void init_atom_table(AtomTable *table) {
+  if (!table)
+    return;
+
+  memset(table, 0, sizeof(AtomTable));
+  init_arena(&table->arena);
+}
+
+/**
+ * Releases the names, entries and slots of an atom table.
+ *
+ * @param table A pointer to the AtomTable to free.
+ */
+void free_atom_table(AtomTable *table) {
+  if (!table)
+    return;
+
+  free_arena(&table->arena);
+  free(table->entries);
+  free(table->slots);
+
+  init_atom_table(table);
+}
+
+/*
+ * Helper function doubling the slots of a table and reinserting every atom.
+ */
+static int atom_grow_slots(AtomTable *table) {
+  uint32_t slot_count = table->slot_count ? table->slot_count * 2 : 256;
+  uint32_t *slots = (uint32_t *)calloc(slot_count, sizeof(uint32_t));
+  if (!slots)
+    return 0;
+
+  uint32_t mask = slot_count - 1;
+  for (uint32_t atom = 0; atom < table->count; atom++) {
+    uint32_t index = table->entries[atom].hash & mask;
+    while (slots[index] != 0) {
+      index = (index + 1) & mask;
+    }
+    slots[index] = atom + 1;
+  }
+
+  free(table->slots);
+  table->slots = slots;
+  table->slot_count = slot_count;
+
+  return 1;
+}
+
+/**
+ * Returns the atom of a name, interning it on first sight.
+ */
+Atom atom_intern(AtomTable *table, const char *text, size_t length) {
+  if (length > UINT32_MAX)
+    return ATOM_INVALID;
+
+  if (2 * (table->count + 1) > table->slot_count && !atom_grow_slots(table))
+    return ATOM_INVALID;
+
+  uint32_t hash = atom_hash(text, length);
+  uint32_t mask = table->slot_count - 1;
+  uint32_t index = hash & mask;
+
+  while (table->slots[index] != 0) {
+    const AtomEntry *entry = &table->entries[table->slots[index] - 1];
+    if (entry->hash == hash && entry->length == length &&
+        memcmp(entry->text, text, length) == 0) {
+      return table->slots[index] - 1;
+    }
+    index = (index + 1) & mask;
+  }
+
+  if (table->count == table->capacity) {
+    uint32_t capacity = table->capacity ? table->capacity * 2 : 128;
+    AtomEntry *entries =
+        (AtomEntry *)realloc(table->entries, sizeof(AtomEntry) * capacity);
+    if (!entries)
+      return ATOM_INVALID;
+
+    table->entries = entries;
+    table->capacity = capacity;
+  }
+
+  char *copy = arena_strndup(&table->arena, text, length);
+  if (!copy)
+    return ATOM_INVALID;
+
+  Atom atom = table->count++;
+  table->entries[atom] =
+      (AtomEntry){.text = copy, .length = (uint32_t)length, .hash = hash};
+  table->slots[index] = atom + 1;
+
+  return atom;
+}
@@ -0,0 +1,239 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/batch.h"
+
+/*
+ * A contiguous range of files. The owner and thieves alike claim the next
+ * file with an atomic increment, so every file is parsed exactly once.
+ * Shares are aligned to a cache line so that workers do not contend on each
+ * other's counters.
+ */
+typedef struct {
+  _Alignas(64) atomic_size_t next;
+  size_t end;
+} BatchShare;
+
+/*
+ * State shared by the workers of a batch.
+ */
+typedef struct {
+  ParsedFile *files;
+  BatchShare *shares;
+  unsigned share_count;
+  bool measure;
+  const char *cache_directory;
+} Batch;
+
+/*
+ * A worker thread and the share it starts with.
+ */
+typedef struct {
+  Batch *batch;
+  unsigned index;
+  pthread_t thread;
+  bool started;
+} BatchWorker;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Helper function running the lexer alone over a source and returning the
+ * number of tokens.
+ */
+static long count_tokens(const Source *source) {
+  Lexer lexer;
+  if (init_lexer_source(&lexer, source) != LEXER_INIT_OK) {
+    return -1;
+  }
+
+  long count = 0;
+  while (next_lexical_token(&lexer).type != TOKEN_EOF) {
+    count++;
+  }
+
+  free_lexer(&lexer);
+
+  return count;
+}
+
+/*
+ * Helper function loading and parsing one file.
+ */
+static void parse_file(ParsedFile *file, const Batch *batch) {
+  double start = now_seconds();
+
+  SourceOpenError open_error = open_source_file(&file->source, file->path);
+  double loaded = now_seconds();
+  file->load_seconds = loaded - start;
+
+  if (open_error != SOURCE_OPEN_OK) {
+    file->status = PARSE_FILE_ERROR_LOAD;
+    file->error = open_error;
+    return;
+  }
+
+  /* An empty file is an empty program. */
+  if (file->source.length == 0) {
+    return;
+  }
+
+  /* On a hit the tree comes from the cache and nothing is lexed. */
+  if (batch->cache_directory &&
+      cache_load(batch->cache_directory, &file->source, &file->cached) ==
+          CACHE_OK) {
+    file->program = file->cached.program;
+    file->parse_seconds = now_seconds() - loaded;
+    return;
+  }
+
+  if (batch->measure) {
+    file->tokens = count_tokens(&file->source);
+    double lexed = now_seconds();
+    file->lex_seconds = lexed - loaded;
+    loaded = lexed;
+  }
+
+  ASTInitError ast_error = init_ast_source(&file->ast, &file->source);
+  if (ast_error != AST_INIT_OK) {
+    file->status = PARSE_FILE_ERROR_INIT;
+    file->error = ast_error;
+    return;
+  }
+
+  file->program = ast_parse_program(&file->ast);
+  file->parse_seconds = now_seconds() - loaded;
+
+  if (!file->program) {
+    file->status = PARSE_FILE_ERROR_MEMORY;
+  }
+}
+
+/*
+ * Helper function parsing the files of a worker's own share, then stealing
+ * from the shares of the following workers in turn.
+ */
+static void *batch_worker_run(void *argument) {
+  BatchWorker *worker = (BatchWorker *)argument;
+  Batch *batch = worker->batch;
+
+  for (unsigned k = 0; k < batch->share_count; k++) {
+    BatchShare *share =
+        &batch->shares[(worker->index + k) % batch->share_count];
+
+    while (1) {
+      size_t i = atomic_fetch_add_explicit(&share->next, 1,
+                                           memory_order_relaxed);
+      if (i >= share->end)
+        break;
+
+      parse_file(&batch->files[i], batch);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Returns the number of online CPUs.
+ */
+unsigned batch_default_threads(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? (unsigned)cpus : 1;
+}
+
+/**
+ * Loads and parses a batch of files in parallel.
+ *
+ * The calling thread is one of the workers. Results are written to `files`
+ * only by the worker that claimed them, and joining the threads publishes
+ * them to the caller.
+ *
+ * @param files The files to parse.
+ * @param count The number of files.
+ * @param options The settings of the batch, or NULL for the defaults.
+ * @return BATCH_OK on success, an error code otherwise.
+ */
+BatchError parse_files(ParsedFile *files, size_t count,
+                       const BatchOptions *options) {
+  if (!files && count > 0) {
+    return BATCH_ERROR_NULL_PTR;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const char *path = files[i].path;
+    memset(&files[i], 0, sizeof(ParsedFile));
+    files[i].path = path;
+  }
+
+  if (count == 0) {
+    return BATCH_OK;
+  }
+
+  unsigned threads = options && options->threads ? options->threads
+                                                  : batch_default_threads();
+  if (threads > count)
+    threads = (unsigned)count;
+
+  BatchShare *shares =
+      (BatchShare *)aligned_alloc(64, sizeof(BatchShare) * threads);
+  BatchWorker *workers = (BatchWorker *)malloc(sizeof(BatchWorker) * threads);
+  if (!shares || !workers) {
+    free(shares);
+    free(workers);
+    return BATCH_ERROR_MEMORY_ALLOCATION;
+  }
+
+  Batch batch = {.files = files,
+                 .shares = shares,
+                 .share_count = threads,
+                 .measure = options && options->measure,
+                 .cache_directory = options ? options->cache_directory : NULL};
+
+  for (unsigned i = 0; i < threads; i++) {
+    atomic_init(&shares[i].next, count * i / threads);
+    shares[i].end = count * (i + 1) / threads;
+  }
+
+  for (unsigned i = 1; i < threads; i++) {
+    workers[i] = (BatchWorker){.batch = &batch, .index = i};
+    workers[i].started = pthread_create(&workers[i].thread, NULL,
+                                        batch_worker_run, &workers[i]) == 0;
+  }
+
+  workers[0] = (BatchWorker){.batch = &batch, .index = 0};
+  batch_worker_run(&workers[0]);
+
+  for (unsigned i = 1; i < threads; i++) {
+    if (workers[i].started)
+      pthread_join(workers[i].thread, NULL);
+  }
+
+  free(workers);
+  free(shares);
+
+  return BATCH_OK;
+}
+
+/**
+ * Releases the tree and the source of a parsed file.
+ *
+ * @param file A pointer to the ParsedFile to free.
+ */
+void free_parsed_file(ParsedFile *file) {
+  if (!file)
+    return;
+
+  free_ast(&file->ast);
+  free_cached_program(&file->cached);
+  free_source(&file->source);
+  file->program = NULL;
+}
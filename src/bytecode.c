@@ -0,0 +1,182 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/bytecode.h"
+
+const uint8_t opcode_operand_counts[OP_COUNT] = {
+    [OP_LOAD_CONSTANT] = 2, [OP_LOAD_UNDEFINED] = 1, [OP_MOVE] = 2,
+    [OP_ADD] = 3,           [OP_SUBTRACT] = 3,       [OP_MULTIPLY] = 3,
+    [OP_DIVIDE] = 3,        [OP_MODULO] = 3,         [OP_NEGATE] = 2,
+    [OP_TO_NUMBER] = 2,     [OP_NOT] = 2,            [OP_NEW_OBJECT] = 1,
+    [OP_GET_PROPERTY] = 4,  [OP_SET_PROPERTY] = 4,   [OP_HALT] = 0,
+};
+
+/* Operands not listed are registers. */
+const uint8_t opcode_operand_kinds[OP_COUNT][OPCODE_MAX_OPERANDS] = {
+    [OP_LOAD_CONSTANT] = {OPERAND_REGISTER, OPERAND_CONSTANT},
+    [OP_GET_PROPERTY] = {OPERAND_REGISTER, OPERAND_REGISTER, OPERAND_PROPERTY,
+                         OPERAND_CACHE},
+    [OP_SET_PROPERTY] = {OPERAND_REGISTER, OPERAND_PROPERTY, OPERAND_REGISTER,
+                         OPERAND_CACHE},
+};
+
+/* Serial of the last chunk initialized. */
+static atomic_uint_fast64_t last_serial;
+
+static const char *const opcode_names[OP_COUNT] = {
+    [OP_LOAD_CONSTANT] = "LOAD_CONSTANT",
+    [OP_LOAD_UNDEFINED] = "LOAD_UNDEFINED",
+    [OP_MOVE] = "MOVE",
+    [OP_ADD] = "ADD",
+    [OP_SUBTRACT] = "SUBTRACT",
+    [OP_MULTIPLY] = "MULTIPLY",
+    [OP_DIVIDE] = "DIVIDE",
+    [OP_MODULO] = "MODULO",
+    [OP_NEGATE] = "NEGATE",
+    [OP_TO_NUMBER] = "TO_NUMBER",
+    [OP_NOT] = "NOT",
+    [OP_NEW_OBJECT] = "NEW_OBJECT",
+    [OP_GET_PROPERTY] = "GET_PROPERTY",
+    [OP_SET_PROPERTY] = "SET_PROPERTY",
+    [OP_HALT] = "HALT",
+};
+
+/*
+ * Helper function making room for one more element in a growable array,
+ * doubling its capacity when it is full.
+ */
+static int grow_array(void **items, size_t *capacity, size_t count,
+                      size_t item_size) {
+  if (count < *capacity)
+    return 1;
+
+  size_t grown = *capacity ? *capacity * 2 : 64;
+  void *resized = realloc(*items, item_size * grown);
+  if (!resized)
+    return 0;
+
+  *items = resized;
+  *capacity = grown;
+
+  return 1;
+}
+
+/**
+ * Initializes an empty chunk.
+ *
+ * @param chunk A pointer to the Chunk to initialize.
+ */
+void init_chunk(Chunk *chunk) {
+  if (!chunk)
+    return;
+
+  memset(chunk, 0, sizeof(Chunk));
+  init_arena(&chunk->arena);
+  chunk->serial = atomic_fetch_add(&last_serial, 1) + 1;
+}
+
+/**
+ * Releases the code, constants and variable names of a chunk.
+ *
+ * @param chunk A pointer to the Chunk to free.
+ */
+void free_chunk(Chunk *chunk) {
+  if (!chunk)
+    return;
+
+  free(chunk->code);
+  free(chunk->constants);
+  free(chunk->variables);
+  free(chunk->properties);
+  free_arena(&chunk->arena);
+
+  init_chunk(chunk);
+}
+
+/**
+ * Appends a word to the code of a chunk.
+ */
+int chunk_write(Chunk *chunk, uint32_t word) {
+  if (!grow_array((void **)&chunk->code, &chunk->code_capacity,
+                  chunk->code_count, sizeof(uint32_t)))
+    return 0;
+
+  chunk->code[chunk->code_count++] = word;
+
+  return 1;
+}
+
+/**
+ * Appends a value to the constant pool of a chunk.
+ */
+int chunk_add_constant(Chunk *chunk, Value value, uint32_t *index) {
+  if (!grow_array((void **)&chunk->constants, &chunk->constant_capacity,
+                  chunk->constant_count, sizeof(Value)))
+    return 0;
+
+  *index = (uint32_t)chunk->constant_count;
+  chunk->constants[chunk->constant_count++] = value;
+
+  return 1;
+}
+
+/**
+ * Records the name of the next variable of a chunk.
+ */
+int chunk_add_variable(Chunk *chunk, const char *name, uint32_t *index) {
+  if (!grow_array((void **)&chunk->variables, &chunk->variable_capacity,
+                  chunk->variable_count, sizeof(char *)))
+    return 0;
+
+  char *copy = arena_strndup(&chunk->arena, name, strlen(name));
+  if (!copy)
+    return 0;
+
+  *index = (uint32_t)chunk->variable_count;
+  chunk->variables[chunk->variable_count++] = copy;
+
+  return 1;
+}
+
+/**
+ * Records the name of the next property of a chunk.
+ */
+int chunk_add_property(Chunk *chunk, const char *name, uint32_t *index) {
+  if (!grow_array((void **)&chunk->properties, &chunk->property_capacity,
+                  chunk->property_count, sizeof(char *)))
+    return 0;
+
+  char *copy = arena_strndup(&chunk->arena, name, strlen(name));
+  if (!copy)
+    return 0;
+
+  *index = (uint32_t)chunk->property_count;
+  chunk->properties[chunk->property_count++] = copy;
+
+  return 1;
+}
+
+/**
+ * Prints one instruction per line, with its offset and operands.
+ */
+void chunk_print(const Chunk *chunk) {
+  size_t offset = 0;
+
+  while (offset < chunk->code_count) {
+    uint32_t opcode = chunk->code[offset];
+    if (opcode >= OP_COUNT) {
+      printf("%04zu  <invalid %u>\n", offset, opcode);
+      return;
+    }
+
+    printf("%04zu  %-15s", offset, opcode_names[opcode]);
+    for (uint8_t i = 0; i < opcode_operand_counts[opcode]; i++) {
+      printf(" %u", chunk->code[offset + 1 + i]);
+    }
+    printf("\n");
+
+    offset += 1 + opcode_operand_counts[opcode];
+  }
+}
@@ -0,0 +1,780 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/cache.h"
+
+#define CACHE_MAGIC "CIJSCACH"
+#define CACHE_VERSION 5
+#define CACHE_BYTE_ORDER 0x01020304u
+#define CACHE_EXTENSION ".cjsc"
+
+/*
+ * Header of a cache file. It is followed by the constants, the code, the
+ * nodes, the variables, the properties and the names, each section starting
+ * on an 8-byte boundary, and by the bytes of the source, which a hit must
+ * match.
+ */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t source_length;
+  uint32_t name_count;
+  uint32_t node_count;
+  uint32_t code_count;
+  uint32_t constant_count;
+  uint32_t variable_count;
+  uint32_t register_count;
+  uint32_t property_count;
+  uint32_t cache_count;
+  uint64_t names_size;
+} CacheHeader;
+
+/*
+ * A node of the tree. Its children follow it in pre-order. `data` is the name
+ * index of declarations, identifiers, properties and member expressions, the
+ * bits of the value of literals and the operator of unary and binary
+ * expressions. Bit 32 marks `const` declarations. Resolved slots are not
+ * stored: a loaded tree is resolved again when needed.
+ */
+typedef struct {
+  uint32_t type;
+  uint32_t children_count;
+  uint64_t data;
+} CacheNode;
+
+/*
+ * Offsets of the sections of a cache file.
+ */
+typedef struct {
+  size_t constants;
+  size_t code;
+  size_t nodes;
+  size_t variables;
+  size_t properties;
+  size_t names;
+  size_t source;
+  size_t size;
+} CacheLayout;
+
+static size_t align8(size_t size) { return (size + 7) & ~(size_t)7; }
+
+/*
+ * Helper function computing where each section of a file starts.
+ */
+static CacheLayout cache_layout(const CacheHeader *header) {
+  CacheLayout layout;
+  layout.constants = sizeof(CacheHeader);
+  layout.code =
+      layout.constants + (size_t)header->constant_count * sizeof(Value);
+  layout.nodes =
+      layout.code + align8((size_t)header->code_count * sizeof(uint32_t));
+  layout.variables =
+      layout.nodes + (size_t)header->node_count * sizeof(CacheNode);
+  layout.properties =
+      layout.variables +
+      align8((size_t)header->variable_count * sizeof(uint32_t));
+  layout.names = layout.properties +
+                 align8((size_t)header->property_count * sizeof(uint32_t));
+  layout.source = layout.names + (size_t)header->names_size;
+  layout.size = layout.source + (size_t)header->source_length;
+  return layout;
+}
+
+/*
+ * Helper function formatting the path of the cache file of a hash.
+ *
+ * @return A heap-allocated path, or NULL if it could not be allocated.
+ */
+static char *cache_path(const char *directory, uint64_t hash) {
+  size_t length = strlen(directory) + 1 + 16 + sizeof(CACHE_EXTENSION);
+  char *path = (char *)malloc(length);
+  if (path) {
+    snprintf(path, length, "%s/%016llx" CACHE_EXTENSION, directory,
+             (unsigned long long)hash);
+  }
+  return path;
+}
+
+/**
+ * Returns the FNV-1a hash of a source.
+ */
+uint64_t cache_hash(const char *data, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+/*
+ * Helper function listing the nodes of a tree in pre-order and interning
+ * their names. Only the nodes `read_nodes` can rebuild are accepted:
+ * functions, whose bodies may still refer to the tokens of the source, are
+ * not cached. The tree is walked from an explicit stack, so that deep
+ * expressions do not exhaust the call stack.
+ *
+ * @return CACHE_OK with the heap-allocated list in `order`, CACHE_ERROR_INVALID
+ * if the tree holds a node that cannot be cached or too many nodes,
+ * CACHE_ERROR_MEMORY_ALLOCATION if memory ran out.
+ */
+static CacheError count_nodes(const ASTNode *program, AtomTable *names,
+                              const ASTNode ***order, uint32_t *count) {
+  const ASTNode **stack = NULL;
+  size_t stack_count = 0;
+  size_t stack_capacity = 0;
+  size_t order_capacity = 0;
+  const ASTNode *node = program;
+  CacheError error = CACHE_OK;
+
+  *order = NULL;
+  *count = 0;
+
+  while (1) {
+    if (node->type == NODE_FUNCTION_DECLARATION ||
+        node->type == NODE_FUNCTION_BODY || *count == UINT32_MAX) {
+      error = CACHE_ERROR_INVALID;
+      break;
+    }
+
+    if (*count == order_capacity) {
+      order_capacity = order_capacity ? order_capacity * 2 : 64;
+      const ASTNode **nodes = (const ASTNode **)realloc(
+          *order, sizeof(ASTNode *) * order_capacity);
+      if (!nodes) {
+        error = CACHE_ERROR_MEMORY_ALLOCATION;
+        break;
+      }
+      *order = nodes;
+    }
+    (*order)[(*count)++] = node;
+
+    const char *name = NULL;
+    if (node->type == NODE_VARIABLE_DECLARATION) {
+      name = node->data.declaration.name;
+    } else if (node->type == NODE_IDENTIFIER) {
+      name = node->data.identifier.value;
+    } else if (node->type == NODE_PROPERTY ||
+               node->type == NODE_MEMBER_EXPRESSION) {
+      name = node->data.property.name;
+    }
+
+    if (name && atom_intern(names, name, strlen(name)) == ATOM_INVALID) {
+      error = CACHE_ERROR_MEMORY_ALLOCATION;
+      break;
+    }
+
+    if (stack_count + node->children_count > stack_capacity) {
+      size_t capacity = stack_capacity ? stack_capacity : 64;
+      while (capacity < stack_count + node->children_count)
+        capacity *= 2;
+
+      const ASTNode **nodes =
+          (const ASTNode **)realloc(stack, sizeof(ASTNode *) * capacity);
+      if (!nodes) {
+        error = CACHE_ERROR_MEMORY_ALLOCATION;
+        break;
+      }
+      stack = nodes;
+      stack_capacity = capacity;
+    }
+
+    /* Pushed in reverse, so that they are listed in source order. */
+    for (size_t i = node->children_count; i > 0; i--) {
+      stack[stack_count++] = &node->children[i - 1];
+    }
+
+    if (stack_count == 0)
+      break;
+    node = stack[--stack_count];
+  }
+
+  free(stack);
+
+  if (error != CACHE_OK) {
+    free(*order);
+    *order = NULL;
+  }
+
+  return error;
+}
+
+/*
+ * Helper function writing the nodes listed by `count_nodes`.
+ */
+static void write_nodes(const ASTNode **order, uint32_t count,
+                        AtomTable *names, CacheNode *nodes) {
+  for (uint32_t i = 0; i < count; i++) {
+    const ASTNode *node = order[i];
+    CacheNode *out = &nodes[i];
+    out->type = (uint32_t)node->type;
+    out->children_count = (uint32_t)node->children_count;
+    out->data = 0;
+
+    switch (node->type) {
+    case NODE_VARIABLE_DECLARATION: {
+      const char *name = node->data.declaration.name;
+      out->data = atom_intern(names, name, strlen(name)) |
+                  (uint64_t)node->data.declaration.constant << 32;
+      break;
+    }
+    case NODE_IDENTIFIER: {
+      const char *name = node->data.identifier.value;
+      out->data = atom_intern(names, name, strlen(name));
+      break;
+    }
+    case NODE_LITERAL:
+      out->data = node->data.literal.value;
+      break;
+    case NODE_BINARY_EXPRESSION:
+      out->data = (uint64_t)node->data.binary.operator;
+      break;
+    case NODE_UNARY_EXPRESSION:
+      out->data = (uint64_t)node->data.unary.operator;
+      break;
+    case NODE_PROPERTY:
+    case NODE_MEMBER_EXPRESSION: {
+      const char *name = node->data.property.name;
+      out->data = atom_intern(names, name, strlen(name));
+      break;
+    }
+    default:
+      break;
+    }
+  }
+}
+
+/*
+ * Helper function interning a list of names.
+ *
+ * @return 1 on success, 0 if a name could not be interned.
+ */
+static int intern_names(AtomTable *names, char *const *list, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (atom_intern(names, list[i], strlen(list[i])) == ATOM_INVALID)
+      return 0;
+  }
+
+  return 1;
+}
+
+/*
+ * Helper function writing the name index of every name of a list, all of
+ * which were interned by `intern_names`.
+ */
+static void write_name_indices(AtomTable *names, char *const *list,
+                               size_t count, uint32_t *indices) {
+  for (size_t i = 0; i < count; i++) {
+    indices[i] = atom_intern(names, list[i], strlen(list[i]));
+  }
+}
+
+/*
+ * Helper function writing a whole buffer to a file descriptor.
+ */
+static int write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written <= 0)
+      return 0;
+
+    data += written;
+    size -= (size_t)written;
+  }
+
+  return 1;
+}
+
+/**
+ * Writes the tree and bytecode of a source to the cache.
+ */
+CacheError cache_store(const char *directory, const Source *source,
+                       const ASTNode *program, const Chunk *chunk) {
+  if (!directory || !source || !program || !chunk) {
+    return CACHE_ERROR_NULL_PTR;
+  }
+
+  if (source->kind == SOURCE_STREAM || chunk->code_count > UINT32_MAX ||
+      chunk->constant_count > UINT32_MAX ||
+      chunk->variable_count > UINT32_MAX ||
+      chunk->property_count > UINT32_MAX) {
+    return CACHE_ERROR_INVALID;
+  }
+
+  AtomTable names;
+  init_atom_table(&names);
+
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+  header.version = CACHE_VERSION;
+  header.byte_order = CACHE_BYTE_ORDER;
+  header.source_length = source->length;
+  header.code_count = (uint32_t)chunk->code_count;
+  header.constant_count = (uint32_t)chunk->constant_count;
+  header.variable_count = (uint32_t)chunk->variable_count;
+  header.property_count = (uint32_t)chunk->property_count;
+  header.cache_count = chunk->cache_count;
+  header.register_count = chunk->register_count;
+
+  const ASTNode **order = NULL;
+  CacheError error =
+      count_nodes(program, &names, &order, &header.node_count);
+  if (error == CACHE_OK &&
+      (!intern_names(&names, chunk->variables, chunk->variable_count) ||
+       !intern_names(&names, chunk->properties, chunk->property_count))) {
+    error = CACHE_ERROR_MEMORY_ALLOCATION;
+  }
+
+  if (error != CACHE_OK) {
+    free(order);
+    free_atom_table(&names);
+    return error;
+  }
+
+  header.name_count = names.count;
+  for (uint32_t i = 0; i < names.count; i++) {
+    header.names_size += sizeof(uint32_t) + names.entries[i].length + 1;
+  }
+
+  CacheLayout layout = cache_layout(&header);
+  char *buffer = (char *)calloc(1, layout.size);
+  if (!buffer) {
+    free(order);
+    free_atom_table(&names);
+    return CACHE_ERROR_MEMORY_ALLOCATION;
+  }
+
+  memcpy(buffer, &header, sizeof(header));
+  if (chunk->constant_count > 0) {
+    memcpy(buffer + layout.constants, chunk->constants,
+           chunk->constant_count * sizeof(Value));
+  }
+  if (chunk->code_count > 0) {
+    memcpy(buffer + layout.code, chunk->code,
+           chunk->code_count * sizeof(uint32_t));
+  }
+
+  write_nodes(order, header.node_count, &names,
+              (CacheNode *)(buffer + layout.nodes));
+  free(order);
+
+  write_name_indices(&names, chunk->variables, chunk->variable_count,
+                     (uint32_t *)(buffer + layout.variables));
+  write_name_indices(&names, chunk->properties, chunk->property_count,
+                     (uint32_t *)(buffer + layout.properties));
+
+  char *out = buffer + layout.names;
+  for (uint32_t i = 0; i < names.count; i++) {
+    uint32_t length = names.entries[i].length;
+    memcpy(out, &length, sizeof(length));
+    memcpy(out + sizeof(length), names.entries[i].text, length);
+    out += sizeof(length) + length + 1;
+  }
+
+  if (source->length > 0) {
+    memcpy(buffer + layout.source, source->data, source->length);
+  }
+
+  free_atom_table(&names);
+
+  char *path =
+      cache_path(directory, cache_hash(source->data, source->length));
+  size_t temp_length = strlen(directory) + sizeof("/.cjsc-XXXXXX");
+  char *temp = (char *)malloc(temp_length);
+  if (!path || !temp) {
+    free(path);
+    free(temp);
+    free(buffer);
+    return CACHE_ERROR_MEMORY_ALLOCATION;
+  }
+  snprintf(temp, temp_length, "%s/.cjsc-XXXXXX", directory);
+
+  int fd = mkstemp(temp);
+
+  if (fd < 0) {
+    error = CACHE_ERROR_IO;
+  } else {
+    bool written = write_all(fd, buffer, layout.size);
+    if (close(fd) != 0 || !written || rename(temp, path) != 0) {
+      unlink(temp);
+      error = CACHE_ERROR_IO;
+    }
+  }
+
+  free(temp);
+  free(path);
+  free(buffer);
+
+  return error;
+}
+
+/*
+ * Helper function checking that every instruction of the cached code is
+ * complete and only refers to existing registers and constants, so that the
+ * VM can trust it.
+ */
+static bool validate_code(const CacheHeader *header, const uint32_t *code) {
+  size_t i = 0;
+  bool halted = false;
+
+  while (i < header->code_count) {
+    uint32_t opcode = code[i++];
+    if (opcode >= OP_COUNT || header->code_count - i <
+                                  (size_t)opcode_operand_counts[opcode]) {
+      return false;
+    }
+
+    for (uint8_t k = 0; k < opcode_operand_counts[opcode]; k++) {
+      uint32_t operand = code[i++];
+      uint32_t limit;
+
+      switch (opcode_operand_kinds[opcode][k]) {
+      case OPERAND_CONSTANT:
+        limit = header->constant_count;
+        break;
+      case OPERAND_PROPERTY:
+        limit = header->property_count;
+        break;
+      case OPERAND_CACHE:
+        limit = header->cache_count;
+        break;
+      default:
+        limit = header->register_count;
+        break;
+      }
+
+      if (operand >= limit)
+        return false;
+    }
+
+    halted = opcode == OP_HALT;
+  }
+
+  return halted;
+}
+
+/*
+ * Helper function rebuilding a node from its cached form, with room for its
+ * children. Values that point to objects are rejected, as no object outlives
+ * the VM that created it.
+ *
+ * @return 1 on success, 0 if the node is malformed or memory ran out.
+ */
+static int read_node(CachedProgram *cached, const CacheHeader *header,
+                     const CacheNode *in, ASTNode *node) {
+  memset(node, 0, sizeof(ASTNode));
+  node->type = (ASTNodeType)in->type;
+
+  switch (in->type) {
+  case NODE_SOURCE_FILE:
+    break;
+  case NODE_VARIABLE_DECLARATION:
+    if ((in->data & UINT32_MAX) >= header->name_count || in->data >> 33 != 0)
+      return 0;
+    node->data.declaration.atom = (Atom)in->data;
+    node->data.declaration.name = atom_text(&cached->atoms, (Atom)in->data);
+    node->data.declaration.constant = in->data >> 32;
+    break;
+  case NODE_IDENTIFIER:
+    if (in->data >= header->name_count)
+      return 0;
+    node->data.identifier.atom = (Atom)in->data;
+    node->data.identifier.value = atom_text(&cached->atoms, (Atom)in->data);
+    break;
+  case NODE_LITERAL:
+    if (value_is_object(in->data))
+      return 0;
+    node->data.literal.value = in->data;
+    break;
+  case NODE_BINARY_EXPRESSION:
+    node->data.binary.operator = (TokenType)in->data;
+    break;
+  case NODE_UNARY_EXPRESSION:
+    node->data.unary.operator = (TokenType)in->data;
+    break;
+  case NODE_PROPERTY:
+  case NODE_MEMBER_EXPRESSION:
+    if (in->data >= header->name_count)
+      return 0;
+    node->data.property.atom = (Atom)in->data;
+    node->data.property.name = atom_text(&cached->atoms, (Atom)in->data);
+    break;
+  case NODE_ASSIGNMENT_EXPRESSION:
+  case NODE_EXPRESSION_STATEMENT:
+  case NODE_OBJECT_LITERAL:
+    break;
+  default:
+    return 0;
+  }
+
+  if (in->children_count > 0) {
+    node->children = (ASTNode *)arena_alloc(
+        &cached->arena, sizeof(ASTNode) * in->children_count);
+    if (!node->children)
+      return 0;
+    node->children_count = in->children_count;
+  }
+
+  return 1;
+}
+
+/*
+ * A node whose children are being rebuilt, and the index of the next one.
+ */
+typedef struct {
+  ASTNode *node;
+  size_t next;
+} CacheParent;
+
+/*
+ * Helper function rebuilding the tree of the cached nodes into `program`.
+ * Every node but the first must be claimed as the child of an earlier one,
+ * so the children of all nodes together are allocated at most once. The
+ * nodes are rebuilt from an explicit stack, so that deep expressions do not
+ * exhaust the call stack.
+ *
+ * @return 1 on success, 0 if the nodes are malformed or memory ran out.
+ */
+static int read_nodes(CachedProgram *cached, const CacheHeader *header,
+                      const CacheNode *nodes, ASTNode *program) {
+  CacheParent *stack = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  size_t index = 0;
+  size_t claimed = 0;
+  ASTNode *node = program;
+  int ok = 1;
+
+  while (ok) {
+    const CacheNode *in = &nodes[index++];
+    claimed += in->children_count;
+
+    if (claimed > (size_t)header->node_count - 1 ||
+        !read_node(cached, header, in, node)) {
+      ok = 0;
+      break;
+    }
+
+    if (node->children_count > 0) {
+      if (count == capacity) {
+        capacity = capacity ? capacity * 2 : 64;
+        CacheParent *parents =
+            (CacheParent *)realloc(stack, sizeof(CacheParent) * capacity);
+        if (!parents) {
+          ok = 0;
+          break;
+        }
+        stack = parents;
+      }
+      stack[count++] = (CacheParent){.node = node, .next = 0};
+    }
+
+    while (count > 0 &&
+           stack[count - 1].next == stack[count - 1].node->children_count) {
+      count--;
+    }
+    if (count == 0)
+      break;
+
+    CacheParent *parent = &stack[count - 1];
+    node = &parent->node->children[parent->next++];
+  }
+
+  free(stack);
+
+  /* Claimed children are always listed, so every node was read. */
+  return ok && index == header->node_count;
+}
+
+/*
+ * Helper function rebuilding a list of names from their name indices.
+ */
+static CacheError read_names(CachedProgram *cached, const CacheHeader *header,
+                             const uint32_t *indices, uint32_t count,
+                             char ***list) {
+  if (count == 0)
+    return CACHE_OK;
+
+  *list = (char **)arena_alloc(&cached->arena, sizeof(char *) * count);
+  if (!*list)
+    return CACHE_ERROR_MEMORY_ALLOCATION;
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (indices[i] >= header->name_count)
+      return CACHE_ERROR_INVALID;
+    (*list)[i] = (char *)atom_text(&cached->atoms, indices[i]);
+  }
+
+  return CACHE_OK;
+}
+
+/*
+ * Helper function validating a mapped cache file and rebuilding its tree,
+ * names and chunk.
+ */
+static CacheError read_cache_file(CachedProgram *cached,
+                                  const Source *source) {
+  const char *data = (const char *)cached->mapping;
+  CacheHeader header;
+
+  if (cached->size < sizeof(header))
+    return CACHE_ERROR_INVALID;
+  memcpy(&header, data, sizeof(header));
+
+  if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != CACHE_VERSION ||
+      header.byte_order != CACHE_BYTE_ORDER ||
+      header.source_length != source->length ||
+      header.node_count == 0 || header.variable_count > header.name_count ||
+      header.variable_count > header.register_count ||
+      header.property_count > header.name_count ||
+      header.names_size > cached->size) {
+    return CACHE_ERROR_INVALID;
+  }
+
+  /* The name of the file is only a hash of the source: a hit must hold the
+   * source itself. */
+  CacheLayout layout = cache_layout(&header);
+  if (layout.size != cached->size ||
+      (source->length > 0 &&
+       memcmp(data + layout.source, source->data, source->length) != 0) ||
+      !validate_code(&header, (const uint32_t *)(data + layout.code))) {
+    return CACHE_ERROR_INVALID;
+  }
+
+  const Value *constants = (const Value *)(data + layout.constants);
+  for (uint32_t i = 0; i < header.constant_count; i++) {
+    if (value_is_object(constants[i]))
+      return CACHE_ERROR_INVALID;
+  }
+
+  const char *name = data + layout.names;
+  const char *names_end = data + layout.size;
+  for (uint32_t i = 0; i < header.name_count; i++) {
+    uint32_t length;
+    if ((size_t)(names_end - name) < sizeof(length))
+      return CACHE_ERROR_INVALID;
+    memcpy(&length, name, sizeof(length));
+    name += sizeof(length);
+
+    if ((size_t)(names_end - name) <= length)
+      return CACHE_ERROR_INVALID;
+    if (atom_intern(&cached->atoms, name, length) != i)
+      return CACHE_ERROR_INVALID;
+    name += length + 1;
+  }
+
+  ASTNode *program = (ASTNode *)arena_alloc(&cached->arena, sizeof(ASTNode));
+  if (!program)
+    return CACHE_ERROR_MEMORY_ALLOCATION;
+
+  if (!read_nodes(cached, &header, (const CacheNode *)(data + layout.nodes),
+                  program) ||
+      program->type != NODE_SOURCE_FILE) {
+    return CACHE_ERROR_INVALID;
+  }
+
+  /* A chunk of its own serial, so that VMs do not mistake it for another. */
+  Chunk *chunk = &cached->chunk;
+  init_chunk(chunk);
+  chunk->code = (uint32_t *)(data + layout.code);
+  chunk->code_count = header.code_count;
+  chunk->constants = (Value *)(data + layout.constants);
+  chunk->constant_count = header.constant_count;
+  chunk->register_count = header.register_count;
+  chunk->cache_count = header.cache_count;
+
+  CacheError error = read_names(
+      cached, &header, (const uint32_t *)(data + layout.variables),
+      header.variable_count, &chunk->variables);
+  if (error != CACHE_OK)
+    return error;
+  chunk->variable_count = header.variable_count;
+
+  error = read_names(cached, &header,
+                     (const uint32_t *)(data + layout.properties),
+                     header.property_count, &chunk->properties);
+  if (error != CACHE_OK)
+    return error;
+  chunk->property_count = header.property_count;
+
+  cached->program = program;
+
+  return CACHE_OK;
+}
+
+/**
+ * Loads the tree and bytecode of a source from the cache.
+ */
+CacheError cache_load(const char *directory, const Source *source,
+                      CachedProgram *cached) {
+  if (!directory || !source || !cached) {
+    return CACHE_ERROR_NULL_PTR;
+  }
+
+  memset(cached, 0, sizeof(CachedProgram));
+
+  if (source->kind == SOURCE_STREAM) {
+    return CACHE_ERROR_INVALID;
+  }
+
+  char *path = cache_path(directory, cache_hash(source->data, source->length));
+  if (!path) {
+    return CACHE_ERROR_MEMORY_ALLOCATION;
+  }
+
+  int fd = open(path, O_RDONLY);
+  free(path);
+  if (fd < 0) {
+    return CACHE_ERROR_MISS;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return CACHE_ERROR_INVALID;
+  }
+
+  void *mapping =
+      mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return CACHE_ERROR_IO;
+  }
+
+  cached->mapping = mapping;
+  cached->size = (size_t)st.st_size;
+  init_arena(&cached->arena);
+  init_atom_table(&cached->atoms);
+  init_chunk(&cached->chunk);
+
+  CacheError error = read_cache_file(cached, source);
+  if (error != CACHE_OK) {
+    free_cached_program(cached);
+  }
+
+  return error;
+}
+
+/**
+ * Releases a program loaded from the cache.
+ */
+void free_cached_program(CachedProgram *cached) {
+  if (!cached || !cached->mapping)
+    return;
+
+  munmap(cached->mapping, cached->size);
+  free_arena(&cached->arena);
+  free_atom_table(&cached->atoms);
+  memset(cached, 0, sizeof(CachedProgram));
+}
@@ -0,0 +1,604 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/compiler.h"
+
+/*
+ * Destination register meaning that a value is not wanted.
+ */
+#define NO_VARIABLE UINT32_MAX
+
+/*
+ * Entry of the property table meaning that no property has the atom.
+ */
+#define NO_PROPERTY UINT32_MAX
+
+/*
+ * An expression being compiled into register `dst`. `step` counts the stages
+ * of its instructions already emitted and `registers` holds the registers its
+ * operands were placed in, between stages.
+ */
+typedef struct {
+  const ASTNode *node;
+  uint32_t dst;
+  uint32_t base;
+  uint32_t step;
+  uint32_t registers[3];
+} CompileTask;
+
+/*
+ * State of a compilation. Variables live in the register of their slot, as
+ * set by the resolver; properties are found through a table indexed by the
+ * atom of their name. Registers past the variables are handed out as
+ * temporaries in stack order. Expressions are compiled from an explicit stack,
+ * so that deeply nested ones do not exhaust the call stack.
+ */
+typedef struct {
+  Chunk *chunk;
+  uint32_t *properties;   /* Property index of every atom seen so far. */
+  size_t atom_capacity;   /* Number of atoms `properties` covers. */
+  uint32_t next_register; /* First register not holding a live value. */
+  CompileTask *tasks;     /* Expressions being compiled. */
+  size_t task_count;      /* Number of tasks in `tasks`. */
+  size_t task_capacity;   /* Number of tasks `tasks` can hold. */
+  const ASTNode **nodes;  /* Nodes left to search for an assignment. */
+  size_t node_capacity;   /* Number of nodes `nodes` can hold. */
+} Compiler;
+
+/*
+ * Helper function returning the index of a property name in the chunk,
+ * adding the name the first time.
+ */
+static CompileError property_index(Compiler *compiler, const ASTNode *node,
+                                   uint32_t *index) {
+  Atom atom = node->data.property.atom;
+  if (atom == ATOM_INVALID)
+    return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+  if (atom >= compiler->atom_capacity) {
+    size_t capacity = compiler->atom_capacity ? compiler->atom_capacity : 64;
+    while (capacity <= atom)
+      capacity *= 2;
+
+    uint32_t *properties = (uint32_t *)realloc(compiler->properties,
+                                               sizeof(uint32_t) * capacity);
+    if (!properties)
+      return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+    memset(properties + compiler->atom_capacity, 0xff,
+           sizeof(uint32_t) * (capacity - compiler->atom_capacity));
+    compiler->properties = properties;
+    compiler->atom_capacity = capacity;
+  }
+
+  uint32_t *entry = &compiler->properties[atom];
+  if (*entry == NO_PROPERTY &&
+      !chunk_add_property(compiler->chunk, node->data.property.name, entry))
+    return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+  *index = *entry;
+  return COMPILE_OK;
+}
+
+/*
+ * Helper function reserving a register for a temporary.
+ */
+static uint32_t reserve_register(Compiler *compiler) {
+  uint32_t reg = compiler->next_register++;
+  if (compiler->next_register > compiler->chunk->register_count)
+    compiler->chunk->register_count = compiler->next_register;
+  return reg;
+}
+
+/*
+ * Helper function appending an instruction and its operands.
+ */
+static CompileError emit(Compiler *compiler, Opcode opcode,
+                         const uint32_t *operands) {
+  Chunk *chunk = compiler->chunk;
+
+  if (!chunk_write(chunk, opcode))
+    return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+  for (uint8_t i = 0; i < opcode_operand_counts[opcode]; i++) {
+    if (!chunk_write(chunk, operands[i]))
+      return COMPILE_ERROR_MEMORY_ALLOCATION;
+  }
+
+  return COMPILE_OK;
+}
+
+/*
+ * Helper function queuing an expression to compile into register `dst`.
+ */
+static CompileError compile_push(Compiler *compiler, const ASTNode *node,
+                                 uint32_t dst) {
+  if (compiler->task_count == compiler->task_capacity) {
+    size_t capacity =
+        compiler->task_capacity ? compiler->task_capacity * 2 : 64;
+
+    CompileTask *tasks = (CompileTask *)realloc(
+        compiler->tasks, sizeof(CompileTask) * capacity);
+    if (!tasks)
+      return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+    compiler->tasks = tasks;
+    compiler->task_capacity = capacity;
+  }
+
+  compiler->tasks[compiler->task_count++] =
+      (CompileTask){.node = node, .dst = dst};
+
+  return COMPILE_OK;
+}
+
+/*
+ * Helper function returning the register of the variable an identifier refers
+ * to. Top-level variable `i` lives in register `i` once declared; globals and
+ * variables read before their declaration ran are rejected.
+ */
+static CompileError variable_register(Compiler *compiler, const ASTNode *node,
+                                      uint32_t *reg) {
+  const ASTIdentifierNode *identifier = &node->data.identifier;
+  if (identifier->depth == AST_SCOPE_GLOBAL ||
+      identifier->slot >= compiler->chunk->variable_count)
+    return COMPILE_ERROR_UNDECLARED;
+  if (identifier->depth != 0)
+    return COMPILE_ERROR_UNSUPPORTED;
+
+  *reg = identifier->slot;
+  return COMPILE_OK;
+}
+
+/*
+ * Helper function telling whether evaluating an expression assigns a variable.
+ */
+static CompileError contains_assignment(Compiler *compiler,
+                                        const ASTNode *node, bool *found) {
+  size_t count = 0;
+  *found = false;
+
+  while (1) {
+    if (node->type == NODE_ASSIGNMENT_EXPRESSION) {
+      *found = true;
+      return COMPILE_OK;
+    }
+
+    if (count + node->children_count > compiler->node_capacity) {
+      size_t capacity =
+          compiler->node_capacity ? compiler->node_capacity : 64;
+      while (capacity < count + node->children_count)
+        capacity *= 2;
+
+      const ASTNode **nodes = (const ASTNode **)realloc(
+          compiler->nodes, sizeof(ASTNode *) * capacity);
+      if (!nodes)
+        return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+      compiler->nodes = nodes;
+      compiler->node_capacity = capacity;
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+      compiler->nodes[count++] = &node->children[i];
+    }
+
+    if (count == 0)
+      return COMPILE_OK;
+    node = compiler->nodes[--count];
+  }
+}
+
+/*
+ * Helper function placing an operand in a register, stored in `*reg`.
+ * Variables are read in place; any other expression is queued for evaluation
+ * into a new temporary, so this must be the last thing a stage does.
+ */
+static CompileError compile_operand(Compiler *compiler, const ASTNode *node,
+                                    uint32_t *reg) {
+  if (node->type == NODE_IDENTIFIER)
+    return variable_register(compiler, node, reg);
+
+  *reg = reserve_register(compiler);
+  return compile_push(compiler, node, *reg);
+}
+
+/*
+ * Helper function placing an operand that an assignment made later by the
+ * same expression must not change, stored in `*reg`. A variable read in
+ * place would see the assignment, so it is then copied into a temporary.
+ */
+static CompileError compile_operand_before(Compiler *compiler,
+                                           const ASTNode *node,
+                                           const ASTNode *later,
+                                           uint32_t *reg) {
+  bool assigns;
+  CompileError error = contains_assignment(compiler, later, &assigns);
+  if (error != COMPILE_OK)
+    return error;
+  if (!assigns)
+    return compile_operand(compiler, node, reg);
+
+  *reg = reserve_register(compiler);
+  return compile_push(compiler, node, *reg);
+}
+
+/*
+ * Helper function returning the instruction of an operator.
+ *
+ * @return 1 on success, 0 if the operator has no instruction.
+ */
+static int operator_opcode(TokenType operator, bool prefix, Opcode *opcode) {
+  switch (operator) {
+  case TOKEN_PLUS:
+    *opcode = prefix ? OP_TO_NUMBER : OP_ADD;
+    return 1;
+  case TOKEN_MINUS:
+    *opcode = prefix ? OP_NEGATE : OP_SUBTRACT;
+    return 1;
+  case TOKEN_STAR:
+    *opcode = OP_MULTIPLY;
+    return !prefix;
+  case TOKEN_SLASH:
+    *opcode = OP_DIVIDE;
+    return !prefix;
+  case TOKEN_PERCENT:
+    *opcode = OP_MODULO;
+    return !prefix;
+  case TOKEN_BANG:
+    *opcode = OP_NOT;
+    return prefix;
+  default:
+    return 0;
+  }
+}
+
+/*
+ * Helper function compiling the next stage of an assignment to a property.
+ * The object is evaluated before the value, as in JavaScript.
+ */
+static CompileError compile_property_assignment(Compiler *compiler,
+                                                CompileTask *task) {
+  const ASTNode *target = &task->node->children[0];
+  const ASTNode *value = &task->node->children[1];
+  uint32_t *registers = task->registers;
+
+  switch (task->step++) {
+  case 0:
+    if (target->children_count != 1)
+      return COMPILE_ERROR_UNSUPPORTED;
+
+    task->base = compiler->next_register;
+    return compile_operand_before(compiler, &target->children[0], value,
+                                  &registers[0]);
+
+  case 1:
+    return compile_operand(compiler, value, &registers[1]);
+
+  default: {
+    uint32_t property;
+    CompileError error = property_index(compiler, target, &property);
+    if (error == COMPILE_OK)
+      error = emit(compiler, OP_SET_PROPERTY,
+                   (uint32_t[]){registers[0], property, registers[1],
+                                compiler->chunk->cache_count++});
+    if (error == COMPILE_OK && task->dst != NO_VARIABLE)
+      error = emit(compiler, OP_MOVE, (uint32_t[]){task->dst, registers[1]});
+
+    compiler->next_register = task->base;
+    compiler->task_count--;
+    return error;
+  }
+  }
+}
+
+/*
+ * Helper function compiling the next stage of an assignment. The value is
+ * computed straight into the variable's register, then copied to `dst` unless
+ * `dst` is NO_VARIABLE, when the value of the assignment is unused.
+ */
+static CompileError compile_assignment(Compiler *compiler, CompileTask *task) {
+  const ASTNode *node = task->node;
+
+  if (node->children_count == 2 &&
+      node->children[0].type == NODE_MEMBER_EXPRESSION)
+    return compile_property_assignment(compiler, task);
+
+  if (node->children_count != 2 || node->children[0].type != NODE_IDENTIFIER)
+    return COMPILE_ERROR_UNSUPPORTED;
+
+  uint32_t *variable = &task->registers[0];
+
+  if (task->step++ == 0) {
+    CompileError error =
+        variable_register(compiler, &node->children[0], variable);
+    if (error != COMPILE_OK)
+      return error;
+
+    return compile_push(compiler, &node->children[1], *variable);
+  }
+
+  uint32_t dst = task->dst;
+  compiler->task_count--;
+
+  if (dst != NO_VARIABLE && dst != *variable)
+    return emit(compiler, OP_MOVE, (uint32_t[]){dst, *variable});
+
+  return COMPILE_OK;
+}
+
+/*
+ * Helper function compiling the next stage of an object literal: a new
+ * object, then one store per property, each taking two stages. The object is
+ * built in a temporary when `dst` is a variable, which the values of the
+ * properties may still read.
+ */
+static CompileError compile_object(Compiler *compiler, CompileTask *task) {
+  const ASTNode *node = task->node;
+  uint32_t *object = &task->registers[0];
+  uint32_t *properties_base = &task->registers[1];
+  uint32_t *src = &task->registers[2];
+  uint32_t step = task->step++;
+
+  if (step == 0) {
+    task->base = compiler->next_register;
+    *object = task->dst < compiler->chunk->variable_count
+                  ? reserve_register(compiler)
+                  : task->dst;
+    *properties_base = compiler->next_register;
+
+    return emit(compiler, OP_NEW_OBJECT, (uint32_t[]){*object});
+  }
+
+  size_t i = (step - 1) / 2;
+
+  if (i == node->children_count) {
+    CompileError error = COMPILE_OK;
+    if (*object != task->dst)
+      error = emit(compiler, OP_MOVE, (uint32_t[]){task->dst, *object});
+
+    compiler->next_register = task->base;
+    compiler->task_count--;
+    return error;
+  }
+
+  const ASTNode *property = &node->children[i];
+
+  if (step % 2 == 1) {
+    if (property->type != NODE_PROPERTY || property->children_count != 1)
+      return COMPILE_ERROR_UNSUPPORTED;
+
+    return compile_operand(compiler, &property->children[0], src);
+  }
+
+  uint32_t index;
+  CompileError error = property_index(compiler, property, &index);
+  if (error == COMPILE_OK)
+    error = emit(compiler, OP_SET_PROPERTY,
+                 (uint32_t[]){*object, index, *src,
+                              compiler->chunk->cache_count++});
+
+  compiler->next_register = *properties_base;
+  return error;
+}
+
+/*
+ * Helper function compiling the next stage of the expression on top of the
+ * stack. A stage either queues an operand, to be compiled before the next
+ * stage, or emits the last instructions of the expression and pops it.
+ */
+static CompileError compile_step(Compiler *compiler) {
+  CompileTask *task = &compiler->tasks[compiler->task_count - 1];
+  const ASTNode *node = task->node;
+  uint32_t dst = task->dst;
+
+  switch (node->type) {
+  case NODE_LITERAL: {
+    compiler->task_count--;
+
+    uint32_t constant;
+    if (!chunk_add_constant(compiler->chunk, node->data.literal.value,
+                            &constant))
+      return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+    return emit(compiler, OP_LOAD_CONSTANT, (uint32_t[]){dst, constant});
+  }
+
+  case NODE_IDENTIFIER: {
+    compiler->task_count--;
+
+    uint32_t src;
+    CompileError error = variable_register(compiler, node, &src);
+    if (error != COMPILE_OK)
+      return error;
+
+    return emit(compiler, OP_MOVE, (uint32_t[]){dst, src});
+  }
+
+  case NODE_BINARY_EXPRESSION: {
+    Opcode opcode;
+    if (!operator_opcode(node->data.binary.operator, false, &opcode) ||
+        node->children_count != 2)
+      return COMPILE_ERROR_UNSUPPORTED;
+
+    uint32_t *registers = task->registers;
+
+    switch (task->step++) {
+    case 0:
+      task->base = compiler->next_register;
+      return compile_operand_before(compiler, &node->children[0],
+                                    &node->children[1], &registers[0]);
+
+    case 1:
+      return compile_operand(compiler, &node->children[1], &registers[1]);
+
+    default:
+      compiler->next_register = task->base;
+      compiler->task_count--;
+      return emit(compiler, opcode,
+                  (uint32_t[]){dst, registers[0], registers[1]});
+    }
+  }
+
+  case NODE_UNARY_EXPRESSION: {
+    Opcode opcode;
+    if (!operator_opcode(node->data.unary.operator, true, &opcode) ||
+        node->children_count != 1)
+      return COMPILE_ERROR_UNSUPPORTED;
+
+    if (task->step++ == 0) {
+      task->base = compiler->next_register;
+      return compile_operand(compiler, &node->children[0],
+                             &task->registers[0]);
+    }
+
+    compiler->next_register = task->base;
+    compiler->task_count--;
+    return emit(compiler, opcode, (uint32_t[]){dst, task->registers[0]});
+  }
+
+  case NODE_ASSIGNMENT_EXPRESSION:
+    return compile_assignment(compiler, task);
+
+  case NODE_OBJECT_LITERAL:
+    return compile_object(compiler, task);
+
+  case NODE_MEMBER_EXPRESSION: {
+    if (node->children_count != 1)
+      return COMPILE_ERROR_UNSUPPORTED;
+
+    if (task->step++ == 0) {
+      task->base = compiler->next_register;
+      return compile_operand(compiler, &node->children[0],
+                             &task->registers[0]);
+    }
+
+    uint32_t object = task->registers[0];
+    compiler->next_register = task->base;
+    compiler->task_count--;
+
+    uint32_t property;
+    CompileError error = property_index(compiler, node, &property);
+    if (error == COMPILE_OK)
+      error = emit(compiler, OP_GET_PROPERTY,
+                   (uint32_t[]){dst, object, property,
+                                compiler->chunk->cache_count++});
+
+    return error;
+  }
+
+  default:
+    return COMPILE_ERROR_UNSUPPORTED;
+  }
+}
+
+/*
+ * Helper function emitting the code storing the value of an expression in
+ * register `dst`, or only its effects when `dst` is NO_VARIABLE and the
+ * expression is an assignment.
+ */
+static CompileError compile_expression(Compiler *compiler, const ASTNode *node,
+                                       uint32_t dst) {
+  size_t count = compiler->task_count;
+  CompileError error = compile_push(compiler, node, dst);
+
+  while (error == COMPILE_OK && compiler->task_count > count) {
+    error = compile_step(compiler);
+  }
+
+  compiler->task_count = count;
+  return error;
+}
+
+/*
+ * Helper function compiling a declaration. The initializer is compiled before
+ * the variable is declared, so it cannot refer to the variable itself.
+ */
+static CompileError compile_declaration(Compiler *compiler,
+                                        const ASTNode *node) {
+  /* Functions are not compiled, so variables are declared in slot order. */
+  if (node->data.declaration.slot != compiler->chunk->variable_count)
+    return COMPILE_ERROR_UNSUPPORTED;
+
+  uint32_t dst = reserve_register(compiler);
+
+  CompileError error =
+      node->children_count == 0
+          ? emit(compiler, OP_LOAD_UNDEFINED, (uint32_t[]){dst})
+          : compile_expression(compiler, &node->children[0], dst);
+  if (error != COMPILE_OK)
+    return error;
+
+  uint32_t index;
+  if (!chunk_add_variable(compiler->chunk, node->data.declaration.name,
+                          &index))
+    return COMPILE_ERROR_MEMORY_ALLOCATION;
+
+  return COMPILE_OK;
+}
+
+/*
+ * Helper function compiling an expression statement. An assignment stores its
+ * value in its variable only; any other expression is evaluated into a
+ * temporary that is dropped.
+ */
+static CompileError compile_statement_expression(Compiler *compiler,
+                                                 const ASTNode *node) {
+  if (node->children_count != 1)
+    return COMPILE_ERROR_UNSUPPORTED;
+
+  const ASTNode *expression = &node->children[0];
+  if (expression->type == NODE_ASSIGNMENT_EXPRESSION)
+    return compile_expression(compiler, expression, NO_VARIABLE);
+
+  return compile_expression(compiler, expression, reserve_register(compiler));
+}
+
+/**
+ * Compiles a program into a chunk.
+ *
+ * @param program The root node of the program.
+ * @param chunk The chunk receiving the bytecode.
+ * @return COMPILE_OK on success, an error code otherwise.
+ */
+CompileError compile_program(const ASTNode *program, Chunk *chunk) {
+  if (!program || !chunk) {
+    return COMPILE_ERROR_NULL_PTR;
+  }
+
+  if (!program->data.scope.resolved)
+    return COMPILE_ERROR_UNRESOLVED;
+
+  Compiler compiler = {.chunk = chunk};
+  CompileError error = COMPILE_OK;
+
+  for (size_t i = 0; i < program->children_count && error == COMPILE_OK; i++) {
+    const ASTNode *statement = &program->children[i];
+
+    /* Variable i lives in register i, so temporaries start past them. */
+    compiler.next_register = (uint32_t)chunk->variable_count;
+
+    switch (statement->type) {
+    case NODE_VARIABLE_DECLARATION:
+      error = compile_declaration(&compiler, statement);
+      break;
+    case NODE_EXPRESSION_STATEMENT:
+      error = compile_statement_expression(&compiler, statement);
+      break;
+    default:
+      error = COMPILE_ERROR_UNSUPPORTED;
+      break;
+    }
+  }
+
+  if (error == COMPILE_OK)
+    error = emit(&compiler, OP_HALT, NULL);
+
+  free(compiler.properties);
+  free(compiler.tasks);
+  free(compiler.nodes);
+
+  return error;
+}
@@ -0,0 +1,279 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "../include/diagnostic.h"
+
+/**
+ * Initializes an empty diagnostic list.
+ *
+ * @param list A pointer to the DiagnosticList to initialize.
+ */
+void init_diagnostic_list(DiagnosticList *list) {
+  if (!list)
+    return;
+
+  list->items = NULL;
+  list->count = 0;
+  list->capacity = 0;
+}
+
+/**
+ * Releases the diagnostics of a list.
+ *
+ * @param list A pointer to the DiagnosticList to free.
+ */
+void free_diagnostic_list(DiagnosticList *list) {
+  if (!list)
+    return;
+
+  free(list->items);
+  init_diagnostic_list(list);
+}
+
+/**
+ * Appends a diagnostic to a list, growing it geometrically.
+ */
+int diagnostic_list_add(DiagnosticList *list, DiagnosticCode code,
+                        size_t offset, size_t length) {
+  if (list->count == list->capacity) {
+    size_t capacity = list->capacity ? list->capacity * 2 : 8;
+
+    Diagnostic *items =
+        (Diagnostic *)realloc(list->items, sizeof(Diagnostic) * capacity);
+    if (!items)
+      return 0;
+
+    list->items = items;
+    list->capacity = capacity;
+  }
+
+  list->items[list->count++] = (Diagnostic){code, offset, length};
+
+  return 1;
+}
+
+/**
+ * Returns a description of a kind of error.
+ */
+const char *diagnostic_message(DiagnosticCode code) {
+  switch (code) {
+  case DIAGNOSTIC_UNKNOWN_TOKEN:
+    return "unknown token";
+  case DIAGNOSTIC_EXPECTED_IDENTIFIER:
+    return "expected an identifier";
+  case DIAGNOSTIC_EXPECTED_EXPRESSION:
+    return "expected an expression";
+  case DIAGNOSTIC_EXPECTED_PROPERTY_NAME:
+    return "expected a property name";
+  case DIAGNOSTIC_EXPECTED_COLON:
+    return "expected ':' after the property name";
+  case DIAGNOSTIC_EXPECTED_COMMA_OR_BRACE:
+    return "expected ',' or '}' after the property";
+  case DIAGNOSTIC_EXPECTED_COMMA_OR_PAREN:
+    return "expected ',' or ')' after the parameter";
+  case DIAGNOSTIC_EXPECTED_LEFT_PAREN:
+    return "expected '(' after the function name";
+  case DIAGNOSTIC_EXPECTED_RIGHT_PAREN:
+    return "expected ')'";
+  case DIAGNOSTIC_EXPECTED_LEFT_BRACE:
+    return "expected '{' before the function body";
+  case DIAGNOSTIC_EXPECTED_RIGHT_BRACE:
+    return "expected '}' before the end of the program";
+  case DIAGNOSTIC_MISSING_INITIALIZER:
+    return "a constant must be initialized";
+  case DIAGNOSTIC_INVALID_ASSIGNMENT:
+    return "invalid assignment target";
+  case DIAGNOSTIC_UNSUPPORTED_STATEMENT:
+    return "unsupported statement";
+  case DIAGNOSTIC_NESTING_TOO_DEEP:
+    return "functions are nested too deeply";
+  case DIAGNOSTIC_TOKEN_TOO_LONG:
+    return "token is too long";
+  }
+
+  return "syntax error";
+}
+
+/**
+ * Initializes a line index over a contiguous source.
+ */
+void init_line_index(LineIndex *index, const char *data, size_t length) {
+  if (!index)
+    return;
+
+  index->data = data;
+  index->length = length;
+  index->starts = NULL;
+  index->count = 0;
+}
+
+/**
+ * Releases the table of a line index.
+ */
+void free_line_index(LineIndex *index) {
+  if (!index)
+    return;
+
+  free(index->starts);
+  index->starts = NULL;
+  index->count = 0;
+}
+
+#if defined(__AVX2__)
+
+#define NEWLINE_WIDTH 32
+
+/*
+ * Helper function returning a mask with one bit per newline among the 32
+ * bytes at `p`.
+ */
+static inline uint32_t newline_mask(const char *p) {
+  __m256i bytes = _mm256_loadu_si256((const __m256i *)p);
+  return (uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+}
+
+#elif defined(__SSE2__)
+
+#define NEWLINE_WIDTH 16
+
+/*
+ * Helper function returning a mask with one bit per newline among the 16
+ * bytes at `p`.
+ */
+static inline uint32_t newline_mask(const char *p) {
+  __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+  return (uint32_t)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+}
+
+#else
+
+#define NEWLINE_WIDTH 8
+
+#define BYTES_LOW7 0x7f7f7f7f7f7f7f7full
+
+/*
+ * Helper function returning a mask with one bit per newline among the 8 bytes
+ * at `p`, comparing them a word at a time. The high bit of a byte is set once
+ * the byte is zero, without carries between bytes, and the multiplication
+ * gathers the high bits into the low byte.
+ */
+static inline uint32_t newline_mask(const char *p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+
+  word ^= 0x0a0a0a0a0a0a0a0aull;
+  uint64_t zero = ~(((word & BYTES_LOW7) + BYTES_LOW7) | word | BYTES_LOW7);
+
+  return (uint32_t)(((zero >> 7) * 0x0102040810204080ull) >> 56);
+}
+
+#endif
+
+/*
+ * Helper function appending a line start to the table being built.
+ */
+static int line_index_push(LineIndex *index, size_t *capacity, size_t start) {
+  if (index->count == *capacity) {
+    size_t grown = *capacity * 2;
+
+    size_t *starts = (size_t *)realloc(index->starts, sizeof(size_t) * grown);
+    if (!starts)
+      return 0;
+
+    index->starts = starts;
+    *capacity = grown;
+  }
+
+  index->starts[index->count++] = start;
+
+  return 1;
+}
+
+/*
+ * Helper function collecting the start of every line. Whole vectors are
+ * compared against `\n` at once and the set bits of each mask are walked, so
+ * the cost depends on the number of vectors and lines, not of bytes.
+ */
+static LineIndexError line_index_build(LineIndex *index) {
+  size_t capacity = 64;
+  index->starts = (size_t *)malloc(sizeof(size_t) * capacity);
+  if (!index->starts)
+    return LINE_INDEX_ERROR_MEMORY_ALLOCATION;
+
+  index->starts[0] = 0;
+  index->count = 1;
+
+  const char *data = index->data;
+  size_t length = index->length;
+  size_t i = 0;
+
+  for (; i + NEWLINE_WIDTH <= length; i += NEWLINE_WIDTH) {
+    uint32_t mask = newline_mask(data + i);
+
+    while (mask) {
+      size_t bit = (size_t)__builtin_ctz(mask);
+      if (!line_index_push(index, &capacity, i + bit + 1))
+        goto fail;
+      mask &= mask - 1;
+    }
+  }
+
+  for (; i < length; i++) {
+    if (data[i] == '\n' && !line_index_push(index, &capacity, i + 1))
+      goto fail;
+  }
+
+  return LINE_INDEX_OK;
+
+fail:
+  free_line_index(index);
+  return LINE_INDEX_ERROR_MEMORY_ALLOCATION;
+}
+
+/**
+ * Finds the line and column of an offset with a binary search for the last
+ * line starting at or before it.
+ */
+LineIndexError line_index_locate(LineIndex *index, size_t offset,
+                                 SourceLocation *location) {
+  if (!index || !location || (!index->data && index->length > 0))
+    return LINE_INDEX_ERROR_NULL_PTR;
+
+  if (offset > index->length)
+    return LINE_INDEX_ERROR_OUT_OF_RANGE;
+
+  if (index->count == 0) {
+    LineIndexError error = line_index_build(index);
+    if (error != LINE_INDEX_OK)
+      return error;
+  }
+
+  size_t low = 0;
+  size_t high = index->count;
+
+  while (high - low > 1) {
+    size_t middle = low + (high - low) / 2;
+    if (index->starts[middle] <= offset) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  location->line = low + 1;
+  location->column = offset - index->starts[low] + 1;
+
+  return LINE_INDEX_OK;
+}
@@ -1,8 +1,8 @@
-#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "../include/lexer.h"
+#include "../include/number.h"
 
 /**
  * Initializes the lexer with the given source code.
@@ -17,17 +17,42 @@ LexerInitError init_lexer(Lexer *lexer, const char *source) {
     return LEXER_INIT_ERROR_NULL_PTR;
   }
 
+  if (!source) {
+    return LEXER_INIT_ERROR_TOKENIZER;
+  }
+
+  Source text;
+  init_source_string(&text, source);
+
+  return init_lexer_source(lexer, &text);
+}
+
+/**
+ * Initializes the lexer over a contiguous or streamed source.
+ *
+ * @param lexer A pointer to the Lexer structure to initialize.
+ * @param source The source to tokenize. Must not be NULL.
+ * @return A LexerInitError code indicating the success or failure of
+ * initialization.
+ */
+LexerInitError init_lexer_source(Lexer *lexer, const Source *source) {
+  if (!lexer) {
+    return LEXER_INIT_ERROR_NULL_PTR;
+  }
+
   Tokenizer *tokenizer = (Tokenizer *)malloc(sizeof(Tokenizer));
   if (!tokenizer) {
     return LEXER_INIT_ERROR_MEMORY_ALLOCATION;
   }
 
-  if (init_tokenizer(tokenizer, source) != TOKENIZER_INIT_OK) {
+  if (init_tokenizer_source(tokenizer, source) != TOKENIZER_INIT_OK) {
     free(tokenizer);
     return LEXER_INIT_ERROR_TOKENIZER;
   }
 
   lexer->tokenizer = tokenizer;
+  lexer->atoms = NULL;
+  lexer->number = 0.0;
 
   return LEXER_INIT_OK;
 }
@@ -45,50 +70,193 @@ void free_lexer(Lexer *lexer) {
     return;
 
   if (lexer->tokenizer) {
+    free_tokenizer(lexer->tokenizer);
     free(lexer->tokenizer);
+    lexer->tokenizer = NULL;
   }
 }
 
+/*
+ * Keywords are recognized with a perfect hash over the length, first and last
+ * character of an identifier. The multipliers were chosen offline so that no
+ * two keywords share a slot in the 128-entry table; adding a keyword requires
+ * re-checking that property (test_lexer_recognizes_every_keyword does).
+ */
+#define KEYWORD_TABLE_SIZE 128
+#define KEYWORD_MAX_LENGTH 10
+
+#define KEYWORD_HASH(length, first, last)                                      \
+  (((length) + (first) * 30 + (last) * 27) & (KEYWORD_TABLE_SIZE - 1))
+
+#define KEYWORD(text, first, last, token_type)                                 \
+  [KEYWORD_HASH(sizeof(text) - 1, first, last)] = {text, sizeof(text) - 1,     \
+                                                   token_type}
+
+typedef struct {
+  const char *text;
+  size_t length;
+  TokenType type;
+} Keyword;
+
+static const Keyword keywords[KEYWORD_TABLE_SIZE] = {
+    KEYWORD("await", 'a', 't', TOKEN_AWAIT),
+    KEYWORD("break", 'b', 'k', TOKEN_BREAK),
+    KEYWORD("case", 'c', 'e', TOKEN_CASE),
+    KEYWORD("catch", 'c', 'h', TOKEN_CATCH),
+    KEYWORD("class", 'c', 's', TOKEN_CLASS),
+    KEYWORD("const", 'c', 't', TOKEN_CONST),
+    KEYWORD("continue", 'c', 'e', TOKEN_CONTINUE),
+    KEYWORD("debugger", 'd', 'r', TOKEN_DEBUGGER),
+    KEYWORD("default", 'd', 't', TOKEN_DEFAULT),
+    KEYWORD("delete", 'd', 'e', TOKEN_DELETE),
+    KEYWORD("do", 'd', 'o', TOKEN_DO),
+    KEYWORD("else", 'e', 'e', TOKEN_ELSE),
+    KEYWORD("enum", 'e', 'm', TOKEN_ENUM),
+    KEYWORD("export", 'e', 't', TOKEN_EXPORT),
+    KEYWORD("extends", 'e', 's', TOKEN_EXTENDS),
+    KEYWORD("false", 'f', 'e', TOKEN_FALSE),
+    KEYWORD("finally", 'f', 'y', TOKEN_FINALLY),
+    KEYWORD("for", 'f', 'r', TOKEN_FOR),
+    KEYWORD("function", 'f', 'n', TOKEN_FUNCTION),
+    KEYWORD("if", 'i', 'f', TOKEN_IF),
+    KEYWORD("import", 'i', 't', TOKEN_IMPORT),
+    KEYWORD("in", 'i', 'n', TOKEN_IN),
+    KEYWORD("instanceof", 'i', 'f', TOKEN_INSTANCEOF),
+    KEYWORD("let", 'l', 't', TOKEN_LET),
+    KEYWORD("new", 'n', 'w', TOKEN_NEW),
+    KEYWORD("null", 'n', 'l', TOKEN_NULL),
+    KEYWORD("return", 'r', 'n', TOKEN_RETURN),
+    KEYWORD("static", 's', 'c', TOKEN_STATIC),
+    KEYWORD("super", 's', 'r', TOKEN_SUPER),
+    KEYWORD("switch", 's', 'h', TOKEN_SWITCH),
+    KEYWORD("this", 't', 's', TOKEN_THIS),
+    KEYWORD("throw", 't', 'w', TOKEN_THROW),
+    KEYWORD("true", 't', 'e', TOKEN_TRUE),
+    KEYWORD("try", 't', 'y', TOKEN_TRY),
+    KEYWORD("typeof", 't', 'f', TOKEN_TYPEOF),
+    KEYWORD("var", 'v', 'r', TOKEN_VAR),
+    KEYWORD("void", 'v', 'd', TOKEN_VOID),
+    KEYWORD("while", 'w', 'e', TOKEN_WHILE),
+    KEYWORD("with", 'w', 'h', TOKEN_WITH),
+    KEYWORD("yield", 'y', 'd', TOKEN_YIELD),
+};
+
 /**
- * Helper function to classify a token string into a TokenType.
+ * Helper function to look up an identifier in the keyword table. Only an
+ * identifier hashing to a slot whose keyword has the same length and first
+ * character is ever compared byte by byte.
  */
-static TokenType classify_token(const char *token) {
-  if (isdigit(token[0])) {
-    return TOKEN_NUMBER;
+static TokenType classify_identifier(const char *text, size_t length) {
+  if (length > KEYWORD_MAX_LENGTH) {
+    return TOKEN_IDENTIFIER;
   }
 
-  if (strcmp(token, "let") == 0) {
-    return TOKEN_LET;
+  unsigned char first = (unsigned char)text[0];
+  unsigned char last = (unsigned char)text[length - 1];
+  const Keyword *keyword = &keywords[KEYWORD_HASH(length, first, last)];
+
+  if (keyword->length != length || keyword->text[0] != text[0] ||
+      memcmp(keyword->text, text, length) != 0) {
+    return TOKEN_IDENTIFIER;
   }
 
-  if (token[0] == '+') {
-    return TOKEN_PLUS;
+  return keyword->type;
+}
+
+/**
+ * Helper function to classify a token's text into a TokenType.
+ */
+static TokenType classify_token(const char *text, size_t length) {
+  unsigned char first_class = char_classes[(unsigned char)text[0]];
+
+  /* The tokenizer only keeps a `.` with what follows it in `.5`. */
+  if ((first_class & CHAR_CLASS_DIGIT) || (text[0] == '.' && length > 1)) {
+    return TOKEN_NUMBER;
   }
 
-  if (token[0] == '=') {
-    return TOKEN_EQUAL;
+  if (first_class & CHAR_CLASS_IDENTIFIER_START) {
+    return classify_identifier(text, length);
   }
 
-  return TOKEN_UNKNOWN;
+  switch (text[0]) {
+  case '+':
+    return TOKEN_PLUS;
+  case '-':
+    return TOKEN_MINUS;
+  case '*':
+    return TOKEN_STAR;
+  case '/':
+    return TOKEN_SLASH;
+  case '%':
+    return TOKEN_PERCENT;
+  case '!':
+    return TOKEN_BANG;
+  case '=':
+    return TOKEN_EQUAL;
+  case ',':
+    return TOKEN_COMMA;
+  case '.':
+    return TOKEN_DOT;
+  case ':':
+    return TOKEN_COLON;
+  case '(':
+    return TOKEN_LEFT_PAREN;
+  case ')':
+    return TOKEN_RIGHT_PAREN;
+  case '{':
+    return TOKEN_LEFT_BRACE;
+  case '}':
+    return TOKEN_RIGHT_BRACE;
+  default:
+    return TOKEN_UNKNOWN;
+  }
 }
 
 /**
  * Retrieves the next token from the lexer.
  */
 LexerToken next_lexical_token(Lexer *lexer) {
-  LexerToken token = {.type = TOKEN_UNKNOWN, .value = ""};
+  LexerToken token = {
+      .type = TOKEN_EOF, .offset = 0, .length = 0, .payload = 0};
+
+  TokenSpan span = next_token(lexer->tokenizer);
+  token.offset = span.offset;
 
-  const char *value = next_token(lexer->tokenizer);
-  if (!value) {
-    token.type = TOKEN_EOF;
+  if (span.length == 0) {
     return token;
   }
 
-  token.type = classify_token(value);
-  strncpy(token.value, value, MAX_TOKEN_LENGTH - 1);
-  token.value[MAX_TOKEN_LENGTH - 1] = '\0';
+  const char *text = tokenizer_span_text(lexer->tokenizer, span);
+
+  token.type = classify_token(text, span.length);
+  token.length = (uint32_t)span.length;
 
-  free((void *)value);
+  if (token.type == TOKEN_NUMBER &&
+      !parse_number_literal(text, span.length, &lexer->number)) {
+    token.type = TOKEN_UNKNOWN;
+  } else if (token.type == TOKEN_IDENTIFIER && lexer->atoms) {
+    token.payload = atom_intern(lexer->atoms, text, span.length);
+  }
 
   return token;
 }
+
+/**
+ * Returns the error that ended the tokens of a lexer early.
+ */
+TokenizerError lexer_error(const Lexer *lexer) {
+  return lexer->tokenizer->error;
+}
+
+/**
+ * Returns a pointer to the source text of a token.
+ */
+const char *lexer_token_text(const Lexer *lexer, LexerToken token) {
+  TokenSpan span = {.offset = token.offset, .length = token.length};
+  return tokenizer_span_text(lexer->tokenizer, span);
+}
+
+/**
+ * Returns the value of the latest number token.
+ */
+double lexer_number(const Lexer *lexer) { return lexer->number; }
@@ -1,50 +1,282 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-#include "../include/ast.h"
+#include "../include/batch.h"
+#include "../include/cache.h"
+#include "../include/compiler.h"
+#include "../include/diagnostic.h"
+#include "../include/vm.h"
+
+/*
+ * Command-line runner: loads and parses the scripts given on the command line,
+ * in parallel with `--jobs`, then for each script in order prints its syntax
+ * tree, resolves its variables, compiles it to bytecode and runs it, then
+ * prints the value of every variable. A script with syntax errors is not run;
+ * each error is reported with its line and column. With `--time` the cost of
+ * loading, lexing, parsing, compiling (resolution included) and running every
+ * script is reported on stderr. With `--cache` the tree and bytecode of every
+ * script are kept in a directory and reused while the script is unchanged.
+ */
+
+static void print_usage(const char *program) {
+  fprintf(stderr, "Usage: %s [--time] [--jobs N] [--cache DIR] <script>...\n",
+          program);
+  fprintf(stderr, "  --jobs N     parse with N threads, 0 for one per CPU "
+                  "(default: 1)\n");
+  fprintf(stderr, "  --cache DIR  reuse the trees and bytecode of unchanged "
+                  "scripts from DIR\n");
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Helper function printing the syntax errors of a script. Lines are only
+ * located here, once there is something to report.
+ */
+static void print_diagnostics(const ParsedFile *file) {
+  const DiagnosticList *diagnostics = &file->ast.diagnostics;
+  LineIndex lines;
+  init_line_index(&lines, file->source.data, file->source.length);
+
+  for (size_t i = 0; i < diagnostics->count; i++) {
+    const Diagnostic *diagnostic = &diagnostics->items[i];
+    SourceLocation location;
+
+    if (line_index_locate(&lines, diagnostic->offset, &location) ==
+        LINE_INDEX_OK) {
+      fprintf(stderr, "%s:%zu:%zu: error: %s\n", file->path, location.line,
+              location.column, diagnostic_message(diagnostic->code));
+    } else {
+      fprintf(stderr, "%s: error: %s\n", file->path,
+              diagnostic_message(diagnostic->code));
+    }
+  }
+
+  free_line_index(&lines);
+}
+
+/*
+ * Helper function compiling, running and printing a parsed script. A script
+ * found in the cache runs its cached bytecode; any other script is added to
+ * the cache once compiled, when there is one.
+ *
+ * @return true on success, false if the script could not be run.
+ */
+static bool run_file(ParsedFile *file, bool timing,
+                     const char *cache_directory) {
+  const char *path = file->path;
+
+  switch (file->status) {
+  case PARSE_FILE_OK:
+    break;
+  case PARSE_FILE_ERROR_LOAD:
+    fprintf(stderr, "%s: could not load the file (error code: %d)\n", path,
+            file->error);
+    return false;
+  case PARSE_FILE_ERROR_INIT:
+    fprintf(stderr, "%s: AST initialization failed with error code: %d\n",
+            path, file->error);
+    return false;
+  case PARSE_FILE_ERROR_MEMORY:
+    fprintf(stderr, "%s: out of memory while parsing\n", path);
+    return false;
+  }
+
+  if (file->ast.diagnostics.count > 0) {
+    print_diagnostics(file);
+    return false;
+  }
+
+  /* An empty script is an empty program. */
+  if (!file->program) {
+    printf("SOURCE NODE\n");
+    return true;
+  }
+
+  ast_node_print(file->program);
+
+  double start = now_seconds();
+
+  bool hit = file->cached.mapping != NULL;
+  Chunk compiled;
+  init_chunk(&compiled);
+  const Chunk *chunk = hit ? &file->cached.chunk : &compiled;
+
+  ResolveError resolve_error =
+      hit ? RESOLVE_OK : resolve_program(file->program);
+  if (resolve_error != RESOLVE_OK) {
+    fprintf(stderr, "%s: resolution failed with error code: %d\n", path,
+            resolve_error);
+    free_chunk(&compiled);
+    return false;
+  }
+
+  CompileError compile_error =
+      hit ? COMPILE_OK : compile_program(file->program, &compiled);
+  double compiled_at = now_seconds();
+
+  if (compile_error != COMPILE_OK) {
+    fprintf(stderr, "%s: compilation failed with error code: %d\n", path,
+            compile_error);
+    free_chunk(&compiled);
+    return false;
+  }
+
+  VM vm;
+  init_vm(&vm);
+  VMRunResult run_result = vm_run(&vm, chunk);
+  double ran = now_seconds();
+
+  if (run_result != VM_RUN_OK) {
+    fprintf(stderr, "%s: execution failed with error code: %d\n", path,
+            run_result);
+    free_vm(&vm);
+    free_chunk(&compiled);
+    return false;
+  }
+
+  for (size_t i = 0; i < chunk->variable_count; i++) {
+    printf("%s = ", chunk->variables[i]);
+    value_print(vm.registers[i]);
+    printf("\n");
+  }
+
+  if (timing) {
+    /* The parser drives its own lexer, so the parse time includes lexing. On
+     * a cache hit it is the time spent loading the cache file instead. */
+    fprintf(stderr,
+            "%s: %zu bytes  load %.3f ms  lex %.3f ms (%ld tokens)  "
+            "parse %.3f ms (%zu statements%s)  compile %.3f ms (%zu words)  "
+            "run %.3f ms (%llu inline cache hits, %llu misses)\n",
+            path, file->source.length, file->load_seconds * 1e3,
+            file->lex_seconds * 1e3, file->tokens, file->parse_seconds * 1e3,
+            file->program->children_count, hit ? ", cached" : "",
+            (compiled_at - start) * 1e3, chunk->code_count,
+            (ran - compiled_at) * 1e3, (unsigned long long)vm.ic_hits,
+            (unsigned long long)vm.ic_misses);
+
+    const HeapStats *gc = &vm.heap.stats;
+    double run_seconds = ran - compiled_at;
+    fprintf(stderr,
+            "%s: gc %llu minor, %llu major  pause %.3f ms (max %.3f ms)  "
+            "allocated %.1f KB (%.1f MB/s)  promoted %.1f KB\n",
+            path, (unsigned long long)gc->minor_collections,
+            (unsigned long long)gc->major_collections,
+            gc->pause_seconds * 1e3, gc->max_pause_seconds * 1e3,
+            (double)gc->bytes_allocated / 1024.0,
+            run_seconds > 0 ? (double)gc->bytes_allocated / run_seconds /
+                                  (1024.0 * 1024.0)
+                            : 0.0,
+            (double)gc->bytes_promoted / 1024.0);
+  }
+
+  if (cache_directory && !hit) {
+    CacheError cache_error =
+        cache_store(cache_directory, &file->source, file->program, &compiled);
+    if (cache_error != CACHE_OK) {
+      fprintf(stderr, "%s: could not be cached (error code: %d)\n", path,
+              cache_error);
+    }
+  }
+
+  free_vm(&vm);
+  free_chunk(&compiled);
+
+  return true;
+}
 
 int main(int argc, char **argv) {
-  const char *source = "let a = 1;";
-
-  // Lexer lexer;
-  // LexerError lexer_err = init_lexer(&lexer, source);
-  //
-  // if (lexer_err != LEXER_OK) {
-  //   fprintf(stderr, "Lexer initialization failed with error code: %d\n",
-  //           lexer_err);
-  //   return EXIT_FAILURE;
-  // }
-  //
-  // while (1) {
-  //   LexerToken token = next_lexical_token(&lexer);
-  //
-  //   if (token.type == TOKEN_EOF) {
-  //     printf("End of source reached.\n");
-  //     break;
-  //   }
-  //
-  //   if (token.type == TOKEN_UNKNOWN) {
-  //     fprintf(stderr, "Unknown token encountered: %s\n", token.value);
-  //   } else {
-  //     printf("Token: Type = %d, Value = '%s'\n", token.type, token.value);
-  //   }
-  // }
-  //
-  // free_lexer(&lexer);
-
-  AST ast;
-  ASTInitError ast_error = init_ast(&ast, source);
-  if (ast_error != AST_INIT_OK) {
-    fprintf(stderr, "Lexer initialization failed with error code: %d\n",
-            ast_error);
+  BatchOptions options = {
+      .threads = 1, .measure = false, .cache_directory = NULL};
+  int first_path = 1;
+
+  for (; first_path < argc; first_path++) {
+    const char *arg = argv[first_path];
+
+    if (strcmp(arg, "--time") == 0) {
+      options.measure = true;
+    } else if (strcmp(arg, "--jobs") == 0 || strcmp(arg, "-j") == 0) {
+      char *end = NULL;
+      long jobs = first_path + 1 < argc
+                      ? strtol(argv[first_path + 1], &end, 10)
+                      : -1;
+      if (!end || *end != '\0' || jobs < 0) {
+        fprintf(stderr, "%s expects a number of threads\n", arg);
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      options.threads = (unsigned)jobs;
+      first_path++;
+    } else if (strcmp(arg, "--cache") == 0) {
+      if (first_path + 1 >= argc) {
+        fprintf(stderr, "%s expects a directory\n", arg);
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      options.cache_directory = argv[++first_path];
+    } else if (strcmp(arg, "--") == 0) {
+      first_path++;
+      break;
+    } else if (arg[0] == '-' && arg[1] != '\0') {
+      fprintf(stderr, "Unknown option: %s\n", arg);
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    } else {
+      break;
+    }
+  }
+
+  if (first_path >= argc) {
+    print_usage(argv[0]);
     return EXIT_FAILURE;
   }
 
-  ASTNode *program = ast_parse_program(&ast);
+  size_t count = (size_t)(argc - first_path);
+  ParsedFile *files = (ParsedFile *)calloc(count, sizeof(ParsedFile));
+  if (!files) {
+    fprintf(stderr, "Out of memory\n");
+    return EXIT_FAILURE;
+  }
 
-  ast_node_print(program);
+  for (size_t i = 0; i < count; i++) {
+    files[i].path = argv[first_path + (int)i];
+  }
+
+  double start = now_seconds();
+  BatchError batch_error = parse_files(files, count, &options);
+  double parsed = now_seconds();
+
+  if (batch_error != BATCH_OK) {
+    fprintf(stderr, "Parsing failed with error code: %d\n", batch_error);
+    free(files);
+    return EXIT_FAILURE;
+  }
+
+  if (options.measure) {
+    fprintf(stderr, "parsed %zu files in %.3f ms on %u threads\n", count,
+            (parsed - start) * 1e3,
+            options.threads ? options.threads : batch_default_threads());
+  }
+
+  /* Scripts are run and reported in command-line order, whatever order the
+   * workers parsed them in. */
+  int status = EXIT_SUCCESS;
+
+  for (size_t i = 0; i < count; i++) {
+    if (!run_file(&files[i], options.measure, options.cache_directory)) {
+      status = EXIT_FAILURE;
+    }
+    free_parsed_file(&files[i]);
+  }
 
-  free_ast(&ast);
+  free(files);
 
-  return EXIT_SUCCESS;
+  return status;
 }
@@ -0,0 +1,504 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/object.h"
+
+/**
+ * Initializes an empty heap.
+ *
+ * @param heap A pointer to the Heap to initialize.
+ */
+void init_heap(Heap *heap) {
+  if (!heap)
+    return;
+
+  *heap = (Heap){.nursery_size = HEAP_NURSERY_SIZE,
+                 .old_limit = HEAP_MIN_OLD_LIMIT};
+  init_arena(&heap->arena);
+}
+
+/**
+ * Releases every object and shape of a heap.
+ *
+ * @param heap A pointer to the Heap to free.
+ */
+void free_heap(Heap *heap) {
+  if (!heap)
+    return;
+
+  heap_free_objects(heap);
+  free(heap->nursery);
+  free(heap->old.items);
+  free(heap->remembered.items);
+  free(heap->external.items);
+  free(heap->gray.items);
+  free_arena(&heap->arena);
+  init_heap(heap);
+}
+
+/*
+ * Helper function releasing an old object and its slots.
+ */
+static void free_old_object(Object *object) {
+  free(object->slots);
+  free(object);
+}
+
+/**
+ * Releases every object of a heap, keeping its shapes and statistics.
+ *
+ * @param heap A pointer to the Heap whose objects to free.
+ */
+void heap_free_objects(Heap *heap) {
+  if (!heap)
+    return;
+
+  for (size_t i = 0; i < heap->old.count; i++) {
+    free_old_object(heap->old.items[i]);
+  }
+
+  /* The slots of a forwarded object belong to its copy. */
+  for (size_t i = 0; i < heap->external.count; i++) {
+    if (heap->external.items[i]->generation == OBJECT_YOUNG)
+      free(heap->external.items[i]->slots);
+  }
+
+  heap->old.count = 0;
+  heap->remembered.count = 0;
+  heap->external.count = 0;
+  heap->gray.count = 0;
+  heap->nursery_used = 0;
+  heap->old_bytes = 0;
+  heap->old_limit = HEAP_MIN_OLD_LIMIT;
+}
+
+/*
+ * Helper function appending an object to a list.
+ *
+ * @return 1 on success, 0 if the list could not be grown.
+ */
+static int list_push(ObjectList *list, Object *object) {
+  if (list->count == list->capacity) {
+    size_t capacity = list->capacity ? list->capacity * 2 : 64;
+
+    Object **items =
+        (Object **)realloc(list->items, sizeof(Object *) * capacity);
+    if (!items)
+      return 0;
+
+    list->items = items;
+    list->capacity = capacity;
+  }
+
+  list->items[list->count++] = object;
+
+  return 1;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Helper function carving `size` bytes from the nursery. Never collects.
+ *
+ * @return The memory, or NULL if the nursery is full or could not be
+ * allocated.
+ */
+static void *heap_alloc_young(Heap *heap, size_t size) {
+  if (!heap->nursery) {
+    heap->nursery = (char *)malloc(heap->nursery_size);
+    if (!heap->nursery)
+      return NULL;
+  }
+
+  if (size > heap->nursery_size - heap->nursery_used)
+    return NULL;
+
+  void *memory = heap->nursery + heap->nursery_used;
+  heap->nursery_used += size;
+  heap->stats.bytes_allocated += size;
+
+  return memory;
+}
+
+/*
+ * Helper function allocating a shape in the heap's arena.
+ */
+static Shape *heap_new_shape(Heap *heap, Shape *parent, uint32_t name) {
+  Shape *shape = (Shape *)arena_alloc(&heap->arena, sizeof(Shape));
+  if (!shape)
+    return NULL;
+
+  shape->parent = parent;
+  shape->children = NULL;
+  shape->sibling = NULL;
+  shape->name = name;
+  shape->slot_count = parent ? parent->slot_count + 1 : 0;
+  heap->shape_count++;
+
+  return shape;
+}
+
+/**
+ * Allocates an object without properties in the nursery, collecting garbage
+ * first if it is full.
+ */
+Object *heap_new_object(Heap *heap) {
+  if (!heap->root) {
+    heap->root = heap_new_shape(heap, NULL, SHAPE_NO_SLOT);
+    if (!heap->root)
+      return NULL;
+  }
+
+  Object *object = (Object *)heap_alloc_young(heap, sizeof(Object));
+  if (!object && heap->nursery) {
+    if (!heap_collect(heap, false))
+      return NULL;
+    object = (Object *)heap_alloc_young(heap, sizeof(Object));
+  }
+  if (!object)
+    return NULL;
+
+  *object = (Object){.shape = heap->root, .generation = OBJECT_YOUNG};
+
+  return object;
+}
+
+/**
+ * Returns the shape adding a property to a shape. The children of a shape are
+ * few in practice, so they are searched linearly.
+ */
+Shape *shape_transition(Heap *heap, Shape *shape, uint32_t name) {
+  for (Shape *child = shape->children; child; child = child->sibling) {
+    if (child->name == name)
+      return child;
+  }
+
+  Shape *child = heap_new_shape(heap, shape, name);
+  if (!child)
+    return NULL;
+
+  child->sibling = shape->children;
+  shape->children = child;
+
+  return child;
+}
+
+/**
+ * Returns the slot of a property in a shape, walking from the last property
+ * added to the first. This is the slow path that inline caches avoid.
+ */
+uint32_t shape_find_slot(const Shape *shape, uint32_t name) {
+  for (; shape && shape->parent; shape = shape->parent) {
+    if (shape->name == name)
+      return shape->slot_count - 1;
+  }
+
+  return SHAPE_NO_SLOT;
+}
+
+/**
+ * Reads a property of an object by name.
+ */
+Value object_get(const Object *object, uint32_t name) {
+  uint32_t slot = shape_find_slot(object->shape, name);
+  return slot == SHAPE_NO_SLOT ? value_undefined() : object->slots[slot];
+}
+
+/**
+ * Makes room in an object for `count` slots, doubling its capacity. The slots
+ * of a young object move to a larger block of the nursery, or to the C heap
+ * if the nursery is full.
+ */
+int object_reserve(Heap *heap, Object *object, uint32_t count) {
+  if (count <= object->capacity)
+    return 1;
+
+  uint32_t capacity = object->capacity ? object->capacity : 4;
+  while (capacity < count)
+    capacity *= 2;
+
+  size_t size = sizeof(Value) * capacity;
+
+  if (object->generation == OBJECT_YOUNG && !object->external) {
+    Value *slots = (Value *)heap_alloc_young(heap, size);
+    bool external = !slots;
+
+    if (external) {
+      slots = (Value *)malloc(size);
+      if (!slots || !list_push(&heap->external, object)) {
+        free(slots);
+        return 0;
+      }
+      heap->stats.bytes_allocated += size;
+    }
+
+    if (object->capacity > 0)
+      memcpy(slots, object->slots, sizeof(Value) * object->capacity);
+
+    object->slots = slots;
+    object->capacity = capacity;
+    object->external = external;
+
+    return 1;
+  }
+
+  Value *slots = (Value *)realloc(object->slots, size);
+  if (!slots)
+    return 0;
+
+  size_t grown = sizeof(Value) * (capacity - object->capacity);
+  heap->stats.bytes_allocated += grown;
+  if (object->generation == OBJECT_OLD)
+    heap->old_bytes += grown;
+
+  object->slots = slots;
+  object->capacity = capacity;
+
+  return 1;
+}
+
+/**
+ * Writes a property of an object by name, moving the object to a new shape if
+ * the property is added.
+ */
+int object_set(Heap *heap, Object *object, uint32_t name, Value value,
+               uint32_t *slot) {
+  uint32_t found = shape_find_slot(object->shape, name);
+
+  if (found == SHAPE_NO_SLOT) {
+    Shape *shape = shape_transition(heap, object->shape, name);
+    if (!shape || !object_reserve(heap, object, shape->slot_count))
+      return 0;
+
+    object->shape = shape;
+    found = shape->slot_count - 1;
+  }
+
+  if (!heap_write_barrier(heap, object, value))
+    return 0;
+
+  object->slots[found] = value;
+  if (slot)
+    *slot = found;
+
+  return 1;
+}
+
+/**
+ * Adds an old object to the remembered set.
+ */
+int heap_remember(Heap *heap, Object *object) {
+  if (!list_push(&heap->remembered, object))
+    return 0;
+
+  object->remembered = true;
+
+  return 1;
+}
+
+/*
+ * Helper function copying a young object to the old generation and leaving
+ * the address of the copy in it. The slots of the copy are traced later.
+ *
+ * @return The copy, or NULL if memory ran out.
+ */
+static Object *heap_promote(Heap *heap, Object *object) {
+  Object *copy = (Object *)malloc(sizeof(Object));
+  if (!copy || !list_push(&heap->old, copy)) {
+    free(copy);
+    return NULL;
+  }
+
+  uint32_t count = object->shape->slot_count;
+  *copy = (Object){.shape = object->shape, .generation = OBJECT_OLD};
+
+  if (object->external) {
+    /* Malloc'd slots change hands instead of being copied. */
+    copy->slots = object->slots;
+    copy->capacity = object->capacity;
+  } else if (count > 0) {
+    copy->slots = (Value *)malloc(sizeof(Value) * count);
+    if (!copy->slots) {
+      heap->old.count--;
+      free(copy);
+      return NULL;
+    }
+    memcpy(copy->slots, object->slots, sizeof(Value) * count);
+    copy->capacity = count;
+  }
+
+  size_t size = sizeof(Object) + sizeof(Value) * copy->capacity;
+  heap->old_bytes += size;
+  heap->stats.bytes_promoted += size;
+
+  object->generation = OBJECT_FORWARDED;
+  object->forward = copy;
+
+  return copy;
+}
+
+/*
+ * Helper function making a value that refers to a young object refer to its
+ * copy in the old generation, promoting the object first if needed.
+ *
+ * @return 1 on success, 0 if memory ran out.
+ */
+static int heap_trace(Heap *heap, Value *value) {
+  if (!value_is_object(*value))
+    return 1;
+
+  Object *object = (Object *)value_as_object(*value);
+  if (object->generation == OBJECT_OLD)
+    return 1;
+  if (object->generation == OBJECT_YOUNG && !heap_promote(heap, object))
+    return 0;
+
+  *value = value_object(object->forward);
+
+  return 1;
+}
+
+/*
+ * Helper function tracing the properties of an old object.
+ */
+static int heap_trace_slots(Heap *heap, Object *object) {
+  for (uint32_t i = 0; i < object->shape->slot_count; i++) {
+    if (!heap_trace(heap, &object->slots[i]))
+      return 0;
+  }
+
+  return 1;
+}
+
+/*
+ * Helper function running a minor collection. The young objects reachable
+ * from the roots and the remembered set are promoted, then the slots of the
+ * promoted objects are traced in turn, in the order they were promoted,
+ * until no new object is promoted. The nursery is then empty.
+ */
+static int heap_collect_young(Heap *heap) {
+  size_t scanned = heap->old.count;
+
+  for (size_t i = 0; i < heap->root_count; i++) {
+    if (!heap_trace(heap, &heap->roots[i]))
+      return 0;
+  }
+
+  for (size_t i = 0; i < heap->remembered.count; i++) {
+    Object *object = heap->remembered.items[i];
+    if (!heap_trace_slots(heap, object))
+      return 0;
+    object->remembered = false;
+  }
+  heap->remembered.count = 0;
+
+  while (scanned < heap->old.count) {
+    if (!heap_trace_slots(heap, heap->old.items[scanned++]))
+      return 0;
+  }
+
+  /* Nursery memory is reused as is, but dead objects may own slots. */
+  for (size_t i = 0; i < heap->external.count; i++) {
+    if (heap->external.items[i]->generation == OBJECT_YOUNG)
+      free(heap->external.items[i]->slots);
+  }
+  heap->external.count = 0;
+
+  heap->nursery_used = 0;
+  heap->stats.minor_collections++;
+
+  return 1;
+}
+
+/*
+ * Helper function marking an object and queuing it to have its properties
+ * marked.
+ */
+static int heap_mark(Heap *heap, Value value) {
+  if (!value_is_object(value))
+    return 1;
+
+  Object *object = (Object *)value_as_object(value);
+  if (object->marked)
+    return 1;
+
+  object->marked = true;
+
+  return list_push(&heap->gray, object);
+}
+
+/*
+ * Helper function running a major collection right after a minor one, when
+ * every object is old. The objects reachable from the roots are marked, with
+ * an explicit stack rather than recursion, and the others are freed.
+ */
+static int heap_collect_old(Heap *heap) {
+  int ok = 1;
+  heap->gray.count = 0;
+
+  for (size_t i = 0; ok && i < heap->root_count; i++) {
+    ok = heap_mark(heap, heap->roots[i]);
+  }
+
+  while (ok && heap->gray.count > 0) {
+    Object *object = heap->gray.items[--heap->gray.count];
+    for (uint32_t i = 0; ok && i < object->shape->slot_count; i++) {
+      ok = heap_mark(heap, object->slots[i]);
+    }
+  }
+
+  if (!ok) {
+    for (size_t i = 0; i < heap->old.count; i++) {
+      heap->old.items[i]->marked = false;
+    }
+    heap->gray.count = 0;
+    return 0;
+  }
+
+  size_t kept = 0;
+  heap->old_bytes = 0;
+
+  for (size_t i = 0; i < heap->old.count; i++) {
+    Object *object = heap->old.items[i];
+
+    if (object->marked) {
+      object->marked = false;
+      heap->old.items[kept++] = object;
+      heap->old_bytes += sizeof(Object) + sizeof(Value) * object->capacity;
+    } else {
+      free_old_object(object);
+    }
+  }
+
+  heap->old.count = kept;
+  heap->old_limit = heap->old_bytes * 2 > HEAP_MIN_OLD_LIMIT
+                        ? heap->old_bytes * 2
+                        : HEAP_MIN_OLD_LIMIT;
+  heap->stats.major_collections++;
+
+  return 1;
+}
+
+/**
+ * Collects the nursery, then the old generation if asked to or if it outgrew
+ * its limit.
+ */
+int heap_collect(Heap *heap, bool major) {
+  double start = now_seconds();
+
+  int ok = heap_collect_young(heap);
+  if (ok && (major || heap->old_bytes >= heap->old_limit))
+    ok = heap_collect_old(heap);
+
+  double pause = now_seconds() - start;
+  heap->stats.pause_seconds += pause;
+  if (pause > heap->stats.max_pause_seconds)
+    heap->stats.max_pause_seconds = pause;
+
+  return ok;
+}
@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/resolver.h"
+
+/*
+ * Entry of the visibility table meaning that no binding has the atom.
+ */
+#define NO_BINDING UINT32_MAX
+
+/*
+ * A declared name. Bindings form a stack: leaving a function pops the
+ * bindings it declared, which makes the ones they shadowed visible again.
+ */
+typedef struct {
+  Atom atom;         /* The declared name. */
+  uint32_t level;    /* Nesting level of the declaring function. */
+  uint32_t slot;     /* Index of the variable in that function's frame. */
+  bool constant;     /* Whether the variable is a `const` one. */
+  uint32_t shadowed; /* Binding visible for the atom before this one. */
+} Binding;
+
+/*
+ * A node left to visit or, when `node` is NULL, the end of the function whose
+ * bindings start at `base`.
+ */
+typedef struct {
+  ASTNode *node;
+  uint32_t base;
+} ResolveTask;
+
+/*
+ * State of a resolution. The innermost binding of every name is found through
+ * a table indexed by the atom of the name. Nodes are visited from an explicit
+ * stack, so that deeply nested expressions do not exhaust the call stack.
+ */
+typedef struct {
+  Binding *bindings;         /* Bindings of the functions being resolved. */
+  uint32_t binding_count;    /* Number of bindings in `bindings`. */
+  uint32_t binding_capacity; /* Number of bindings `bindings` can hold. */
+  uint32_t *visible;         /* Innermost binding of every atom seen. */
+  size_t atom_capacity;      /* Number of atoms `visible` covers. */
+  ResolveTask *tasks;        /* Nodes left to visit. */
+  size_t task_count;         /* Number of tasks in `tasks`. */
+  size_t task_capacity;      /* Number of tasks `tasks` can hold. */
+  uint32_t level;            /* Nesting level of the current function. */
+} Resolver;
+
+/*
+ * Helper function returning the innermost binding of an atom, or NO_BINDING
+ * if the atom is not declared.
+ */
+static uint32_t resolver_lookup(const Resolver *resolver, Atom atom) {
+  return atom < resolver->atom_capacity ? resolver->visible[atom] : NO_BINDING;
+}
+
+/*
+ * Helper function declaring a name in the current function, whose bindings
+ * start at `base`.
+ *
+ * @return RESOLVE_OK with the slot of the variable in `slot`, or an error
+ * code.
+ */
+static ResolveError resolver_declare(Resolver *resolver, Atom atom,
+                                     bool constant, uint32_t base,
+                                     uint32_t *slot) {
+  if (atom == ATOM_INVALID)
+    return RESOLVE_ERROR_MEMORY_ALLOCATION;
+
+  if (atom >= resolver->atom_capacity) {
+    size_t capacity = resolver->atom_capacity ? resolver->atom_capacity : 64;
+    while (capacity <= atom)
+      capacity *= 2;
+
+    uint32_t *visible = (uint32_t *)realloc(resolver->visible,
+                                            sizeof(uint32_t) * capacity);
+    if (!visible)
+      return RESOLVE_ERROR_MEMORY_ALLOCATION;
+
+    memset(visible + resolver->atom_capacity, 0xff,
+           sizeof(uint32_t) * (capacity - resolver->atom_capacity));
+    resolver->visible = visible;
+    resolver->atom_capacity = capacity;
+  }
+
+  uint32_t shadowed = resolver->visible[atom];
+  if (shadowed != NO_BINDING &&
+      resolver->bindings[shadowed].level == resolver->level)
+    return RESOLVE_ERROR_REDECLARED;
+
+  if (resolver->binding_count == resolver->binding_capacity) {
+    uint32_t capacity =
+        resolver->binding_capacity ? resolver->binding_capacity * 2 : 64;
+
+    Binding *bindings = (Binding *)realloc(resolver->bindings,
+                                           sizeof(Binding) * capacity);
+    if (!bindings)
+      return RESOLVE_ERROR_MEMORY_ALLOCATION;
+
+    resolver->bindings = bindings;
+    resolver->binding_capacity = capacity;
+  }
+
+  *slot = resolver->binding_count - base;
+  resolver->bindings[resolver->binding_count] =
+      (Binding){.atom = atom,
+                .level = resolver->level,
+                .slot = *slot,
+                .constant = constant,
+                .shadowed = shadowed};
+  resolver->visible[atom] = resolver->binding_count++;
+
+  return RESOLVE_OK;
+}
+
+/*
+ * Helper function pushing a node to visit, or the end of a function when
+ * `node` is NULL.
+ */
+static ResolveError resolver_push(Resolver *resolver, ASTNode *node,
+                                  uint32_t base) {
+  if (resolver->task_count == resolver->task_capacity) {
+    size_t capacity =
+        resolver->task_capacity ? resolver->task_capacity * 2 : 64;
+
+    ResolveTask *tasks = (ResolveTask *)realloc(
+        resolver->tasks, sizeof(ResolveTask) * capacity);
+    if (!tasks)
+      return RESOLVE_ERROR_MEMORY_ALLOCATION;
+
+    resolver->tasks = tasks;
+    resolver->task_capacity = capacity;
+  }
+
+  resolver->tasks[resolver->task_count++] =
+      (ResolveTask){.node = node, .base = base};
+
+  return RESOLVE_OK;
+}
+
+/*
+ * Helper function declaring the variables and functions of a block of
+ * statements before any of them is visited, and queuing the statements.
+ */
+static ResolveError resolver_hoist(Resolver *resolver, ASTNode *block,
+                                   uint32_t base) {
+  ResolveError error = RESOLVE_OK;
+
+  for (size_t i = 0; i < block->children_count && error == RESOLVE_OK; i++) {
+    ASTNode *stmt = &block->children[i];
+
+    if (stmt->type == NODE_VARIABLE_DECLARATION) {
+      error = resolver_declare(resolver, stmt->data.declaration.atom,
+                               stmt->data.declaration.constant, base,
+                               &stmt->data.declaration.slot);
+    } else if (stmt->type == NODE_FUNCTION_DECLARATION) {
+      error = resolver_declare(resolver, stmt->data.function.atom, false,
+                               base, &stmt->data.function.slot);
+    }
+  }
+
+  /* Pushed in reverse, so that they are visited in source order. */
+  for (size_t i = block->children_count; i > 0 && error == RESOLVE_OK; i--) {
+    error = resolver_push(resolver, &block->children[i - 1], 0);
+  }
+
+  return error;
+}
+
+/*
+ * Helper function entering a function: its parameters and the declarations
+ * of its body get the slots of a new frame, and its body is queued, followed
+ * by the end of the function. Functions whose body is not parsed are left
+ * for `resolve_function`.
+ */
+static ResolveError resolver_enter(Resolver *resolver, ASTNode *function) {
+  if (function->children_count == 0)
+    return RESOLVE_OK;
+
+  ASTNode *body = &function->children[function->children_count - 1];
+  if (body->type != NODE_FUNCTION_BODY || !body->data.body.parsed)
+    return RESOLVE_OK;
+
+  uint32_t base = resolver->binding_count;
+  ResolveError error = resolver_push(resolver, NULL, base);
+  resolver->level++;
+
+  for (size_t i = 0; i + 1 < function->children_count && error == RESOLVE_OK;
+       i++) {
+    ASTNode *parameter = &function->children[i];
+    error = resolver_declare(resolver, parameter->data.identifier.atom, false,
+                             base, &parameter->data.identifier.slot);
+    parameter->data.identifier.depth = 0;
+  }
+
+  if (error == RESOLVE_OK)
+    error = resolver_hoist(resolver, body, base);
+
+  function->data.function.slot_count = resolver->binding_count - base;
+
+  return error;
+}
+
+/*
+ * Helper function leaving a function, popping the bindings it declared.
+ */
+static void resolver_leave(Resolver *resolver, uint32_t base) {
+  while (resolver->binding_count > base) {
+    const Binding *binding = &resolver->bindings[--resolver->binding_count];
+    resolver->visible[binding->atom] = binding->shadowed;
+  }
+
+  resolver->level--;
+}
+
+/*
+ * Helper function resolving a node and queuing its children.
+ */
+static ResolveError resolver_visit(Resolver *resolver, ASTNode *node) {
+  switch (node->type) {
+  case NODE_IDENTIFIER: {
+    uint32_t index = resolver_lookup(resolver, node->data.identifier.atom);
+
+    if (index == NO_BINDING) {
+      node->data.identifier.depth = AST_SCOPE_GLOBAL;
+      node->data.identifier.slot = 0;
+    } else {
+      const Binding *binding = &resolver->bindings[index];
+      node->data.identifier.depth = resolver->level - binding->level;
+      node->data.identifier.slot = binding->slot;
+    }
+    return RESOLVE_OK;
+  }
+
+  case NODE_ASSIGNMENT_EXPRESSION:
+    if (node->children_count > 0 &&
+        node->children[0].type == NODE_IDENTIFIER) {
+      uint32_t index =
+          resolver_lookup(resolver, node->children[0].data.identifier.atom);
+      if (index != NO_BINDING && resolver->bindings[index].constant)
+        return RESOLVE_ERROR_CONSTANT;
+    }
+    break;
+
+  case NODE_FUNCTION_DECLARATION:
+    return resolver_enter(resolver, node);
+
+  default:
+    break;
+  }
+
+  for (size_t i = node->children_count; i > 0; i--) {
+    ResolveError error = resolver_push(resolver, &node->children[i - 1], 0);
+    if (error != RESOLVE_OK)
+      return error;
+  }
+
+  return RESOLVE_OK;
+}
+
+/*
+ * Helper function visiting the queued nodes until none is left.
+ */
+static ResolveError resolver_run(Resolver *resolver) {
+  while (resolver->task_count > 0) {
+    ResolveTask task = resolver->tasks[--resolver->task_count];
+
+    if (!task.node) {
+      resolver_leave(resolver, task.base);
+      continue;
+    }
+
+    ResolveError error = resolver_visit(resolver, task.node);
+    if (error != RESOLVE_OK)
+      return error;
+  }
+
+  return RESOLVE_OK;
+}
+
+static void free_resolver(Resolver *resolver) {
+  free(resolver->bindings);
+  free(resolver->visible);
+  free(resolver->tasks);
+}
+
+/**
+ * Resolves the identifiers of a program.
+ *
+ * @param program The root node of the program.
+ * @return RESOLVE_OK on success, an error code otherwise.
+ */
+ResolveError resolve_program(ASTNode *program) {
+  if (!program)
+    return RESOLVE_ERROR_NULL_PTR;
+
+  Resolver resolver = {0};
+  program->data.scope.resolved = false;
+
+  ResolveError error = resolver_hoist(&resolver, program, 0);
+  program->data.scope.slot_count = resolver.binding_count;
+
+  if (error == RESOLVE_OK)
+    error = resolver_run(&resolver);
+
+  program->data.scope.resolved = error == RESOLVE_OK;
+  free_resolver(&resolver);
+
+  return error;
+}
+
+/**
+ * Resolves the identifiers of a top-level function parsed after its program
+ * was resolved. The declarations of the program are visible to it again, as
+ * they were when the program was resolved.
+ *
+ * @param program The program declaring the function.
+ * @param function The function to resolve.
+ * @return RESOLVE_OK on success, an error code otherwise.
+ */
+ResolveError resolve_function(ASTNode *program, ASTNode *function) {
+  if (!program || !function)
+    return RESOLVE_ERROR_NULL_PTR;
+
+  Resolver resolver = {0};
+
+  ResolveError error = resolver_hoist(&resolver, program, 0);
+
+  /* Only the function is visited. */
+  resolver.task_count = 0;
+
+  if (error == RESOLVE_OK && function->type == NODE_FUNCTION_DECLARATION)
+    error = resolver_enter(&resolver, function);
+  if (error == RESOLVE_OK)
+    error = resolver_run(&resolver);
+
+  free_resolver(&resolver);
+
+  return error;
+}
@@ -0,0 +1,180 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/source.h"
+
+/**
+ * Initializes a source over a NUL-terminated string.
+ */
+void init_source_string(Source *source, const char *text) {
+  init_source_buffer(source, text, text ? strlen(text) : 0);
+}
+
+/**
+ * Initializes a source over a buffer of known length.
+ */
+void init_source_buffer(Source *source, const char *data, size_t length) {
+  if (!source)
+    return;
+
+  memset(source, 0, sizeof(Source));
+  source->kind = SOURCE_BUFFER;
+  source->data = data;
+  source->length = length;
+}
+
+/**
+ * Initializes a source read in chunks through a callback.
+ */
+void init_source_stream(Source *source, SourceReadFn read, void *context,
+                        size_t chunk_size) {
+  if (!source)
+    return;
+
+  memset(source, 0, sizeof(Source));
+  source->kind = SOURCE_STREAM;
+  source->read = read;
+  source->context = context;
+  source->chunk_size = chunk_size;
+}
+
+/*
+ * Size of the buffer used to read a file of unknown size, such as a pipe. The
+ * buffer doubles whenever it fills up.
+ */
+#define SOURCE_READ_MIN_CAPACITY (64 * 1024)
+
+/*
+ * Helper function reading the whole of `fd` into a heap buffer, for files that
+ * cannot be mapped. `size_hint` is the size reported by fstat, 0 if unknown.
+ */
+static SourceOpenError read_source_file(Source *source, int fd,
+                                        size_t size_hint) {
+  size_t capacity = size_hint ? size_hint + 1 : SOURCE_READ_MIN_CAPACITY;
+  size_t length = 0;
+  char *data = (char *)malloc(capacity);
+  if (!data) {
+    return SOURCE_OPEN_ERROR_MEMORY_ALLOCATION;
+  }
+
+  while (1) {
+    if (length == capacity) {
+      char *grown = (char *)realloc(data, capacity * 2);
+      if (!grown) {
+        free(data);
+        return SOURCE_OPEN_ERROR_MEMORY_ALLOCATION;
+      }
+
+      data = grown;
+      capacity *= 2;
+    }
+
+    ssize_t count = read(fd, data + length, capacity - length);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+
+      free(data);
+      return SOURCE_OPEN_ERROR_IO;
+    }
+
+    if (count == 0)
+      break;
+
+    length += (size_t)count;
+  }
+
+  if (length == 0) {
+    free(data);
+    init_source_buffer(source, "", 0);
+    return SOURCE_OPEN_OK;
+  }
+
+  init_source_buffer(source, data, length);
+  source->kind = SOURCE_READ;
+
+  return SOURCE_OPEN_OK;
+}
+
+/**
+ * Opens a file by mapping it read-only into memory, or by reading it when it
+ * cannot be mapped.
+ *
+ * @param source A pointer to the Source to initialize.
+ * @param path The path of the file to open.
+ * @return SOURCE_OPEN_OK on success, an error code otherwise.
+ */
+SourceOpenError open_source_file(Source *source, const char *path) {
+  if (!source || !path) {
+    return SOURCE_OPEN_ERROR_NULL_PTR;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return SOURCE_OPEN_ERROR_IO;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return SOURCE_OPEN_ERROR_IO;
+  }
+
+  size_t size = S_ISREG(st.st_mode) ? (size_t)st.st_size : 0;
+
+  if (S_ISREG(st.st_mode) && size == 0) {
+    close(fd);
+    init_source_buffer(source, "", 0);
+    return SOURCE_OPEN_OK;
+  }
+
+  void *data = MAP_FAILED;
+  if (size > 0) {
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+
+  if (data == MAP_FAILED) {
+    SourceOpenError error = read_source_file(source, fd, size);
+    close(fd);
+    return error;
+  }
+
+  close(fd);
+
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  init_source_buffer(source, (const char *)data, size);
+  source->kind = SOURCE_MAPPED;
+
+  return SOURCE_OPEN_OK;
+}
+
+/**
+ * Releases the resources held by a source.
+ */
+void free_source(Source *source) {
+  if (!source)
+    return;
+
+  if (source->kind == SOURCE_MAPPED && source->data) {
+    munmap((void *)source->data, source->length);
+  } else if (source->kind == SOURCE_READ) {
+    free((void *)source->data);
+  }
+
+  source->data = NULL;
+  source->length = 0;
+}
+
+/**
+ * Reads the next chunk of a `FILE *`.
+ */
+size_t source_read_file(void *context, char *buffer, size_t capacity) {
+  return fread(buffer, 1, capacity, (FILE *)context);
+}
@@ -0,0 +1,660 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/token_array.h"
+
+/* Default minimum number of bytes lexed by each thread. */
+#define PARALLEL_LEX_CHUNK_SIZE (256 * 1024)
+
+/* How far past its nominal position a split looks for a delimiter. */
+#define PARALLEL_LEX_SPLIT_WINDOW 256
+
+/*
+ * A range of the source lexed by one thread. Tokens starting in
+ * [start, end) are recorded, with offsets relative to the whole source; the
+ * last one may end past `end`. Identifiers are interned into the chunk's own
+ * table and renumbered when the chunks are stitched together.
+ */
+typedef struct {
+  const Source *source;
+  size_t start;
+  size_t end;
+  bool intern;
+  TokenArray tokens;
+  AtomTable atoms;
+  TokenArrayError error;
+  pthread_t thread;
+  bool started;
+} LexChunk;
+
+/**
+ * Initializes an empty token array.
+ */
+void init_token_array(TokenArray *array) {
+  array->types = NULL;
+  array->offsets = NULL;
+  array->lengths = NULL;
+  array->payloads = NULL;
+  array->count = 0;
+  array->capacity = 0;
+}
+
+/**
+ * Releases the tokens of a token array.
+ */
+void free_token_array(TokenArray *array) {
+  if (!array)
+    return;
+
+  /* The offsets come first in the shared allocation. */
+  free(array->offsets);
+  init_token_array(array);
+}
+
+/*
+ * Helper function moving the tokens into a block holding `capacity` tokens.
+ * The widest fields come first so that every array stays aligned.
+ */
+static int token_array_grow(TokenArray *array, size_t capacity) {
+  char *block = (char *)malloc(
+      capacity * (2 * sizeof(size_t) + sizeof(uint64_t) + 1));
+  if (!block) {
+    return 0;
+  }
+
+  size_t *offsets = (size_t *)block;
+  size_t *lengths = offsets + capacity;
+  uint64_t *payloads = (uint64_t *)(lengths + capacity);
+  uint8_t *types = (uint8_t *)(payloads + capacity);
+
+  if (array->count > 0) {
+    memcpy(offsets, array->offsets, array->count * sizeof(size_t));
+    memcpy(lengths, array->lengths, array->count * sizeof(size_t));
+    memcpy(payloads, array->payloads, array->count * sizeof(uint64_t));
+    memcpy(types, array->types, array->count);
+  }
+
+  free(array->offsets);
+
+  array->types = types;
+  array->offsets = offsets;
+  array->lengths = lengths;
+  array->payloads = payloads;
+  array->capacity = capacity;
+
+  return 1;
+}
+
+/**
+ * Appends a token to a token array, doubling its capacity when full.
+ */
+int token_array_push(TokenArray *array, LexerToken token, uint64_t payload) {
+  if (array->count == array->capacity &&
+      !token_array_grow(array, array->capacity ? array->capacity * 2 : 256)) {
+    return 0;
+  }
+
+  size_t i = array->count++;
+  array->types[i] = (uint8_t)token.type;
+  array->offsets[i] = token.offset;
+  array->lengths[i] = token.length;
+  array->payloads[i] = payload;
+
+  return 1;
+}
+
+/*
+ * Helper function returning the payload stored for a token the lexer just
+ * returned.
+ */
+static uint64_t lexed_payload(const Lexer *lexer, LexerToken token) {
+  uint64_t bits = token.payload;
+  if (token.type == TOKEN_NUMBER)
+    memcpy(&bits, &lexer->number, sizeof(bits));
+  return bits;
+}
+
+/*
+ * Helper function returning why the tokens of a lexer ended early, if they
+ * did.
+ */
+static TokenArrayError lexed_error(const Lexer *lexer) {
+  switch (lexer_error(lexer)) {
+  case TOKENIZER_OK:
+    return TOKEN_ARRAY_OK;
+  case TOKENIZER_ERROR_TOKEN_TOO_LONG:
+    return TOKEN_ARRAY_ERROR_TOKEN_TOO_LONG;
+  default:
+    return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+  }
+}
+
+/**
+ * Lexes a whole source, on the calling thread, into a token array.
+ */
+TokenArrayError lex_token_array(const Source *source, AtomTable *atoms,
+                                TokenArray *array) {
+  if (!source || !array) {
+    return TOKEN_ARRAY_ERROR_NULL_PTR;
+  }
+
+  Lexer lexer;
+  LexerInitError init_error = init_lexer_source(&lexer, source);
+  if (init_error == LEXER_INIT_ERROR_MEMORY_ALLOCATION) {
+    return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+  }
+  if (init_error != LEXER_INIT_OK) {
+    return TOKEN_ARRAY_ERROR_SOURCE;
+  }
+
+  lexer.atoms = atoms;
+
+  while (1) {
+    LexerToken token = next_lexical_token(&lexer);
+
+    if (!token_array_push(array, token, lexed_payload(&lexer, token))) {
+      free_lexer(&lexer);
+      return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+    }
+
+    if (token.type == TOKEN_EOF)
+      break;
+  }
+
+  TokenArrayError error = lexed_error(&lexer);
+  free_lexer(&lexer);
+
+  return error;
+}
+
+/*
+ * Helper function initializing a lexer over the contiguous `source` from
+ * `start` to its end. Token offsets must be shifted by `start`.
+ */
+static int init_lexer_from(Lexer *lexer, const Source *source, size_t start,
+                           AtomTable *atoms) {
+  Source rest;
+  init_source_buffer(&rest, source->data + start, source->length - start);
+
+  if (init_lexer_source(lexer, &rest) != LEXER_INIT_OK) {
+    return 0;
+  }
+
+  lexer->atoms = atoms;
+  return 1;
+}
+
+/*
+ * Helper function lexing the tokens that start inside a chunk.
+ */
+static void *lex_chunk_run(void *argument) {
+  LexChunk *chunk = (LexChunk *)argument;
+  Lexer lexer;
+
+  if (chunk->start >= chunk->end)
+    return NULL;
+
+  if (!init_lexer_from(&lexer, chunk->source, chunk->start,
+                       chunk->intern ? &chunk->atoms : NULL)) {
+    chunk->error = TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+    return NULL;
+  }
+
+  size_t start = chunk->start;
+
+  while (1) {
+    LexerToken token = next_lexical_token(&lexer);
+    token.offset += start;
+
+    /* A token too long to lex belongs to the chunk it starts in. */
+    if (token.offset >= chunk->end)
+      break;
+    if (token.type == TOKEN_EOF) {
+      chunk->error = lexed_error(&lexer);
+      break;
+    }
+
+    if (!token_array_push(&chunk->tokens, token,
+                          lexed_payload(&lexer, token))) {
+      chunk->error = TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+      break;
+    }
+  }
+
+  free_lexer(&lexer);
+
+  return NULL;
+}
+
+/*
+ * Helper function choosing where the chunk following `nominal` starts: on
+ * the first delimiter in a small window, where no token can be split, or at
+ * `nominal` itself if there is none.
+ */
+static size_t find_split(const Source *source, size_t nominal) {
+  size_t limit = nominal + PARALLEL_LEX_SPLIT_WINDOW;
+  if (limit > source->length)
+    limit = source->length;
+
+  for (size_t i = nominal; i < limit; i++) {
+    if (char_classes[(unsigned char)source->data[i]] & CHAR_CLASS_DELIMITER) {
+      return i;
+    }
+  }
+
+  return nominal;
+}
+
+/*
+ * Helper function appending token `index` of a chunk to the stitched array,
+ * renaming its atom from the chunk's table to the caller's.
+ */
+static int stitch_token(TokenArray *array, const Source *source,
+                        AtomTable *atoms, Atom *renames,
+                        const TokenArray *tokens, size_t index) {
+  LexerToken token = token_array_at(tokens, index);
+  uint64_t payload = tokens->payloads[index];
+
+  if (token.type == TOKEN_IDENTIFIER && atoms) {
+    Atom *rename = &renames[token.payload];
+    if (*rename == ATOM_INVALID) {
+      *rename = atom_intern(atoms, source->data + token.offset,
+                            token.length);
+    }
+    token.payload = *rename;
+    payload = *rename;
+  }
+
+  return token_array_push(array, token, payload);
+}
+
+/*
+ * Helper function skipping the tokens of a chunk that start before
+ * `position`, where the stitched tokens end.
+ *
+ * @return true if the chunk lexer passed through `position` too, so that its
+ * remaining tokens are exactly those of a sequential pass; false if one of
+ * its tokens straddles `position` and the seam must be lexed again.
+ */
+static bool skip_to_seam(const LexChunk *chunk, size_t position,
+                         size_t *index) {
+  const TokenArray *tokens = &chunk->tokens;
+  size_t i = *index;
+
+  while (i < tokens->count && tokens->offsets[i] < position) {
+    i++;
+  }
+
+  *index = i;
+
+  if (i == 0)
+    return true;
+
+  return tokens->offsets[i - 1] + tokens->lengths[i - 1] <=
+         position;
+}
+
+/*
+ * Helper function lexing sequentially from `*position` until the chunk lexer
+ * agrees with it on a token boundary, or the end of the chunk is reached.
+ */
+static int relex_seam(TokenArray *array, const Source *source,
+                      AtomTable *atoms, const LexChunk *chunk,
+                      size_t *position, size_t *index) {
+  Lexer lexer;
+  size_t start = *position;
+
+  if (!init_lexer_from(&lexer, source, start, atoms)) {
+    return 0;
+  }
+
+  while (1) {
+    LexerToken token = next_lexical_token(&lexer);
+    token.offset += start;
+
+    if (token.type == TOKEN_EOF || token.offset >= chunk->end) {
+      *index = chunk->tokens.count;
+      break;
+    }
+
+    if (!token_array_push(array, token, lexed_payload(&lexer, token))) {
+      free_lexer(&lexer);
+      return 0;
+    }
+
+    *position = token.offset + token.length;
+    if (skip_to_seam(chunk, *position, index))
+      break;
+  }
+
+  free_lexer(&lexer);
+
+  return 1;
+}
+
+/*
+ * Helper function stitching the chunks together in source order.
+ */
+static TokenArrayError stitch_chunks(TokenArray *array, const Source *source,
+                                     AtomTable *atoms, LexChunk *chunks,
+                                     unsigned chunk_count) {
+  size_t position = 0;
+
+  for (unsigned c = 0; c < chunk_count; c++) {
+    LexChunk *chunk = &chunks[c];
+    Atom *renames = NULL;
+
+    if (atoms && chunk->atoms.count > 0) {
+      renames = (Atom *)malloc(chunk->atoms.count * sizeof(Atom));
+      if (!renames) {
+        return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+      }
+      for (uint32_t i = 0; i < chunk->atoms.count; i++) {
+        renames[i] = ATOM_INVALID;
+      }
+    }
+
+    size_t index = 0;
+    if (!skip_to_seam(chunk, position, &index) &&
+        !relex_seam(array, source, atoms, chunk, &position, &index)) {
+      free(renames);
+      return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (; index < chunk->tokens.count; index++) {
+      if (!stitch_token(array, source, atoms, renames, &chunk->tokens,
+                        index)) {
+        free(renames);
+        return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+      }
+
+      position = chunk->tokens.offsets[index] + chunk->tokens.lengths[index];
+    }
+
+    free(renames);
+  }
+
+  LexerToken eof = {.type = TOKEN_EOF,
+                    .offset = source->length,
+                    .length = 0,
+                    .payload = 0};
+
+  return token_array_push(array, eof, 0) ? TOKEN_ARRAY_OK
+                                      : TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+}
+
+/**
+ * Lexes a whole contiguous source on several threads into a token array.
+ *
+ * The calling thread lexes the first chunk. A chunk whose thread could not be
+ * started is lexed by the calling thread afterwards.
+ */
+TokenArrayError lex_token_array_parallel(const Source *source,
+                                         AtomTable *atoms,
+                                         const ParallelLexOptions *options,
+                                         TokenArray *array) {
+  if (!source || !array) {
+    return TOKEN_ARRAY_ERROR_NULL_PTR;
+  }
+
+  if (source->kind == SOURCE_STREAM || !source->data || source->length == 0) {
+    return TOKEN_ARRAY_ERROR_SOURCE;
+  }
+
+  unsigned threads = options ? options->threads : 0;
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (unsigned)cpus : 1;
+  }
+
+  size_t chunk_size = options && options->chunk_size
+                          ? options->chunk_size
+                          : PARALLEL_LEX_CHUNK_SIZE;
+  size_t most_chunks = source->length / chunk_size;
+  if (threads > most_chunks)
+    threads = most_chunks > 0 ? (unsigned)most_chunks : 1;
+
+  if (threads == 1) {
+    return lex_token_array(source, atoms, array);
+  }
+
+  LexChunk *chunks = (LexChunk *)calloc(threads, sizeof(LexChunk));
+  if (!chunks) {
+    return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+  }
+
+  size_t start = 0;
+  for (unsigned i = 0; i < threads; i++) {
+    size_t end = i + 1 < threads
+                     ? find_split(source, source->length * (i + 1) / threads)
+                     : source->length;
+    if (end < start)
+      end = start;
+
+    chunks[i].source = source;
+    chunks[i].start = start;
+    chunks[i].end = end;
+    chunks[i].intern = atoms != NULL;
+    init_token_array(&chunks[i].tokens);
+    init_atom_table(&chunks[i].atoms);
+
+    start = end;
+  }
+
+  for (unsigned i = 1; i < threads; i++) {
+    chunks[i].started = pthread_create(&chunks[i].thread, NULL, lex_chunk_run,
+                                       &chunks[i]) == 0;
+  }
+
+  lex_chunk_run(&chunks[0]);
+
+  for (unsigned i = 1; i < threads; i++) {
+    if (chunks[i].started) {
+      pthread_join(chunks[i].thread, NULL);
+    } else {
+      lex_chunk_run(&chunks[i]);
+    }
+  }
+
+  TokenArrayError error = TOKEN_ARRAY_OK;
+  for (unsigned i = 0; i < threads && error == TOKEN_ARRAY_OK; i++) {
+    error = chunks[i].error;
+  }
+
+  if (error == TOKEN_ARRAY_OK) {
+    error = stitch_chunks(array, source, atoms, chunks, threads);
+  }
+
+  for (unsigned i = 0; i < threads; i++) {
+    free_token_array(&chunks[i].tokens);
+    free_atom_table(&chunks[i].atoms);
+  }
+  free(chunks);
+
+  return error;
+}
+
+/*
+ * Helper function returning the index of the first token ending at or after
+ * `position`. Offsets are sorted, and so are the ends of the tokens.
+ */
+static size_t first_token_ending_at(const TokenArray *array, size_t position) {
+  size_t low = 0;
+  size_t high = array->count;
+
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    size_t end =
+        array->offsets[middle] + array->lengths[middle];
+    if (end < position) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+/*
+ * Helper function replacing tokens `[first, old_end)` of `array` by the
+ * tokens of `tokens`, moving the offsets of the following ones by `delta`.
+ */
+static int splice_tokens(TokenArray *array, size_t first, size_t old_end,
+                         const TokenArray *tokens, ptrdiff_t delta) {
+  size_t tail = array->count - old_end;
+  size_t count = first + tokens->count + tail;
+
+  if (count > array->capacity) {
+    size_t capacity = array->capacity ? array->capacity : 256;
+    while (capacity < count)
+      capacity *= 2;
+    if (!token_array_grow(array, capacity))
+      return 0;
+  }
+
+  size_t new_end = first + tokens->count;
+  memmove(array->types + new_end, array->types + old_end, tail);
+  memmove(array->offsets + new_end, array->offsets + old_end,
+          tail * sizeof(size_t));
+  memmove(array->lengths + new_end, array->lengths + old_end,
+          tail * sizeof(size_t));
+  memmove(array->payloads + new_end, array->payloads + old_end,
+          tail * sizeof(uint64_t));
+
+  if (tokens->count > 0) {
+    memcpy(array->types + first, tokens->types, tokens->count);
+    memcpy(array->offsets + first, tokens->offsets,
+           tokens->count * sizeof(size_t));
+    memcpy(array->lengths + first, tokens->lengths,
+           tokens->count * sizeof(size_t));
+    memcpy(array->payloads + first, tokens->payloads,
+           tokens->count * sizeof(uint64_t));
+  }
+
+  for (size_t i = new_end; i < count; i++) {
+    array->offsets[i] += (size_t)delta;
+  }
+
+  array->count = count;
+
+  return 1;
+}
+
+/**
+ * Updates the tokens of a source after it was edited.
+ */
+TokenArrayError relex_token_array(const Source *source, AtomTable *atoms,
+                                  const SourceEdit *edit, TokenArray *array,
+                                  TokenArrayChange *change) {
+  if (!source || !edit || !array || !change) {
+    return TOKEN_ARRAY_ERROR_NULL_PTR;
+  }
+
+  if (source->kind == SOURCE_STREAM || array->count == 0 ||
+      array->types[array->count - 1] != TOKEN_EOF) {
+    return TOKEN_ARRAY_ERROR_SOURCE;
+  }
+
+  size_t old_length = array->offsets[array->count - 1];
+  if (edit->offset > old_length || edit->removed > old_length - edit->offset ||
+      source->length != old_length - edit->removed + edit->inserted) {
+    return TOKEN_ARRAY_ERROR_SOURCE;
+  }
+
+  /* A token ending right where the edit starts may grow into it, so lexing
+   * restarts after the last token ending strictly before the edit. A number,
+   * valid or not, may also grow into an edit that starts a little further,
+   * since the tokenizer reads past its end for an exponent. */
+  size_t first = first_token_ending_at(array, edit->offset);
+  if (first > 0 &&
+      (array->types[first - 1] == TOKEN_NUMBER ||
+       array->types[first - 1] == TOKEN_UNKNOWN) &&
+      array->offsets[first - 1] + array->lengths[first - 1] +
+              TOKENIZER_LOOKAHEAD >
+          edit->offset) {
+    first--;
+  }
+  size_t start = first > 0 ? array->offsets[first - 1] +
+                                 array->lengths[first - 1]
+                           : 0;
+  size_t edit_end = edit->offset + edit->inserted;
+  ptrdiff_t delta = (ptrdiff_t)edit->inserted - (ptrdiff_t)edit->removed;
+
+  TokenArray tokens;
+  init_token_array(&tokens);
+
+  size_t old_end = array->count;
+  Lexer lexer;
+  bool lexing = start < source->length &&
+                init_lexer_from(&lexer, source, start, atoms);
+
+  if (start < source->length && !lexing) {
+    return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+  }
+
+  while (lexing) {
+    LexerToken token = next_lexical_token(&lexer);
+    token.offset += start;
+
+    if (token.type == TOKEN_EOF)
+      break;
+
+    if (!token_array_push(&tokens, token, lexed_payload(&lexer, token))) {
+      free_lexer(&lexer);
+      free_token_array(&tokens);
+      return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+    }
+
+    /* Past the edit, the old tokens can be kept from the first place where
+     * an old token ended at the same position of the text. */
+    size_t end = token.offset + token.length;
+    if (end >= edit_end) {
+      size_t old_position = (size_t)((ptrdiff_t)end - delta);
+      size_t next = first_token_ending_at(array, old_position);
+      if (array->offsets[next] + array->lengths[next] ==
+              old_position &&
+          array->types[next] != TOKEN_EOF) {
+        old_end = next + 1;
+        break;
+      }
+    }
+  }
+
+  if (lexing) {
+    TokenArrayError error = lexed_error(&lexer);
+    free_lexer(&lexer);
+    if (error != TOKEN_ARRAY_OK) {
+      free_token_array(&tokens);
+      return error;
+    }
+  }
+
+  if (old_end == array->count) {
+    LexerToken eof = {.type = TOKEN_EOF,
+                      .offset = source->length,
+                      .length = 0,
+                      .payload = 0};
+    if (!token_array_push(&tokens, eof, 0)) {
+      free_token_array(&tokens);
+      return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+    }
+  }
+
+  if (!splice_tokens(array, first, old_end, &tokens, delta)) {
+    free_token_array(&tokens);
+    return TOKEN_ARRAY_ERROR_MEMORY_ALLOCATION;
+  }
+
+  change->first = first;
+  change->old_end = old_end;
+  change->new_end = first + tokens.count;
+
+  free_token_array(&tokens);
+
+  return TOKEN_ARRAY_OK;
+}
@@ -1,28 +1,370 @@
-#include <ctype.h>
 #include <stdbool.h>
-#include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "../include/tokenizer.h"
 
+#define D CHAR_CLASS_DELIMITER
+#define I CHAR_CLASS_IDENTIFIER_START
+#define G CHAR_CLASS_DIGIT
+
+/*
+ * Character classes of every byte value. Bytes outside of ASCII have no class,
+ * and the table does not depend on the current locale.
+ */
+const unsigned char char_classes[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, D, D, 0, 0, D, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    D, 0, 0, 0, I, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    G, G, G, G, G, G, G, G, G, G, 0, D, 0, 0, 0, 0,
+    0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, 0, 0, 0, 0, I,
+    0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+#undef D
+#undef I
+#undef G
+
 /*
  * Helper function to check if a character is a delimiter
  */
 static inline bool is_delimiter(char c) {
-  return c == ' ' || c == '\n' || c == '\t' || c == ';';
+  return char_classes[(unsigned char)c] & CHAR_CLASS_DELIMITER;
+}
+
+/*
+ * Helper function to check if a character can start an identifier
+ */
+static inline bool is_identifier_start(char c) {
+  return char_classes[(unsigned char)c] & CHAR_CLASS_IDENTIFIER_START;
+}
+
+/*
+ * Helper function to check if a character can continue an identifier
+ */
+static inline bool is_identifier_part(char c) {
+  return char_classes[(unsigned char)c] &
+         (CHAR_CLASS_IDENTIFIER_START | CHAR_CLASS_DIGIT);
+}
+
+/*
+ * Helper function to check if a character is a decimal digit
+ */
+static inline bool is_digit(char c) {
+  return char_classes[(unsigned char)c] & CHAR_CLASS_DIGIT;
+}
+
+#if defined(__AVX2__)
+
+/*
+ * Vector helpers working on 32 bytes at a time. Each returns a bit mask with
+ * one bit per byte that belongs to the class.
+ */
+#define SIMD_WIDTH 32
+
+typedef __m256i SimdVector;
+
+static inline uint32_t simd_in_range(__m256i bytes, char low, char high) {
+  __m256i shifted =
+      _mm256_add_epi8(bytes, _mm256_set1_epi8((char)(0x80 - low)));
+  __m256i limit = _mm256_set1_epi8((char)(high - low - 0x7f));
+  return (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(limit, shifted));
+}
+
+static inline uint32_t simd_equal(__m256i bytes, char c) {
+  return (uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c)));
+}
+
+static inline SimdVector simd_load(const char *p) {
+  return _mm256_loadu_si256((const __m256i *)p);
 }
 
+static inline __m256i simd_lower(__m256i bytes) {
+  return _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+}
+
+#elif defined(__SSE2__)
+
 /*
- * Helper function to check if a character is the end of file
+ * Vector helpers working on 16 bytes at a time. Each returns a bit mask with
+ * one bit per byte that belongs to the class.
  */
-static inline bool is_eof(char c) { return c == '\0'; }
+#define SIMD_WIDTH 16
+
+typedef __m128i SimdVector;
+
+static inline uint32_t simd_in_range(__m128i bytes, char low, char high) {
+  __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8((char)(0x80 - low)));
+  __m128i limit = _mm_set1_epi8((char)(high - low - 0x7f));
+  return (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(shifted, limit));
+}
+
+static inline uint32_t simd_equal(__m128i bytes, char c) {
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(c)));
+}
+
+static inline SimdVector simd_load(const char *p) {
+  return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline __m128i simd_lower(__m128i bytes) {
+  return _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+}
+
+#endif
+
+#ifdef SIMD_WIDTH
+
+#define SIMD_FULL_MASK ((uint32_t)((1ull << SIMD_WIDTH) - 1))
 
 /*
- * Helper function to retrieve the current char from the tokenizer
+ * Returns the mask of delimiter bytes in a vector.
  */
-static inline char current_tokenizer_char(Tokenizer *tokenizer) {
-  return tokenizer->source[tokenizer->position];
+static inline uint32_t simd_delimiters(const char *p) {
+  SimdVector bytes = simd_load(p);
+  return simd_equal(bytes, ' ') | simd_equal(bytes, '\n') |
+         simd_equal(bytes, '\t') | simd_equal(bytes, '\r') |
+         simd_equal(bytes, ';');
+}
+
+/*
+ * Returns the mask of identifier bytes ([A-Za-z0-9_$]) in a vector.
+ */
+static inline uint32_t simd_identifier_parts(const char *p) {
+  SimdVector bytes = simd_load(p);
+  return simd_in_range(simd_lower(bytes), 'a', 'z') |
+         simd_in_range(bytes, '0', '9') | simd_equal(bytes, '_') |
+         simd_equal(bytes, '$');
+}
+
+/*
+ * Returns the mask of decimal digits in a vector.
+ */
+static inline uint32_t simd_digits(const char *p) {
+  return simd_in_range(simd_load(p), '0', '9');
+}
+
+#endif
+
+/*
+ * Most runs are short, so the first few bytes of every run are checked one at
+ * a time before paying for a vector load.
+ */
+#define SCALAR_PREFIX 8
+
+/*
+ * Helper function returning the position after a run of delimiters. Full
+ * vectors are scanned at once when SIMD is available and the remaining bytes
+ * are handled by the character class table.
+ */
+static inline size_t skip_delimiters(const char *source, size_t position,
+                                     size_t length) {
+  size_t prefix_end =
+      length - position > SCALAR_PREFIX ? position + SCALAR_PREFIX : length;
+
+  while (position < prefix_end && is_delimiter(source[position])) {
+    position++;
+  }
+
+  if (position < prefix_end) {
+    return position;
+  }
+
+#ifdef SIMD_WIDTH
+  while (position + SIMD_WIDTH <= length) {
+    uint32_t mask = simd_delimiters(source + position);
+    if (mask != SIMD_FULL_MASK) {
+      return position + (size_t)__builtin_ctz(~mask);
+    }
+    position += SIMD_WIDTH;
+  }
+#endif
+
+  while (position < length && is_delimiter(source[position])) {
+    position++;
+  }
+
+  return position;
+}
+
+/*
+ * Helper function returning the position after the rest of an identifier.
+ */
+static inline size_t scan_identifier(const char *source, size_t position,
+                                     size_t length) {
+  size_t prefix_end =
+      length - position > SCALAR_PREFIX ? position + SCALAR_PREFIX : length;
+
+  while (position < prefix_end && is_identifier_part(source[position])) {
+    position++;
+  }
+
+  if (position < prefix_end) {
+    return position;
+  }
+
+#ifdef SIMD_WIDTH
+  while (position + SIMD_WIDTH <= length) {
+    uint32_t mask = simd_identifier_parts(source + position);
+    if (mask != SIMD_FULL_MASK) {
+      return position + (size_t)__builtin_ctz(~mask);
+    }
+    position += SIMD_WIDTH;
+  }
+#endif
+
+  while (position < length && is_identifier_part(source[position])) {
+    position++;
+  }
+
+  return position;
+}
+
+/*
+ * Helper function returning the position after the rest of a run of digits.
+ */
+static inline size_t scan_digits(const char *source, size_t position,
+                                 size_t length) {
+  size_t prefix_end =
+      length - position > SCALAR_PREFIX ? position + SCALAR_PREFIX : length;
+
+  while (position < prefix_end && is_digit(source[position])) {
+    position++;
+  }
+
+  if (position < prefix_end) {
+    return position;
+  }
+
+#ifdef SIMD_WIDTH
+  while (position + SIMD_WIDTH <= length) {
+    uint32_t mask = simd_digits(source + position);
+    if (mask != SIMD_FULL_MASK) {
+      return position + (size_t)__builtin_ctz(~mask);
+    }
+    position += SIMD_WIDTH;
+  }
+#endif
+
+  while (position < length && is_digit(source[position])) {
+    position++;
+  }
+
+  return position;
+}
+
+/*
+ * Helper function returning the position after the rest of a run of digits
+ * in which underscores may separate digits.
+ */
+static inline size_t scan_separated_digits(const char *source, size_t position,
+                                           size_t length) {
+  while (1) {
+    position = scan_digits(source, position, length);
+    if (position == length || source[position] != '_')
+      return position;
+    position++;
+  }
+}
+
+/*
+ * Helper function returning the position after the rest of a numeric literal
+ * started by `first`: a `0b`, `0o` or `0x` prefixed integer, or a decimal with
+ * an optional fraction and exponent. Letters and digits right after it are
+ * part of the token, so that `1e` or `12px` are a single malformed literal for
+ * the lexer to reject. The length is returned when the literal may go on past
+ * the end of the window.
+ */
+static inline size_t scan_number(const char *source, size_t position,
+                                 size_t length, char first) {
+  if (first == '0' && position < length) {
+    char prefix = (char)(source[position] | 0x20);
+    if (prefix == 'b' || prefix == 'o' || prefix == 'x') {
+      return scan_identifier(source, position + 1, length);
+    }
+  }
+
+  position = scan_separated_digits(source, position, length);
+
+  if (first != '.' && position < length && source[position] == '.') {
+    position = scan_separated_digits(source, position + 1, length);
+  }
+
+  if (position < length && (source[position] | 0x20) == 'e') {
+    size_t exponent = position + 1;
+    if (exponent < length &&
+        (source[exponent] == '+' || source[exponent] == '-')) {
+      exponent++;
+    }
+
+    if (exponent == length) {
+      return length;
+    }
+
+    if (is_digit(source[exponent])) {
+      position = scan_separated_digits(source, exponent, length);
+    }
+  }
+
+  return scan_identifier(source, position, length);
+}
+
+/*
+ * Helper function moving the unread part of a streaming tokenizer's window,
+ * starting at `keep`, to the front of its buffer and appending the next chunk
+ * of input. Once the stream is exhausted the tokenizer stops reading; if the
+ * buffer cannot grow, it stops with an error instead.
+ */
+static void tokenizer_refill(Tokenizer *tokenizer, size_t keep) {
+  size_t remaining = tokenizer->length - keep;
+
+  memmove(tokenizer->buffer, tokenizer->buffer + keep, remaining);
+  tokenizer->base += keep;
+  tokenizer->position -= keep;
+  tokenizer->length = remaining;
+
+  if (tokenizer->capacity - remaining < tokenizer->chunk_size) {
+    size_t capacity = remaining + tokenizer->chunk_size;
+    char *buffer = capacity < remaining
+                       ? NULL
+                       : (char *)realloc(tokenizer->buffer, capacity);
+    if (!buffer) {
+      tokenizer->error = TOKENIZER_ERROR_MEMORY_ALLOCATION;
+      tokenizer->read = NULL;
+      return;
+    }
+
+    tokenizer->buffer = buffer;
+    tokenizer->capacity = capacity;
+  }
+
+  size_t read = tokenizer->read(tokenizer->context,
+                                tokenizer->buffer + remaining,
+                                tokenizer->chunk_size);
+  if (read == 0) {
+    tokenizer->read = NULL;
+  }
+
+  tokenizer->source = tokenizer->buffer;
+  tokenizer->length += read;
 }
 
 /**
@@ -33,57 +375,159 @@ static inline char current_tokenizer_char(Tokenizer *tokenizer) {
  * @return A TokenizerInitError code indicating success or failure.
  */
 TokenizerInitError init_tokenizer(Tokenizer *tokenizer, const char *source) {
+  if (!source) {
+    return tokenizer ? TOKENIZER_INIT_ERROR_INVALID_SOURCE
+                     : TOKENIZER_INIT_ERROR_NULL_PTR;
+  }
+
+  Source text;
+  init_source_string(&text, source);
+
+  return init_tokenizer_source(tokenizer, &text);
+}
+
+/**
+ * Initializes the tokenizer over a contiguous or streamed source.
+ *
+ * @param tokenizer A pointer to the Tokenizer structure to initialize.
+ * @param source The source to tokenize. Must not be NULL.
+ * @return A TokenizerInitError code indicating success or failure.
+ */
+TokenizerInitError init_tokenizer_source(Tokenizer *tokenizer,
+                                         const Source *source) {
   if (!tokenizer) {
     return TOKENIZER_INIT_ERROR_NULL_PTR;
   }
 
-  if (!source || is_eof(source[0])) {
+  if (!source) {
     return TOKENIZER_INIT_ERROR_INVALID_SOURCE;
   }
 
-  tokenizer->source = source;
-  tokenizer->position = 0;
+  memset(tokenizer, 0, sizeof(Tokenizer));
+
+  if (source->kind != SOURCE_STREAM) {
+    if (!source->data || source->length == 0) {
+      return TOKENIZER_INIT_ERROR_INVALID_SOURCE;
+    }
+
+    tokenizer->source = source->data;
+    tokenizer->length = source->length;
+
+    return TOKENIZER_INIT_OK;
+  }
+
+  if (!source->read || source->chunk_size == 0 ||
+      source->chunk_size > SIZE_MAX / 2) {
+    return TOKENIZER_INIT_ERROR_INVALID_SOURCE;
+  }
+
+  tokenizer->buffer = (char *)malloc(source->chunk_size);
+  if (!tokenizer->buffer) {
+    return TOKENIZER_INIT_ERROR_MEMORY_ALLOCATION;
+  }
+
+  tokenizer->source = tokenizer->buffer;
+  tokenizer->capacity = source->chunk_size;
+  tokenizer->chunk_size = source->chunk_size;
+  tokenizer->read = source->read;
+  tokenizer->context = source->context;
+
+  tokenizer_refill(tokenizer, 0);
+
+  if (tokenizer->error != TOKENIZER_OK) {
+    free_tokenizer(tokenizer);
+    return TOKENIZER_INIT_ERROR_MEMORY_ALLOCATION;
+  }
+
+  if (tokenizer->length == 0) {
+    free_tokenizer(tokenizer);
+    return TOKENIZER_INIT_ERROR_INVALID_SOURCE;
+  }
 
   return TOKENIZER_INIT_OK;
 }
 
 /**
- * Retrieves the next token from the source string.
+ * Frees the window buffer of a streaming tokenizer.
+ *
+ * @param tokenizer A pointer to the Tokenizer to free.
  */
-const char *next_token(Tokenizer *tokenizer) {
-  if (!tokenizer || !tokenizer->source) {
-    return NULL;
-  }
+void free_tokenizer(Tokenizer *tokenizer) {
+  if (!tokenizer)
+    return;
 
-  while (is_delimiter(current_tokenizer_char(tokenizer))) {
-    tokenizer->position++;
-  }
+  free(tokenizer->buffer);
+  tokenizer->buffer = NULL;
+  tokenizer->source = NULL;
+  tokenizer->length = 0;
+  tokenizer->position = 0;
+}
 
-  if (is_eof(current_tokenizer_char(tokenizer))) {
-    return NULL;
+/**
+ * Retrieves the next token from the source.
+ *
+ * When a streaming tokenizer reaches the end of its window in the middle of a
+ * token (or of the delimiters before it), the next chunk is appended and the
+ * token is scanned again from where the call started. Tokens spanning any
+ * number of chunks are therefore returned whole.
+ */
+TokenSpan next_token(Tokenizer *tokenizer) {
+  TokenSpan span = {.offset = 0, .length = 0};
+
+  if (!tokenizer || !tokenizer->source ||
+      tokenizer->error != TOKENIZER_OK) {
+    return span;
   }
 
-  int start_position = tokenizer->position;
+  size_t start = tokenizer->position;
+  size_t position;
+
+  while (1) {
+    const char *source = tokenizer->source;
+    size_t length = tokenizer->length;
 
-  if (isalpha(current_tokenizer_char(tokenizer))) {
-    while (!is_eof(current_tokenizer_char(tokenizer)) &&
-           !is_delimiter(current_tokenizer_char(tokenizer)) &&
-           isalnum(current_tokenizer_char(tokenizer))) {
-      tokenizer->position++;
+    position = skip_delimiters(source, start, length);
+    span.offset = position;
+
+    if (position < length) {
+      char c = source[position++];
+
+      if (is_identifier_start(c)) {
+        position = scan_identifier(source, position, length);
+      } else if (is_digit(c) || (c == '.' && position < length &&
+                                 is_digit(source[position]))) {
+        position = scan_number(source, position, length, c);
+      }
     }
-  } else {
-    tokenizer->position++;
-  }
 
-  int length = tokenizer->position - start_position;
+    if (position < length || !tokenizer->read) {
+      break;
+    }
 
-  char *token = malloc(length + 1);
-  if (!token) {
-    return NULL;
+    tokenizer_refill(tokenizer, start);
+    if (tokenizer->error != TOKENIZER_OK) {
+      span.offset = tokenizer->base;
+      return span;
+    }
+    start = 0;
   }
 
-  strncpy(token, tokenizer->source + start_position, length);
-  token[length] = '\0';
+  if (position - span.offset > TOKENIZER_MAX_TOKEN_LENGTH) {
+    tokenizer->error = TOKENIZER_ERROR_TOKEN_TOO_LONG;
+    span.offset += tokenizer->base;
+    return span;
+  }
 
-  return token;
+  tokenizer->position = position;
+  span.length = position - span.offset;
+  span.offset += tokenizer->base;
+
+  return span;
+}
+
+/**
+ * Returns the text of a span taken from the tokenizer.
+ */
+const char *tokenizer_span_text(const Tokenizer *tokenizer, TokenSpan span) {
+  return tokenizer->source + (span.offset - tokenizer->base);
 }
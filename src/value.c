@@ -0,0 +1,174 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/value.h"
+
+/**
+ * Returns the type of a value.
+ *
+ * @param value The value to inspect.
+ * @return The `ValueType` of `value`.
+ */
+ValueType value_type(Value value) {
+  if (value_is_number(value))
+    return VALUE_NUMBER;
+  if (value_is_object(value))
+    return VALUE_OBJECT;
+  if (value_is_boolean(value))
+    return VALUE_BOOLEAN;
+  if (value_is_null(value))
+    return VALUE_NULL;
+  return VALUE_UNDEFINED;
+}
+
+/**
+ * Converts a value to a number.
+ *
+ * @param value The value to convert.
+ * @return The numeric value of `value`.
+ */
+double value_to_number(Value value) {
+  switch (value_type(value)) {
+  case VALUE_NUMBER:
+    return value_as_number(value);
+  case VALUE_BOOLEAN:
+    return value_as_boolean(value) ? 1.0 : 0.0;
+  case VALUE_NULL:
+    return 0.0;
+  case VALUE_UNDEFINED:
+  case VALUE_OBJECT:
+  default:
+    return NAN;
+  }
+}
+
+/**
+ * Adds two values. Numbers are added directly; other primitives are first
+ * converted to numbers.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The sum of the operands.
+ */
+Value value_add(Value left, Value right) {
+  if (value_is_number(left) && value_is_number(right)) {
+    return value_number(value_as_number(left) + value_as_number(right));
+  }
+
+  return value_number(value_to_number(left) + value_to_number(right));
+}
+
+/**
+ * Subtracts two values, converted to numbers.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The difference of the operands.
+ */
+Value value_subtract(Value left, Value right) {
+  return value_number(value_to_number(left) - value_to_number(right));
+}
+
+/**
+ * Multiplies two values, converted to numbers.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The product of the operands.
+ */
+Value value_multiply(Value left, Value right) {
+  return value_number(value_to_number(left) * value_to_number(right));
+}
+
+/**
+ * Divides two values, converted to numbers.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The quotient of the operands.
+ */
+Value value_divide(Value left, Value right) {
+  return value_number(value_to_number(left) / value_to_number(right));
+}
+
+/**
+ * Computes the remainder of two values, converted to numbers. JavaScript's
+ * `%` truncates like C's fmod.
+ *
+ * @param left The left operand.
+ * @param right The right operand.
+ * @return The remainder of the operands.
+ */
+Value value_modulo(Value left, Value right) {
+  return value_number(fmod(value_to_number(left), value_to_number(right)));
+}
+
+/**
+ * Converts a value to a boolean.
+ *
+ * @param value The value to convert.
+ * @return The truthiness of `value`.
+ */
+bool value_to_boolean(Value value) {
+  switch (value_type(value)) {
+  case VALUE_NUMBER: {
+    double number = value_as_number(value);
+    return number != 0.0 && !isnan(number);
+  }
+  case VALUE_BOOLEAN:
+    return value_as_boolean(value);
+  case VALUE_OBJECT:
+    return true;
+  case VALUE_NULL:
+  case VALUE_UNDEFINED:
+  default:
+    return false;
+  }
+}
+
+/**
+ * Prints a value.
+ *
+ * @param value The value to print.
+ */
+void value_print(Value value) {
+  switch (value_type(value)) {
+  case VALUE_UNDEFINED:
+    printf("undefined");
+    break;
+
+  case VALUE_NULL:
+    printf("null");
+    break;
+
+  case VALUE_BOOLEAN:
+    printf("%s", value_as_boolean(value) ? "true" : "false");
+    break;
+
+  case VALUE_OBJECT:
+    printf("[object Object]");
+    break;
+
+  case VALUE_NUMBER: {
+    double number = value_as_number(value);
+    if (isnan(number)) {
+      printf("NaN");
+    } else if (isinf(number)) {
+      printf(number > 0 ? "Infinity" : "-Infinity");
+    } else if (number == floor(number) && fabs(number) < 1e21) {
+      printf("%.0f", number == 0.0 ? 0.0 : number);
+    } else {
+      /* The shortest representation that reads back as the same double. */
+      char text[32];
+      for (int precision = 1; precision <= 17; precision++) {
+        snprintf(text, sizeof(text), "%.*g", precision, number);
+        if (strtod(text, NULL) == number)
+          break;
+      }
+      printf("%s", text);
+    }
+    break;
+  }
+  }
+}
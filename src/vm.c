@@ -0,0 +1,385 @@
+#include <stdlib.h>
+
+#include "../include/vm.h"
+
+/*
+ * Computed gotos are a GNU extension supported by GCC and Clang. Elsewhere the
+ * dispatch loop falls back to a switch.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO 1
+#else
+#define VM_COMPUTED_GOTO 0
+#endif
+
+/**
+ * Initializes a VM without registers.
+ *
+ * @param vm A pointer to the VM to initialize.
+ */
+void init_vm(VM *vm) {
+  if (!vm)
+    return;
+
+  vm->registers = NULL;
+  vm->register_count = 0;
+  init_heap(&vm->heap);
+  vm->caches = NULL;
+  vm->cache_count = 0;
+  vm->chunk_serial = 0;
+  vm->ic_hits = 0;
+  vm->ic_misses = 0;
+}
+
+/**
+ * Releases the registers, objects, shapes and caches of a VM.
+ *
+ * @param vm A pointer to the VM to free.
+ */
+void free_vm(VM *vm) {
+  if (!vm)
+    return;
+
+  free(vm->registers);
+  free(vm->caches);
+  free_heap(&vm->heap);
+  init_vm(vm);
+}
+
+/*
+ * Helper function sizing the register file for a chunk and resetting every
+ * register to undefined. The objects of the previous run are released, and
+ * the inline caches are reset unless the chunk ran last. The registers are the
+ * roots of the garbage collector.
+ */
+static int vm_prepare(VM *vm, const Chunk *chunk) {
+  heap_free_objects(&vm->heap);
+
+  if (chunk->serial != vm->chunk_serial ||
+      chunk->cache_count != vm->cache_count) {
+    InlineCache *caches = NULL;
+    if (chunk->cache_count > 0) {
+      caches = (InlineCache *)calloc(chunk->cache_count, sizeof(InlineCache));
+      if (!caches)
+        return 0;
+    }
+
+    free(vm->caches);
+    vm->caches = caches;
+    vm->cache_count = chunk->cache_count;
+    vm->chunk_serial = chunk->serial;
+  }
+
+  if (chunk->register_count > vm->register_count) {
+    Value *registers = (Value *)realloc(
+        vm->registers, sizeof(Value) * (size_t)chunk->register_count);
+    if (!registers)
+      return 0;
+
+    vm->registers = registers;
+    vm->register_count = chunk->register_count;
+  }
+
+  for (uint32_t i = 0; i < vm->register_count; i++) {
+    vm->registers[i] = value_undefined();
+  }
+
+  /* Objects are reachable from the registers only. */
+  vm->heap.roots = vm->registers;
+  vm->heap.root_count = vm->register_count;
+
+  return 1;
+}
+
+/*
+ * Helper function returning the entry of an inline cache for a shape, or
+ * IC_WAYS if the cache has not seen the shape.
+ */
+static inline uint32_t ic_find(const InlineCache *cache, const Shape *shape) {
+  for (uint32_t i = 0; i < cache->count; i++) {
+    if (cache->shapes[i] == shape)
+      return i;
+  }
+
+  return IC_WAYS;
+}
+
+/*
+ * Helper function recording how a shape was handled by a property access, if
+ * the cache has room left.
+ */
+static void ic_learn(InlineCache *cache, Shape *shape, Shape *target,
+                     uint32_t slot) {
+  if (cache->count == IC_WAYS)
+    return;
+
+  cache->shapes[cache->count] = shape;
+  cache->targets[cache->count] = target;
+  cache->slots[cache->count] = slot;
+  cache->count++;
+}
+
+/*
+ * Helper function reading a property on a cache miss.
+ */
+static Value vm_get_miss(InlineCache *cache, const Object *object,
+                         uint32_t name) {
+  uint32_t slot = shape_find_slot(object->shape, name);
+  ic_learn(cache, object->shape, object->shape, slot);
+
+  return slot == SHAPE_NO_SLOT ? value_undefined() : object->slots[slot];
+}
+
+/*
+ * Helper function writing a property on a cache miss.
+ *
+ * @return 1 on success, 0 if memory ran out.
+ */
+static int vm_set_miss(Heap *heap, InlineCache *cache, Object *object,
+                       uint32_t name, Value value) {
+  Shape *shape = object->shape;
+  uint32_t slot;
+
+  if (!object_set(heap, object, name, value, &slot))
+    return 0;
+
+  ic_learn(cache, shape, object->shape, slot);
+
+  return 1;
+}
+
+/**
+ * Runs a chunk.
+ *
+ * Operands are decoded straight from the code words and registers are
+ * addressed through a local pointer, so each instruction is a few loads and
+ * stores followed by an indirect jump to the next handler.
+ *
+ * @param vm A pointer to the VM.
+ * @param chunk The chunk to run.
+ * @return VM_RUN_OK on success, an error code otherwise.
+ */
+VMRunResult vm_run(VM *vm, const Chunk *chunk) {
+  if (!vm || !chunk) {
+    return VM_RUN_ERROR_NULL_PTR;
+  }
+
+  if (!vm_prepare(vm, chunk)) {
+    return VM_RUN_ERROR_MEMORY_ALLOCATION;
+  }
+
+  const uint32_t *ip = chunk->code;
+  const Value *constants = chunk->constants;
+  Value *registers = vm->registers;
+  InlineCache *caches = vm->caches;
+
+#if VM_COMPUTED_GOTO
+  static void *const dispatch_table[OP_COUNT] = {
+      [OP_LOAD_CONSTANT] = &&op_load_constant,
+      [OP_LOAD_UNDEFINED] = &&op_load_undefined,
+      [OP_MOVE] = &&op_move,
+      [OP_ADD] = &&op_add,
+      [OP_SUBTRACT] = &&op_subtract,
+      [OP_MULTIPLY] = &&op_multiply,
+      [OP_DIVIDE] = &&op_divide,
+      [OP_MODULO] = &&op_modulo,
+      [OP_NEGATE] = &&op_negate,
+      [OP_TO_NUMBER] = &&op_to_number,
+      [OP_NOT] = &&op_not,
+      [OP_NEW_OBJECT] = &&op_new_object,
+      [OP_GET_PROPERTY] = &&op_get_property,
+      [OP_SET_PROPERTY] = &&op_set_property,
+      [OP_HALT] = &&op_halt,
+  };
+
+#define DISPATCH() goto *dispatch_table[*ip++]
+#define CASE(opcode, label) label:
+#else
+#define DISPATCH() continue
+#define CASE(opcode, label) case opcode:
+#endif
+
+#if VM_COMPUTED_GOTO
+  DISPATCH();
+#else
+  for (;;) {
+    switch (*ip++) {
+#endif
+
+  CASE(OP_LOAD_CONSTANT, op_load_constant) {
+    registers[ip[0]] = constants[ip[1]];
+    ip += 2;
+    DISPATCH();
+  }
+
+  CASE(OP_LOAD_UNDEFINED, op_load_undefined) {
+    registers[ip[0]] = value_undefined();
+    ip += 1;
+    DISPATCH();
+  }
+
+  CASE(OP_MOVE, op_move) {
+    registers[ip[0]] = registers[ip[1]];
+    ip += 2;
+    DISPATCH();
+  }
+
+  CASE(OP_ADD, op_add) {
+    Value left = registers[ip[1]];
+    Value right = registers[ip[2]];
+
+    if (value_is_number(left) && value_is_number(right)) {
+      registers[ip[0]] =
+          value_number(value_as_number(left) + value_as_number(right));
+    } else {
+      registers[ip[0]] = value_add(left, right);
+    }
+
+    ip += 3;
+    DISPATCH();
+  }
+
+  CASE(OP_SUBTRACT, op_subtract) {
+    Value left = registers[ip[1]];
+    Value right = registers[ip[2]];
+
+    if (value_is_number(left) && value_is_number(right)) {
+      registers[ip[0]] =
+          value_number(value_as_number(left) - value_as_number(right));
+    } else {
+      registers[ip[0]] = value_subtract(left, right);
+    }
+
+    ip += 3;
+    DISPATCH();
+  }
+
+  CASE(OP_MULTIPLY, op_multiply) {
+    Value left = registers[ip[1]];
+    Value right = registers[ip[2]];
+
+    if (value_is_number(left) && value_is_number(right)) {
+      registers[ip[0]] =
+          value_number(value_as_number(left) * value_as_number(right));
+    } else {
+      registers[ip[0]] = value_multiply(left, right);
+    }
+
+    ip += 3;
+    DISPATCH();
+  }
+
+  CASE(OP_DIVIDE, op_divide) {
+    registers[ip[0]] = value_divide(registers[ip[1]], registers[ip[2]]);
+    ip += 3;
+    DISPATCH();
+  }
+
+  CASE(OP_MODULO, op_modulo) {
+    registers[ip[0]] = value_modulo(registers[ip[1]], registers[ip[2]]);
+    ip += 3;
+    DISPATCH();
+  }
+
+  CASE(OP_NEGATE, op_negate) {
+    registers[ip[0]] = value_number(-value_to_number(registers[ip[1]]));
+    ip += 2;
+    DISPATCH();
+  }
+
+  CASE(OP_TO_NUMBER, op_to_number) {
+    registers[ip[0]] = value_number(value_to_number(registers[ip[1]]));
+    ip += 2;
+    DISPATCH();
+  }
+
+  CASE(OP_NOT, op_not) {
+    registers[ip[0]] = value_boolean(!value_to_boolean(registers[ip[1]]));
+    ip += 2;
+    DISPATCH();
+  }
+
+  CASE(OP_NEW_OBJECT, op_new_object) {
+    Object *object = heap_new_object(&vm->heap);
+    if (!object)
+      return VM_RUN_ERROR_MEMORY_ALLOCATION;
+
+    registers[ip[0]] = value_object(object);
+    ip += 1;
+    DISPATCH();
+  }
+
+  CASE(OP_GET_PROPERTY, op_get_property) {
+    Value target = registers[ip[1]];
+
+    if (value_is_object(target)) {
+      const Object *object = (const Object *)value_as_object(target);
+      InlineCache *cache = &caches[ip[3]];
+      uint32_t entry = ic_find(cache, object->shape);
+
+      if (entry < IC_WAYS) {
+        uint32_t slot = cache->slots[entry];
+        registers[ip[0]] =
+            slot == SHAPE_NO_SLOT ? value_undefined() : object->slots[slot];
+        vm->ic_hits++;
+      } else {
+        registers[ip[0]] = vm_get_miss(cache, object, ip[2]);
+        vm->ic_misses++;
+      }
+    } else if (value_is_undefined(target) || value_is_null(target)) {
+      return VM_RUN_ERROR_TYPE;
+    } else {
+      /* Primitives have no properties of their own. */
+      registers[ip[0]] = value_undefined();
+    }
+
+    ip += 4;
+    DISPATCH();
+  }
+
+  CASE(OP_SET_PROPERTY, op_set_property) {
+    Value target = registers[ip[0]];
+    Value value = registers[ip[2]];
+
+    if (value_is_object(target)) {
+      Object *object = (Object *)value_as_object(target);
+      InlineCache *cache = &caches[ip[3]];
+      uint32_t entry = ic_find(cache, object->shape);
+
+      if (entry < IC_WAYS) {
+        Shape *shape = cache->targets[entry];
+        if (shape != object->shape) {
+          if (!object_reserve(&vm->heap, object, shape->slot_count))
+            return VM_RUN_ERROR_MEMORY_ALLOCATION;
+          object->shape = shape;
+        }
+        if (!heap_write_barrier(&vm->heap, object, value))
+          return VM_RUN_ERROR_MEMORY_ALLOCATION;
+        object->slots[cache->slots[entry]] = value;
+        vm->ic_hits++;
+      } else {
+        if (!vm_set_miss(&vm->heap, cache, object, ip[1], value))
+          return VM_RUN_ERROR_MEMORY_ALLOCATION;
+        vm->ic_misses++;
+      }
+    } else if (value_is_undefined(target) || value_is_null(target)) {
+      return VM_RUN_ERROR_TYPE;
+    }
+
+    ip += 4;
+    DISPATCH();
+  }
+
+  CASE(OP_HALT, op_halt) { return VM_RUN_OK; }
+
+#if !VM_COMPUTED_GOTO
+    default:
+      /* Chunks produced by the compiler always end with OP_HALT. */
+      return VM_RUN_OK;
+    }
+  }
+#endif
+
+#undef DISPATCH
+#undef CASE
+}
@@ -0,0 +1,971 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../include/ast.h"
+#include "../include/compiler.h"
+#include "../third_party/Unity/src/unity.h"
+
+void test_ast_parses_declarations_into_arena(void) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, "let a = 1; let b = a;"));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_NOT_NULL(program);
+  TEST_ASSERT_EQUAL_INT(NODE_SOURCE_FILE, program->type);
+  TEST_ASSERT_EQUAL_size_t(2, program->children_count);
+
+  ASTNode *first = &program->children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_VARIABLE_DECLARATION, first->type);
+  TEST_ASSERT_EQUAL_STRING("a", first->data.declaration.name);
+  TEST_ASSERT_EQUAL_size_t(1, first->children_count);
+  TEST_ASSERT_EQUAL_INT(NODE_LITERAL, first->children[0].type);
+  TEST_ASSERT_TRUE(
+      value_as_number(first->children[0].data.literal.value) == 1.0);
+
+  ASTNode *second = &program->children[1];
+  TEST_ASSERT_EQUAL_STRING("b", second->data.declaration.name);
+  TEST_ASSERT_EQUAL_INT(NODE_IDENTIFIER, second->children[0].type);
+  TEST_ASSERT_EQUAL_STRING("a", second->children[0].data.identifier.value);
+
+  TEST_ASSERT_TRUE(ast.arena.allocated > 0);
+
+  free_ast(&ast);
+  TEST_ASSERT_NULL(ast.arena.current);
+  TEST_ASSERT_NULL(ast.lexer);
+}
+
+void test_ast_program_children_are_contiguous(void) {
+  const size_t statements = 10000;
+  char *source = (char *)malloc(statements * 16 + 1);
+  size_t length = 0;
+  for (size_t i = 0; i < statements; i++) {
+    length += (size_t)sprintf(source + length, "let v%zu = 1;", i);
+  }
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, source));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_size_t(statements, program->children_count);
+  TEST_ASSERT_EQUAL_STRING("v9999",
+                           program->children[9999].data.declaration.name);
+  TEST_ASSERT_EQUAL_size_t(0, ast.pending_count);
+
+  free_ast(&ast);
+  free(source);
+}
+
+static size_t read_one_byte(void *context, char *buffer, size_t capacity) {
+  const char **cursor = (const char **)context;
+  if (**cursor == '\0' || capacity == 0)
+    return 0;
+
+  buffer[0] = *(*cursor)++;
+  return 1;
+}
+
+void test_ast_parses_streamed_source(void) {
+  const char *text = "let alpha = 12345;\nlet beta = alpha;";
+  const char *cursor = text;
+
+  Source source;
+  init_source_stream(&source, read_one_byte, &cursor, 1);
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_source(&ast, &source));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_size_t(2, program->children_count);
+  TEST_ASSERT_EQUAL_STRING("alpha", program->children[0].data.declaration.name);
+  TEST_ASSERT_TRUE(
+      value_as_number(program->children[0].children[0].data.literal.value) ==
+      12345.0);
+  TEST_ASSERT_EQUAL_STRING("beta", program->children[1].data.declaration.name);
+  TEST_ASSERT_EQUAL_STRING(
+      "alpha", program->children[1].children[0].data.identifier.value);
+
+  free_ast(&ast);
+}
+
+void test_ast_reports_failed_stream_window(void) {
+  const char *text = "let alpha = 1;";
+  const char *cursor = text;
+
+  Source source;
+  init_source_stream(&source, read_one_byte, &cursor, 1);
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_source(&ast, &source));
+
+  /* A window too large to allocate stands in for a failed realloc. */
+  ast.lexer->tokenizer->chunk_size = SIZE_MAX;
+  TEST_ASSERT_NULL(ast_parse_program(&ast));
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_ERROR_MEMORY_ALLOCATION,
+                        lexer_error(ast.lexer));
+
+  free_ast(&ast);
+}
+
+#if SIZE_MAX > UINT32_MAX
+/*
+ * Maps a page ending with `prefix`, followed by a run of identifier
+ * characters longer than a token may be. The run maps the same small file
+ * over and over, so it costs little memory.
+ *
+ * Returns the length of the mapping, or 0 if it could not be made.
+ */
+static size_t map_long_run(const char *prefix, char **data) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t block = (size_t)16 << 20;
+  size_t blocks = TOKENIZER_MAX_TOKEN_LENGTH / block + 1;
+  size_t length = page + blocks * block;
+
+  char *base = mmap(NULL, length, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED)
+    return 0;
+
+  char path[] = "/tmp/cijs_test_XXXXXX";
+  int fd = mkstemp(path);
+  char *run = malloc(block);
+  bool ok = fd >= 0 && run;
+  if (fd >= 0)
+    unlink(path);
+
+  if (ok) {
+    memset(run, 'a', block);
+    ok = write(fd, run, block) == (ssize_t)block;
+  }
+  free(run);
+
+  ok = ok && mmap(base, page, PROT_READ | PROT_WRITE,
+                  MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) != MAP_FAILED;
+  for (size_t i = 0; ok && i < blocks; i++) {
+    ok = mmap(base + page + i * block, block, PROT_READ,
+              MAP_FIXED | MAP_SHARED, fd, 0) != MAP_FAILED;
+  }
+  if (fd >= 0)
+    close(fd);
+
+  if (!ok) {
+    munmap(base, length);
+    return 0;
+  }
+
+  memset(base, ' ', page);
+  memcpy(base + page - strlen(prefix), prefix, strlen(prefix));
+  *data = base;
+  return length;
+}
+#endif
+
+void test_ast_reports_token_too_long(void) {
+#if SIZE_MAX > UINT32_MAX
+  const char *prefix = "let a = 1;\nlet b = ";
+  char *data;
+  size_t length = map_long_run(prefix, &data);
+  if (length == 0)
+    return;
+
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  Source source;
+  init_source_buffer(&source, data, length);
+
+  /* The run is reported where it starts instead of being split. */
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_source(&ast, &source));
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_NOT_NULL(program);
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_ERROR_TOKEN_TOO_LONG, lexer_error(ast.lexer));
+  TEST_ASSERT_EQUAL_size_t(1, program->children_count);
+  TEST_ASSERT_EQUAL_size_t(1, ast.diagnostics.count);
+  TEST_ASSERT_EQUAL_INT(DIAGNOSTIC_TOKEN_TOO_LONG,
+                        ast.diagnostics.items[0].code);
+  TEST_ASSERT_EQUAL_size_t(page, ast.diagnostics.items[0].offset);
+  free_ast(&ast);
+
+  TEST_ASSERT_EQUAL_INT(AST_INIT_ERROR_TOKEN_TOO_LONG,
+                        init_ast_tokens(&ast, &source, NULL));
+
+  munmap(data, length);
+#endif
+}
+
+void test_ast_parses_addition_chains(void) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, "let a = b + 1 + c;"));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_size_t(1, program->children_count);
+
+  ASTNode *outer = &program->children[0].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_BINARY_EXPRESSION, outer->type);
+  TEST_ASSERT_EQUAL_INT(TOKEN_PLUS, outer->data.binary.operator);
+  TEST_ASSERT_EQUAL_size_t(2, outer->children_count);
+  TEST_ASSERT_EQUAL_STRING("c", outer->children[1].data.identifier.value);
+
+  ASTNode *inner = &outer->children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_BINARY_EXPRESSION, inner->type);
+  TEST_ASSERT_EQUAL_STRING("b", inner->children[0].data.identifier.value);
+  TEST_ASSERT_TRUE(value_as_number(inner->children[1].data.literal.value) ==
+                   1.0);
+  TEST_ASSERT_EQUAL_size_t(0, ast.pending_count);
+
+  free_ast(&ast);
+}
+
+void test_ast_parses_operators_by_precedence(void) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(
+      AST_INIT_OK,
+      init_ast(&ast, "let a = b - c * -d; x = y = (b + 1) * 2;\n"
+                     "let e = 1 + 2 * 3 - -(4 % 3) + !0;\n"
+                     "let f = (1 + a) / 2;"));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_size_t(4, program->children_count);
+
+  /* b - (c * (-d)) */
+  ASTNode *difference = &program->children[0].children[0];
+  TEST_ASSERT_EQUAL_INT(TOKEN_MINUS, difference->data.binary.operator);
+  ASTNode *product = &difference->children[1];
+  TEST_ASSERT_EQUAL_INT(TOKEN_STAR, product->data.binary.operator);
+  TEST_ASSERT_EQUAL_INT(NODE_UNARY_EXPRESSION, product->children[1].type);
+  TEST_ASSERT_EQUAL_INT(TOKEN_MINUS, product->children[1].data.unary.operator);
+
+  /* x = (y = ((b + 1) * 2)) */
+  ASTNode *statement = &program->children[1];
+  TEST_ASSERT_EQUAL_INT(NODE_EXPRESSION_STATEMENT, statement->type);
+  ASTNode *outer = &statement->children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_ASSIGNMENT_EXPRESSION, outer->type);
+  TEST_ASSERT_EQUAL_STRING("x", outer->children[0].data.identifier.value);
+  ASTNode *inner = &outer->children[1];
+  TEST_ASSERT_EQUAL_INT(NODE_ASSIGNMENT_EXPRESSION, inner->type);
+  TEST_ASSERT_EQUAL_INT(TOKEN_STAR, inner->children[1].data.binary.operator);
+  TEST_ASSERT_EQUAL_INT(TOKEN_PLUS,
+                        inner->children[1].children[0].data.binary.operator);
+
+  /* Literal math is folded, with JavaScript's conversions. */
+  ASTNode *folded = &program->children[2].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_LITERAL, folded->type);
+  TEST_ASSERT_TRUE(value_as_number(folded->data.literal.value) == 9.0);
+
+  ASTNode *quotient = &program->children[3].children[0];
+  TEST_ASSERT_EQUAL_INT(TOKEN_SLASH, quotient->data.binary.operator);
+  TEST_ASSERT_EQUAL_size_t(0, ast.pending_count);
+  TEST_ASSERT_EQUAL_size_t(0, ast.operator_count);
+
+  free_ast(&ast);
+
+  /* Unbalanced parentheses and assignments to non-identifiers are reported
+   * and leave their statement out; a stray closing parenthesis is reported
+   * on its own. */
+  const struct {
+    const char *text;
+    size_t children;
+    DiagnosticCode code;
+    size_t offset;
+  } broken[] = {
+      {"let a = (1 + 2; let b;", 1, DIAGNOSTIC_EXPECTED_RIGHT_PAREN, 14},
+      {"let a = 1 + 2); let b;", 2, DIAGNOSTIC_UNSUPPORTED_STATEMENT, 13},
+      {"let a = b + 1 = 2; let c;", 1, DIAGNOSTIC_INVALID_ASSIGNMENT, 14},
+      {"let a = -; let b;", 1, DIAGNOSTIC_EXPECTED_EXPRESSION, 9},
+  };
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, broken[i].text));
+    program = ast_parse_program(&ast);
+    TEST_ASSERT_EQUAL_size_t(broken[i].children, program->children_count);
+    TEST_ASSERT_EQUAL_size_t(1, ast.diagnostics.count);
+    TEST_ASSERT_EQUAL_INT(broken[i].code, ast.diagnostics.items[0].code);
+    TEST_ASSERT_EQUAL_size_t(broken[i].offset, ast.diagnostics.items[0].offset);
+    free_ast(&ast);
+  }
+}
+
+void test_ast_parses_objects_and_members(void) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(
+      AST_INIT_OK,
+      init_ast(&ast, "let o = {x: 1, y: {z: a + 2},}; o.y.z = o.x * 3; "
+                     "let e = {};"));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_size_t(3, program->children_count);
+
+  ASTNode *object = &program->children[0].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_OBJECT_LITERAL, object->type);
+  TEST_ASSERT_EQUAL_size_t(2, object->children_count);
+  TEST_ASSERT_EQUAL_INT(NODE_PROPERTY, object->children[1].type);
+  TEST_ASSERT_EQUAL_STRING("y", object->children[1].data.property.name);
+  ASTNode *nested = &object->children[1].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_OBJECT_LITERAL, nested->type);
+  TEST_ASSERT_EQUAL_INT(NODE_BINARY_EXPRESSION,
+                        nested->children[0].children[0].type);
+
+  /* (o.y).z = ((o.x) * 3) */
+  ASTNode *assignment = &program->children[1].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_ASSIGNMENT_EXPRESSION, assignment->type);
+  ASTNode *target = &assignment->children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_MEMBER_EXPRESSION, target->type);
+  TEST_ASSERT_EQUAL_STRING("z", target->data.property.name);
+  TEST_ASSERT_EQUAL_STRING("y", target->children[0].data.property.name);
+  TEST_ASSERT_EQUAL_INT(TOKEN_STAR,
+                        assignment->children[1].data.binary.operator);
+  TEST_ASSERT_EQUAL_INT(NODE_MEMBER_EXPRESSION,
+                        assignment->children[1].children[0].type);
+
+  TEST_ASSERT_EQUAL_size_t(0, program->children[2].children[0].children_count);
+
+  free_ast(&ast);
+}
+
+void test_ast_parses_deep_expressions_iteratively(void) {
+  /* Deep enough to overflow the call stack of a recursive descent parser. */
+  const int depth = 200000;
+  char *text = malloc((size_t)depth * 5 + 64);
+  TEST_ASSERT_NOT_NULL(text);
+
+  const char *shapes[] = {"(", "-", "a = ", "a + ", "{a: "};
+  for (int shape = 0; shape < 5; shape++) {
+    size_t length = (size_t)sprintf(text, "let a = 2; let x = ");
+    size_t unit = strlen(shapes[shape]);
+    for (int i = 0; i < depth; i++) {
+      memcpy(text + length, shapes[shape], unit);
+      length += unit;
+    }
+    text[length++] = '1';
+    if (shape == 0 || shape == 4) {
+      memset(text + length, shape == 0 ? ')' : '}', (size_t)depth);
+      length += (size_t)depth;
+    }
+    text[length] = '\0';
+
+    AST ast;
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, text));
+    ASTNode *program = ast_parse_program(&ast);
+    TEST_ASSERT_EQUAL_size_t(2, program->children_count);
+
+    ASTNode *value = &program->children[1].children[0];
+    if (shape == 2) {
+      TEST_ASSERT_EQUAL_INT(NODE_ASSIGNMENT_EXPRESSION, value->type);
+    } else if (shape == 3) {
+      TEST_ASSERT_EQUAL_INT(NODE_BINARY_EXPRESSION, value->type);
+    } else if (shape == 4) {
+      TEST_ASSERT_EQUAL_INT(NODE_OBJECT_LITERAL, value->type);
+      TEST_ASSERT_EQUAL_INT(NODE_PROPERTY, value->children[0].type);
+      TEST_ASSERT_EQUAL_INT(NODE_OBJECT_LITERAL,
+                            value->children[0].children[0].type);
+    } else {
+      TEST_ASSERT_EQUAL_INT(NODE_LITERAL, value->type);
+      TEST_ASSERT_TRUE(value_as_number(value->data.literal.value) == 1.0);
+    }
+
+    /* The tree is as deep as the source, and so are the walks over it. */
+    Chunk chunk;
+    init_chunk(&chunk);
+    TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+    TEST_ASSERT_EQUAL_INT(COMPILE_OK, compile_program(program, &chunk));
+    free_chunk(&chunk);
+
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    FILE *sink = freopen("/dev/null", "w", stdout);
+    TEST_ASSERT_NOT_NULL(sink);
+    ast_node_print(program);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    free_ast(&ast);
+  }
+
+  free(text);
+}
+
+void test_ast_folds_literals_while_parsing(void) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(
+      AST_INIT_OK,
+      init_ast(&ast, "let a = 0; let b = 12345678901234567890; let c = true; "
+                     "let d = null;"));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_size_t(4, program->children_count);
+
+  Value a = program->children[0].children[0].data.literal.value;
+  Value b = program->children[1].children[0].data.literal.value;
+  Value c = program->children[2].children[0].data.literal.value;
+  Value d = program->children[3].children[0].data.literal.value;
+
+  TEST_ASSERT_TRUE(value_is_number(a) && value_as_number(a) == 0.0);
+  TEST_ASSERT_TRUE(value_as_number(b) == 12345678901234567890.0);
+  TEST_ASSERT_TRUE(value_is_boolean(c) && value_as_boolean(c));
+  TEST_ASSERT_TRUE(value_is_null(d));
+
+  free_ast(&ast);
+}
+
+void test_ast_shares_interned_names(void) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK,
+                        init_ast(&ast, "let total = 1; let other = total;"));
+
+  ASTNode *program = ast_parse_program(&ast);
+  ASTNode *declaration = &program->children[0];
+  ASTNode *reference = &program->children[1].children[0];
+
+  TEST_ASSERT_EQUAL_UINT32(declaration->data.declaration.atom,
+                           reference->data.identifier.atom);
+  TEST_ASSERT_EQUAL_PTR(declaration->data.declaration.name,
+                        reference->data.identifier.value);
+  TEST_ASSERT_EQUAL_UINT32(2, ast.atoms.count);
+
+  free_ast(&ast);
+}
+
+void test_ast_parses_token_array(void) {
+  const char *text = "let a = 1; let b = a + 12345678901234567890 + a;";
+  Source source;
+  init_source_string(&source, text);
+
+  ParallelLexOptions parallel = {.threads = 3, .chunk_size = 8};
+  const ParallelLexOptions *options[] = {NULL, &parallel};
+
+  for (int i = 0; i < 2; i++) {
+    AST ast;
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK,
+                          init_ast_tokens(&ast, &source, options[i]));
+    TEST_ASSERT_NULL(ast.lexer);
+
+    ASTNode *program = ast_parse_program(&ast);
+    TEST_ASSERT_EQUAL_size_t(2, program->children_count);
+    TEST_ASSERT_EQUAL_STRING("b", program->children[1].data.declaration.name);
+
+    ASTNode *sum = &program->children[1].children[0];
+    TEST_ASSERT_EQUAL_INT(NODE_BINARY_EXPRESSION, sum->type);
+    TEST_ASSERT_EQUAL_STRING("a", sum->children[1].data.identifier.value);
+    TEST_ASSERT_TRUE(
+        value_as_number(sum->children[0].children[1].data.literal.value) ==
+        12345678901234567890.0);
+    TEST_ASSERT_EQUAL_UINT32(2, ast.atoms.count);
+
+    free_ast(&ast);
+  }
+}
+
+void test_ast_reports_every_error_with_its_location(void) {
+  const char *text = "let a = 1;\n"
+                     "let = 2;\n"
+                     "let b = a + 1;\n"
+                     "const c;\n"
+                     "let o = {x 1};\n"
+                     "let d = (b;\n"
+                     "let e = b * 2; @\n"
+                     "function g(x { }\n"
+                     "let h = e;\n"
+                     "let i = a +;\n"
+                     "let j = h;";
+
+  const struct {
+    DiagnosticCode code;
+    size_t line;
+    size_t column;
+  } expected[] = {
+      {DIAGNOSTIC_EXPECTED_IDENTIFIER, 2, 5},
+      {DIAGNOSTIC_MISSING_INITIALIZER, 4, 7},
+      {DIAGNOSTIC_EXPECTED_COLON, 5, 12},
+      {DIAGNOSTIC_EXPECTED_RIGHT_PAREN, 6, 11},
+      {DIAGNOSTIC_UNKNOWN_TOKEN, 7, 16},
+      {DIAGNOSTIC_EXPECTED_COMMA_OR_PAREN, 8, 14},
+      {DIAGNOSTIC_EXPECTED_EXPRESSION, 10, 12},
+  };
+  const size_t count = sizeof(expected) / sizeof(expected[0]);
+  const char *names[] = {"a", "b", "e", "h", "j"};
+
+  LineIndex lines;
+  init_line_index(&lines, text, strlen(text));
+
+  /* The same errors are found from a lexer, a stream and a token array. */
+  for (int mode = 0; mode < 3; mode++) {
+    const char *cursor = text;
+    Source source;
+    if (mode == 1) {
+      init_source_stream(&source, read_one_byte, &cursor, 1);
+    } else {
+      init_source_string(&source, text);
+    }
+
+    AST ast;
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK,
+                          mode == 2 ? init_ast_tokens(&ast, &source, NULL)
+                                    : init_ast_source(&ast, &source));
+
+    ASTNode *program = ast_parse_program(&ast);
+    TEST_ASSERT_NOT_NULL(program);
+
+    /* Only the statements without errors are in the tree. */
+    TEST_ASSERT_EQUAL_size_t(5, program->children_count);
+    for (size_t i = 0; i < 5; i++) {
+      TEST_ASSERT_EQUAL_STRING(names[i],
+                               program->children[i].data.declaration.name);
+    }
+
+    TEST_ASSERT_EQUAL_size_t(count, ast.diagnostics.count);
+    for (size_t i = 0; i < count; i++) {
+      const Diagnostic *diagnostic = &ast.diagnostics.items[i];
+      SourceLocation location;
+      TEST_ASSERT_EQUAL_INT(expected[i].code, diagnostic->code);
+      TEST_ASSERT_EQUAL_INT(
+          LINE_INDEX_OK,
+          line_index_locate(&lines, diagnostic->offset, &location));
+      TEST_ASSERT_EQUAL_size_t(expected[i].line, location.line);
+      TEST_ASSERT_EQUAL_size_t(expected[i].column, location.column);
+    }
+
+    if (mode == 2) {
+      TEST_ASSERT_EQUAL_size_t(4, ast.stop);
+    }
+
+    free_ast(&ast);
+  }
+
+  free_line_index(&lines);
+}
+
+void test_ast_reports_unsupported_statements(void) {
+  const char *text = "let x = 0;\n"
+                     "if (x) { x = 5; }\n"
+                     "while (x) { x = 7; }\n"
+                     "function f() { return x; }\n"
+                     "function g() { let y = {a: 1}; { y = 2; } let z = y; }\n"
+                     "let w = x;";
+
+  const struct {
+    size_t line;
+    size_t column;
+  } expected[] = {{2, 1}, {3, 1}, {4, 16}, {5, 32}};
+  const size_t count = sizeof(expected) / sizeof(expected[0]);
+
+  LineIndex lines;
+  init_line_index(&lines, text, strlen(text));
+
+  /* Statements the parser lacks are reported, at the top level and in
+   * function bodies, and skipped along with their blocks. */
+  for (int mode = 0; mode < 3; mode++) {
+    const char *cursor = text;
+    Source source;
+    if (mode == 1) {
+      init_source_stream(&source, read_one_byte, &cursor, 1);
+    } else {
+      init_source_string(&source, text);
+    }
+
+    AST ast;
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK,
+                          mode == 2 ? init_ast_tokens(&ast, &source, NULL)
+                                    : init_ast_source(&ast, &source));
+
+    ASTNode *program = ast_parse_program(&ast);
+    TEST_ASSERT_NOT_NULL(program);
+    TEST_ASSERT_EQUAL_size_t(2, program->children_count);
+    TEST_ASSERT_EQUAL_STRING("x", program->children[0].data.declaration.name);
+    TEST_ASSERT_EQUAL_STRING("w", program->children[1].data.declaration.name);
+
+    TEST_ASSERT_EQUAL_size_t(count, ast.diagnostics.count);
+    for (size_t i = 0; i < count; i++) {
+      const Diagnostic *diagnostic = &ast.diagnostics.items[i];
+      SourceLocation location;
+      TEST_ASSERT_EQUAL_INT(DIAGNOSTIC_UNSUPPORTED_STATEMENT, diagnostic->code);
+      TEST_ASSERT_EQUAL_INT(
+          LINE_INDEX_OK,
+          line_index_locate(&lines, diagnostic->offset, &location));
+      TEST_ASSERT_EQUAL_size_t(expected[i].line, location.line);
+      TEST_ASSERT_EQUAL_size_t(expected[i].column, location.column);
+    }
+
+    if (mode == 2) {
+      TEST_ASSERT_EQUAL_size_t(4, ast.stop);
+    }
+
+    free_ast(&ast);
+  }
+
+  free_line_index(&lines);
+}
+
+/*
+ * Asserts that two trees are identical, comparing names by their text.
+ */
+static void assert_same_tree(const ASTNode *expected, const ASTNode *actual) {
+  TEST_ASSERT_EQUAL_INT(expected->type, actual->type);
+  TEST_ASSERT_EQUAL_size_t(expected->children_count, actual->children_count);
+
+  switch (expected->type) {
+  case NODE_VARIABLE_DECLARATION:
+    TEST_ASSERT_EQUAL_STRING(expected->data.declaration.name,
+                             actual->data.declaration.name);
+    break;
+  case NODE_IDENTIFIER:
+    TEST_ASSERT_EQUAL_STRING(expected->data.identifier.value,
+                             actual->data.identifier.value);
+    break;
+  case NODE_LITERAL:
+    TEST_ASSERT_EQUAL_UINT64(expected->data.literal.value,
+                             actual->data.literal.value);
+    break;
+  case NODE_BINARY_EXPRESSION:
+    TEST_ASSERT_EQUAL_INT(expected->data.binary.operator,
+                          actual->data.binary.operator);
+    break;
+  case NODE_FUNCTION_DECLARATION:
+    TEST_ASSERT_EQUAL_STRING(expected->data.function.name,
+                             actual->data.function.name);
+    break;
+  case NODE_FUNCTION_BODY:
+    TEST_ASSERT_EQUAL_INT(expected->data.body.parsed,
+                          actual->data.body.parsed);
+    TEST_ASSERT_EQUAL_size_t(expected->data.body.first,
+                             actual->data.body.first);
+    TEST_ASSERT_EQUAL_size_t(expected->data.body.end, actual->data.body.end);
+    break;
+  default:
+    break;
+  }
+
+  for (size_t i = 0; i < expected->children_count; i++) {
+    assert_same_tree(&expected->children[i], &actual->children[i]);
+  }
+}
+
+/*
+ * Helper function writing a well-formed program of `count` declarations,
+ * every fifth of which is a function.
+ */
+static size_t write_program(char *text, size_t capacity, int count) {
+  size_t length = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (i % 5 == 4) {
+      length += (size_t)snprintf(text + length, capacity - length,
+                                 "function f%d(a, b) { let c = a + %d; }\n",
+                                 i, i);
+    } else {
+      length += (size_t)snprintf(text + length, capacity - length,
+                                 "let v%d = v%d + %d;\n", i, i / 2, i);
+    }
+  }
+
+  return length;
+}
+
+void test_ast_preparses_function_bodies(void) {
+  const char *text = "let a = 1;\n"
+                     "function f(x, y) { let b = x + y; function g() {"
+                     " let c = 2; } }\n"
+                     "function h() { }\n"
+                     "let d = a;";
+  Source source;
+  init_source_string(&source, text);
+
+  AST eager;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&eager, &source, NULL));
+  ASTNode *expected = ast_parse_program(&eager);
+  TEST_ASSERT_EQUAL_size_t(4, expected->children_count);
+
+  ASTNode *f = &expected->children[1];
+  TEST_ASSERT_EQUAL_INT(NODE_FUNCTION_DECLARATION, f->type);
+  TEST_ASSERT_EQUAL_STRING("f", f->data.function.name);
+  TEST_ASSERT_EQUAL_size_t(3, f->children_count);
+  TEST_ASSERT_EQUAL_STRING("y", f->children[1].data.identifier.value);
+  TEST_ASSERT_TRUE(f->children[2].data.body.parsed);
+  TEST_ASSERT_EQUAL_size_t(2, f->children[2].children_count);
+  TEST_ASSERT_EQUAL_INT(NODE_FUNCTION_DECLARATION,
+                        f->children[2].children[1].type);
+
+  AST lazy;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&lazy, &source, NULL));
+  lazy.lazy_functions = true;
+  ASTNode *program = ast_parse_program(&lazy);
+  TEST_ASSERT_EQUAL_size_t(4, program->children_count);
+  TEST_ASSERT_EQUAL_size_t(4, lazy.range_count);
+
+  /* Only the braces of the bodies were matched. */
+  ASTNode *body = &program->children[1].children[2];
+  TEST_ASSERT_FALSE(body->data.body.parsed);
+  TEST_ASSERT_EQUAL_size_t(0, body->children_count);
+  TEST_ASSERT_EQUAL_size_t(f->children[2].data.body.first,
+                           body->data.body.first);
+  TEST_ASSERT_EQUAL_size_t(f->children[2].data.body.end, body->data.body.end);
+
+  TEST_ASSERT_EQUAL_INT(AST_BODY_OK,
+                        ast_parse_function_body(&lazy, &program->children[1]));
+  TEST_ASSERT_EQUAL_INT(AST_BODY_OK,
+                        ast_parse_function_body(&lazy, &program->children[1]));
+  TEST_ASSERT_EQUAL_INT(AST_BODY_OK,
+                        ast_parse_function_body(&lazy, &program->children[2]));
+  TEST_ASSERT_EQUAL_INT(AST_BODY_ERROR_INVALID,
+                        ast_parse_function_body(&lazy, &program->children[0]));
+  assert_same_tree(expected, program);
+
+  free_ast(&lazy);
+  free_ast(&eager);
+
+  /* Unbalanced braces end the program in both modes. */
+  const char *broken[] = {"let a = 1; function f() { { let b = 2; }",
+                          "let a = 1; function f() { let b = 2; # }"};
+  for (int i = 0; i < 2; i++) {
+    for (int mode = 0; mode < 2; mode++) {
+      init_source_string(&source, broken[i]);
+      TEST_ASSERT_EQUAL_INT(AST_INIT_OK,
+                            init_ast_tokens(&lazy, &source, NULL));
+      lazy.lazy_functions = mode == 1;
+      program = ast_parse_program(&lazy);
+      TEST_ASSERT_EQUAL_size_t(1, program->children_count);
+      free_ast(&lazy);
+    }
+  }
+
+  /* Errors neighbouring tokens show are found by pre-parsing, where the
+   * eager parser finds them. */
+  const char *rejected[] = {
+      "function f() { let = ; ( } let a = 1;",
+      "function f() { let b = (1 + 2; } let a = 1;",
+      "function f() { let b = 1 + ; } let a = 1;",
+      "function f() { let b = {c: }; } let a = 1;",
+      "function f() { b.let } let a = 1;",
+      "function f() { let b = 1) } let a = 1;",
+      "function f() { if (b) { } } let a = 1;",
+      "function f() { let b = 1 # } let a = 1;",
+  };
+  for (size_t i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++) {
+    init_source_string(&source, rejected[i]);
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&eager, &source, NULL));
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&lazy, &source, NULL));
+    lazy.lazy_functions = true;
+    ast_parse_program(&eager);
+    program = ast_parse_program(&lazy);
+
+    TEST_ASSERT_EQUAL_size_t(1, program->children_count);
+    TEST_ASSERT_EQUAL_size_t(1, lazy.diagnostics.count);
+    TEST_ASSERT_TRUE(eager.diagnostics.count > 0);
+    TEST_ASSERT_EQUAL_INT(eager.diagnostics.items[0].code,
+                          lazy.diagnostics.items[0].code);
+    TEST_ASSERT_EQUAL_size_t(eager.diagnostics.items[0].offset,
+                             lazy.diagnostics.items[0].offset);
+    TEST_ASSERT_EQUAL_size_t(eager.diagnostics.items[0].length,
+                             lazy.diagnostics.items[0].length);
+    free_ast(&lazy);
+    free_ast(&eager);
+  }
+
+  /* Other errors are only found when the body is built, and reported apart
+   * from those of the program. */
+  text = "function f() {\n"
+         "  let b = 1;\n"
+         "  const c;\n"
+         "}\n"
+         "let a = 1;\n"
+         "function g() { a = 2; }";
+  init_source_string(&source, text);
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&lazy, &source, NULL));
+  lazy.lazy_functions = true;
+  program = ast_parse_program(&lazy);
+  TEST_ASSERT_EQUAL_size_t(3, program->children_count);
+  TEST_ASSERT_EQUAL_INT(AST_BODY_ERROR_SYNTAX,
+                        ast_parse_function_body(&lazy, &program->children[0]));
+  TEST_ASSERT_EQUAL_size_t(0, lazy.diagnostics.count);
+  TEST_ASSERT_EQUAL_size_t(1, lazy.body_diagnostics.count);
+  TEST_ASSERT_EQUAL_INT(DIAGNOSTIC_MISSING_INITIALIZER,
+                        lazy.body_diagnostics.items[0].code);
+  TEST_ASSERT_EQUAL_size_t(0, program->children[0].children[0].children_count);
+
+  LineIndex lines;
+  SourceLocation location;
+  init_line_index(&lines, text, strlen(text));
+  TEST_ASSERT_EQUAL_INT(LINE_INDEX_OK,
+                        line_index_locate(&lines,
+                                          lazy.body_diagnostics.items[0].offset,
+                                          &location));
+  TEST_ASSERT_EQUAL_size_t(3, location.line);
+  TEST_ASSERT_EQUAL_size_t(9, location.column);
+  free_line_index(&lines);
+
+  /* A body built without errors empties them. */
+  TEST_ASSERT_EQUAL_INT(AST_BODY_OK,
+                        ast_parse_function_body(&lazy, &program->children[2]));
+  TEST_ASSERT_EQUAL_size_t(0, lazy.body_diagnostics.count);
+  free_ast(&lazy);
+}
+
+void test_ast_limits_function_nesting(void) {
+  const char *unit = "function f() {";
+  const size_t unit_length = strlen(unit);
+  const size_t limit = AST_MAX_FUNCTION_DEPTH;
+  const size_t depths[] = {limit, limit + 1, 50000};
+  char *text = malloc(50000 * (unit_length + 1) + 64);
+  TEST_ASSERT_NOT_NULL(text);
+
+  for (size_t d = 0; d < 3; d++) {
+    size_t length = 0;
+    for (size_t i = 0; i < depths[d]; i++) {
+      memcpy(text + length, unit, unit_length);
+      length += unit_length;
+    }
+    memset(text + length, '}', depths[d]);
+    length += depths[d];
+    length += (size_t)sprintf(text + length, "\nlet a = 1;");
+
+    /* Too deep a function is reported at its name and left out, and so is
+     * the top-level function holding it. */
+    bool deep = depths[d] > limit;
+    for (int mode = 0; mode < 3; mode++) {
+      Source source;
+      init_source_buffer(&source, text, length);
+
+      AST ast;
+      TEST_ASSERT_EQUAL_INT(AST_INIT_OK,
+                            mode == 0 ? init_ast_source(&ast, &source)
+                                      : init_ast_tokens(&ast, &source, NULL));
+      ast.lazy_functions = mode == 2;
+
+      ASTNode *program = ast_parse_program(&ast);
+      TEST_ASSERT_NOT_NULL(program);
+
+      if (mode == 2) {
+        TEST_ASSERT_EQUAL_size_t(0, ast.diagnostics.count);
+        TEST_ASSERT_EQUAL_INT(
+            deep ? AST_BODY_ERROR_SYNTAX : AST_BODY_OK,
+            ast_parse_function_body(&ast, &program->children[0]));
+        if (deep) {
+          TEST_ASSERT_EQUAL_INT(DIAGNOSTIC_NESTING_TOO_DEEP,
+                                ast.body_diagnostics.items[0].code);
+          TEST_ASSERT_EQUAL_size_t(limit * unit_length + 9,
+                                   ast.body_diagnostics.items[0].offset);
+        }
+      } else {
+        TEST_ASSERT_EQUAL_size_t(deep ? 1 : 2, program->children_count);
+        TEST_ASSERT_EQUAL_size_t(deep ? 1 : 0, ast.diagnostics.count);
+        if (deep) {
+          TEST_ASSERT_EQUAL_INT(DIAGNOSTIC_NESTING_TOO_DEEP,
+                                ast.diagnostics.items[0].code);
+          TEST_ASSERT_EQUAL_size_t(limit * unit_length + 9,
+                                   ast.diagnostics.items[0].offset);
+        }
+      }
+
+      free_ast(&ast);
+    }
+  }
+
+  free(text);
+}
+
+void test_ast_reparses_edits_like_a_full_parse(void) {
+  static const char *snippets[] = {
+      "let ", "x", "1", " + ", "= ", ";", "\n", "y2 ", "true", "",
+      "{ ",   "}", "function g(a) ", ", ", "1e", "1e+", "1e-", "e", "5",
+  };
+  const size_t snippet_count = sizeof(snippets) / sizeof(snippets[0]);
+
+  char text[2][4096];
+  char fresh[4096];
+  int current = 0;
+  size_t length = write_program(text[0], sizeof(text[0]), 120);
+
+  Source source;
+  init_source_buffer(&source, text[0], length);
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&ast, &source, NULL));
+  ast.lazy_functions = true;
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_NOT_NULL(program);
+
+  uint64_t state = 0x2545f4914f6cdd1du;
+
+  for (int round = 0; round < 400; round++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    /* Replace a few bytes of the previous text with a snippet. Random edits
+     * soon break declarations, which stops parsing from resyncing after
+     * them, so every few rounds the whole text is replaced with a
+     * well-formed program. */
+    SourceEdit edit;
+    const char *snippet;
+
+    if (round % 8 == 7) {
+      edit.offset = 0;
+      edit.removed = length;
+      edit.inserted = write_program(fresh, sizeof(fresh), 60 + round % 50);
+      snippet = fresh;
+    } else {
+      edit.offset = (size_t)(state % (length + 1));
+
+      /* Half of the edits land past the sign of an exponent, where they
+       * may complete a number that ends before them. */
+      for (size_t i = edit.offset; round % 2 == 1 && i + 1 < length; i++) {
+        const char *at = text[current] + i;
+        if (at[0] == 'e' && (at[1] == '+' || at[1] == '-')) {
+          edit.offset = i + 2;
+          break;
+        }
+      }
+      edit.removed = (size_t)((state >> 20) % 4);
+      if (edit.removed > length - edit.offset)
+        edit.removed = length - edit.offset;
+      snippet = snippets[(state >> 32) % snippet_count];
+      edit.inserted = strlen(snippet);
+    }
+
+    if (length - edit.removed + edit.inserted >= sizeof(text[0]))
+      continue;
+
+    /* The previous text is kept alive until the edit is applied. */
+    int next = 1 - current;
+    memcpy(text[next], text[current], edit.offset);
+    memcpy(text[next] + edit.offset, snippet, edit.inserted);
+    memcpy(text[next] + edit.offset + edit.inserted,
+           text[current] + edit.offset + edit.removed,
+           length - edit.offset - edit.removed);
+    length = length - edit.removed + edit.inserted;
+    current = next;
+
+    init_source_buffer(&source, text[current], length);
+    TEST_ASSERT_EQUAL_PTR(program, ast_reparse(&ast, program, &source, &edit));
+
+    if (length == 0)
+      break;
+
+    AST full;
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&full, &source, NULL));
+    full.lazy_functions = true;
+    ASTNode *expected = ast_parse_program(&full);
+
+    TEST_ASSERT_EQUAL_size_t(full.tokens.count, ast.tokens.count);
+    TEST_ASSERT_EQUAL_MEMORY(full.tokens.types, ast.tokens.types,
+                             full.tokens.count);
+    TEST_ASSERT_EQUAL_MEMORY(full.tokens.offsets, ast.tokens.offsets,
+                             full.tokens.count * sizeof(size_t));
+    TEST_ASSERT_EQUAL_MEMORY(full.tokens.lengths, ast.tokens.lengths,
+                             full.tokens.count * sizeof(size_t));
+    TEST_ASSERT_EQUAL_size_t(full.stop, ast.stop);
+    assert_same_tree(expected, program);
+
+    TEST_ASSERT_EQUAL_size_t(full.diagnostics.count, ast.diagnostics.count);
+    for (size_t i = 0; i < full.diagnostics.count; i++) {
+      TEST_ASSERT_EQUAL_INT(full.diagnostics.items[i].code,
+                            ast.diagnostics.items[i].code);
+      TEST_ASSERT_EQUAL_size_t(full.diagnostics.items[i].offset,
+                               ast.diagnostics.items[i].offset);
+    }
+
+    free_ast(&full);
+  }
+
+  free_ast(&ast);
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/atom.h"
+#include "../include/lexer.h"
+#include "../third_party/Unity/src/unity.h"
+
+void test_atom_table_interns_each_name_once(void) {
+  AtomTable table;
+  init_atom_table(&table);
+
+  /* Enough names to grow the slots and entries several times. */
+  char name[32];
+  for (int i = 0; i < 5000; i++) {
+    int length = snprintf(name, sizeof(name), "name_%d", i);
+    TEST_ASSERT_EQUAL_UINT32(i, atom_intern(&table, name, (size_t)length));
+  }
+
+  for (int i = 0; i < 5000; i += 7) {
+    int length = snprintf(name, sizeof(name), "name_%d", i);
+    Atom atom = atom_intern(&table, name, (size_t)length);
+    TEST_ASSERT_EQUAL_UINT32(i, atom);
+    TEST_ASSERT_EQUAL_STRING(name, atom_text(&table, atom));
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(5000, table.count);
+
+  /* Prefixes of a name are distinct names. */
+  TEST_ASSERT_EQUAL_UINT32(5000, atom_intern(&table, "name_1", 5));
+
+  free_atom_table(&table);
+  TEST_ASSERT_NULL(table.entries);
+}
+
+void test_lexer_interns_identifiers(void) {
+  AtomTable table;
+  init_atom_table(&table);
+
+  Lexer lexer;
+  TEST_ASSERT_EQUAL_INT(LEXER_INIT_OK,
+                        init_lexer(&lexer, "alpha beta alpha let 42 beta"));
+  lexer.atoms = &table;
+
+  LexerToken tokens[6];
+  for (int i = 0; i < 6; i++) {
+    tokens[i] = next_lexical_token(&lexer);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(0, tokens[0].payload);
+  TEST_ASSERT_EQUAL_UINT32(1, tokens[1].payload);
+  TEST_ASSERT_EQUAL_UINT32(tokens[0].payload, tokens[2].payload);
+  TEST_ASSERT_EQUAL_INT(TOKEN_LET, tokens[3].type);
+  TEST_ASSERT_EQUAL_UINT32(0, tokens[4].payload);
+  TEST_ASSERT_TRUE(lexer_number(&lexer) == 42.0);
+  TEST_ASSERT_EQUAL_UINT32(tokens[1].payload, tokens[5].payload);
+  TEST_ASSERT_EQUAL_UINT32(2, table.count);
+
+  free_lexer(&lexer);
+  free_atom_table(&table);
+}
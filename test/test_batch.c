@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../include/batch.h"
+#include "../third_party/Unity/src/unity.h"
+
+#define BATCH_TEST_FILES 24
+
+void test_batch_parses_files_in_input_order(void) {
+  char paths[BATCH_TEST_FILES][32];
+  ParsedFile files[BATCH_TEST_FILES + 1];
+
+  for (int i = 0; i < BATCH_TEST_FILES; i++) {
+    snprintf(paths[i], sizeof(paths[i]), "/tmp/cijs_batch_XXXXXX");
+    int fd = mkstemp(paths[i]);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    /* File i declares i + 1 variables. */
+    FILE *file = fdopen(fd, "w");
+    for (int j = 0; j <= i; j++) {
+      fprintf(file, "let file%d_%d = %d;\n", i, j, j);
+    }
+    fclose(file);
+
+    files[i].path = paths[i];
+  }
+  files[BATCH_TEST_FILES].path = "/tmp/cijs_batch_missing/none.js";
+
+  BatchOptions options = {.threads = 4, .measure = true};
+  TEST_ASSERT_EQUAL_INT(BATCH_OK,
+                        parse_files(files, BATCH_TEST_FILES + 1, &options));
+
+  for (int i = 0; i < BATCH_TEST_FILES; i++) {
+    TEST_ASSERT_EQUAL_INT(PARSE_FILE_OK, files[i].status);
+    TEST_ASSERT_NOT_NULL(files[i].program);
+    TEST_ASSERT_EQUAL_size_t(i + 1, files[i].program->children_count);
+    TEST_ASSERT_EQUAL_INT(4 * (i + 1), files[i].tokens);
+
+    char name[32];
+    snprintf(name, sizeof(name), "file%d_%d", i, i);
+    TEST_ASSERT_EQUAL_STRING(
+        name, files[i].program->children[i].data.declaration.name);
+  }
+
+  TEST_ASSERT_EQUAL_INT(PARSE_FILE_ERROR_LOAD,
+                        files[BATCH_TEST_FILES].status);
+  TEST_ASSERT_NULL(files[BATCH_TEST_FILES].program);
+
+  for (int i = 0; i <= BATCH_TEST_FILES; i++) {
+    free_parsed_file(&files[i]);
+    if (i < BATCH_TEST_FILES)
+      unlink(paths[i]);
+  }
+}
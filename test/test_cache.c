@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/cache.h"
+#include "../include/compiler.h"
+#include "../include/vm.h"
+#include "../third_party/Unity/src/unity.h"
+
+void test_cache_round_trips_tree_and_bytecode(void) {
+  char directory[] = "/tmp/cijs_cache_XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+
+  const char *text =
+      "let a = 1; const b = a + 20 + true; let c; let o = {x: b}; o.y = o.x;";
+  Source source;
+  init_source_string(&source, text);
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, text));
+  ASTNode *program = ast_parse_program(&ast);
+  Chunk chunk;
+  init_chunk(&chunk);
+  TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+  TEST_ASSERT_EQUAL_INT(COMPILE_OK, compile_program(program, &chunk));
+
+  CachedProgram cached;
+  TEST_ASSERT_EQUAL_INT(CACHE_ERROR_MISS,
+                        cache_load(directory, &source, &cached));
+  TEST_ASSERT_EQUAL_INT(CACHE_OK,
+                        cache_store(directory, &source, program, &chunk));
+  TEST_ASSERT_EQUAL_INT(CACHE_OK, cache_load(directory, &source, &cached));
+
+  ASTNode *loaded = cached.program;
+  TEST_ASSERT_EQUAL_size_t(5, loaded->children_count);
+  TEST_ASSERT_EQUAL_STRING("b", loaded->children[1].data.declaration.name);
+  TEST_ASSERT_TRUE(loaded->children[1].data.declaration.constant);
+  TEST_ASSERT_FALSE(loaded->children[0].data.declaration.constant);
+  ASTNode *sum = &loaded->children[1].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_BINARY_EXPRESSION, sum->type);
+  TEST_ASSERT_EQUAL_STRING("a",
+                           sum->children[0].children[0].data.identifier.value);
+  TEST_ASSERT_TRUE(
+      value_as_number(sum->children[0].children[1].data.literal.value) == 20.0);
+  TEST_ASSERT_EQUAL_size_t(0, loaded->children[2].children_count);
+
+  TEST_ASSERT_EQUAL_size_t(chunk.code_count, cached.chunk.code_count);
+  TEST_ASSERT_EQUAL_MEMORY(chunk.code, cached.chunk.code,
+                           chunk.code_count * sizeof(uint32_t));
+  TEST_ASSERT_EQUAL_STRING("c", cached.chunk.variables[2]);
+  TEST_ASSERT_EQUAL_size_t(2, cached.chunk.property_count);
+  TEST_ASSERT_EQUAL_STRING("y", cached.chunk.properties[1]);
+  TEST_ASSERT_EQUAL_UINT32(chunk.cache_count, cached.chunk.cache_count);
+
+  ASTNode *member = &loaded->children[4].children[0].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_MEMBER_EXPRESSION, member->type);
+  TEST_ASSERT_EQUAL_STRING("y", member->data.property.name);
+
+  VM vm;
+  init_vm(&vm);
+  TEST_ASSERT_EQUAL_INT(VM_RUN_OK, vm_run(&vm, &cached.chunk));
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[1]) == 22.0);
+  Object *object = (Object *)value_as_object(vm.registers[3]);
+  TEST_ASSERT_TRUE(value_as_number(object_get(object, 1)) == 22.0);
+  free_vm(&vm);
+
+  free_cached_program(&cached);
+  free_chunk(&chunk);
+  free_ast(&ast);
+
+  /* A changed source misses, and a damaged file is rejected. */
+  Source edited;
+  init_source_string(&edited, "let a = 2;");
+  TEST_ASSERT_EQUAL_INT(CACHE_ERROR_MISS,
+                        cache_load(directory, &edited, &cached));
+
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%016llx.cjsc", directory,
+           (unsigned long long)cache_hash(text, strlen(text)));
+  TEST_ASSERT_EQUAL_INT(0, truncate(path, 100));
+  TEST_ASSERT_EQUAL_INT(CACHE_ERROR_INVALID,
+                        cache_load(directory, &source, &cached));
+  TEST_ASSERT_NULL(cached.mapping);
+
+  unlink(path);
+  rmdir(directory);
+}
+
+/*
+ * Helper function parsing, resolving, compiling and caching a source.
+ */
+static void store_program(const char *directory, const char *text) {
+  Source source;
+  init_source_string(&source, text);
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, text));
+  ASTNode *program = ast_parse_program(&ast);
+  Chunk chunk;
+  init_chunk(&chunk);
+  TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+  TEST_ASSERT_EQUAL_INT(COMPILE_OK, compile_program(program, &chunk));
+  TEST_ASSERT_EQUAL_INT(CACHE_OK,
+                        cache_store(directory, &source, program, &chunk));
+
+  free_chunk(&chunk);
+  free_ast(&ast);
+}
+
+/*
+ * Helper function replacing the first or the last 8-byte aligned occurrence
+ * of `from` in a file with `to`.
+ */
+static void patch_file(const char *path, uint64_t from, uint64_t to,
+                       bool last) {
+  FILE *file = fopen(path, "r+b");
+  TEST_ASSERT_NOT_NULL(file);
+
+  long found = -1;
+  uint64_t word;
+  for (long offset = 0; fread(&word, sizeof(word), 1, file) == 1;
+       offset += (long)sizeof(word)) {
+    if (word == from) {
+      found = offset;
+      if (!last)
+        break;
+    }
+  }
+
+  TEST_ASSERT_TRUE(found >= 0);
+  TEST_ASSERT_EQUAL_INT(0, fseek(file, found, SEEK_SET));
+  TEST_ASSERT_EQUAL_INT(1, fwrite(&to, sizeof(to), 1, file));
+  TEST_ASSERT_EQUAL_INT(0, fclose(file));
+}
+
+void test_cache_rejects_forged_files(void) {
+  char directory[] = "/tmp/cijs_cache_XXXXXX";
+  TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+
+  const char *text = "let a = 1; let b = a + 20;";
+  Source source;
+  init_source_string(&source, text);
+
+  char path[64];
+  snprintf(path, sizeof(path), "%s/%016llx.cjsc", directory,
+           (unsigned long long)cache_hash(text, strlen(text)));
+
+  /* Another source with the same hash, the constant 20 and the literal 20
+   * turned into pointers are all rejected. */
+  uint64_t twenty = value_number(20.0);
+  uint64_t pointer = value_object(&source);
+  CachedProgram cached;
+
+  for (int forgery = 0; forgery < 4; forgery++) {
+    store_program(directory, text);
+
+    if (forgery == 1) {
+      FILE *file = fopen(path, "r+b");
+      TEST_ASSERT_NOT_NULL(file);
+      TEST_ASSERT_EQUAL_INT(0, fseek(file, -1, SEEK_END));
+      TEST_ASSERT_EQUAL_INT(':', fputc(':', file));
+      TEST_ASSERT_EQUAL_INT(0, fclose(file));
+    } else if (forgery > 1) {
+      patch_file(path, twenty, pointer, forgery == 3);
+    }
+
+    TEST_ASSERT_EQUAL_INT(forgery == 0 ? CACHE_OK : CACHE_ERROR_INVALID,
+                          cache_load(directory, &source, &cached));
+    free_cached_program(&cached);
+  }
+
+  /* Trees deeper than the call stack round-trip. */
+  const int depth = 200000;
+  char *deep = malloc((size_t)depth * 4 + 64);
+  TEST_ASSERT_NOT_NULL(deep);
+  size_t length = (size_t)sprintf(deep, "let a = 1; let x = ");
+  for (int i = 0; i < depth; i++) {
+    memcpy(deep + length, "a + ", 4);
+    length += 4;
+  }
+  memcpy(deep + length, "1;", 3);
+
+  store_program(directory, deep);
+  init_source_string(&source, deep);
+  TEST_ASSERT_EQUAL_INT(CACHE_OK, cache_load(directory, &source, &cached));
+  ASTNode *sum = &cached.program->children[1].children[0];
+  TEST_ASSERT_EQUAL_INT(NODE_BINARY_EXPRESSION, sum->type);
+  TEST_ASSERT_EQUAL_INT(NODE_LITERAL, sum->children[1].type);
+  free_cached_program(&cached);
+
+  snprintf(path, sizeof(path), "%s/%016llx.cjsc", directory,
+           (unsigned long long)cache_hash(deep, strlen(deep)));
+  unlink(path);
+  free(deep);
+
+  snprintf(path, sizeof(path), "%s/%016llx.cjsc", directory,
+           (unsigned long long)cache_hash(text, strlen(text)));
+  unlink(path);
+  rmdir(directory);
+}
@@ -0,0 +1,104 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/diagnostic.h"
+#include "../third_party/Unity/src/unity.h"
+
+void test_line_index_locates_offsets(void) {
+  const char *text = "let a;\r\nlet b\n\n  c";
+  LineIndex index;
+  init_line_index(&index, text, strlen(text));
+
+  /* Nothing is scanned until a location is asked for. */
+  TEST_ASSERT_EQUAL_size_t(0, index.count);
+
+  const struct {
+    size_t offset;
+    size_t line;
+    size_t column;
+  } cases[] = {{0, 1, 1},  {4, 1, 5},  {6, 1, 7},  {7, 1, 8}, {8, 2, 1},
+               {12, 2, 5}, {13, 2, 6}, {14, 3, 1}, {17, 4, 3}, {18, 4, 4}};
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    SourceLocation location;
+    TEST_ASSERT_EQUAL_INT(LINE_INDEX_OK,
+                          line_index_locate(&index, cases[i].offset,
+                                            &location));
+    TEST_ASSERT_EQUAL_size_t(cases[i].line, location.line);
+    TEST_ASSERT_EQUAL_size_t(cases[i].column, location.column);
+  }
+
+  TEST_ASSERT_EQUAL_size_t(4, index.count);
+
+  SourceLocation location;
+  TEST_ASSERT_EQUAL_INT(LINE_INDEX_ERROR_OUT_OF_RANGE,
+                        line_index_locate(&index, 19, &location));
+  free_line_index(&index);
+
+  /* Newlines at every position of the vectors, and runs of them, are found
+   * like a byte-by-byte count would. */
+  static char large[10000];
+  uint64_t state = 0x9e3779b97f4a7c15u;
+  for (size_t i = 0; i < sizeof(large); i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    large[i] = state % 7 == 0 ? '\n' : (char)('a' + state % 26);
+  }
+
+  init_line_index(&index, large, sizeof(large));
+
+  size_t line = 1;
+  size_t column = 1;
+  for (size_t offset = 0; offset <= sizeof(large); offset++) {
+    TEST_ASSERT_EQUAL_INT(LINE_INDEX_OK,
+                          line_index_locate(&index, offset, &location));
+    TEST_ASSERT_EQUAL_size_t(line, location.line);
+    TEST_ASSERT_EQUAL_size_t(column, location.column);
+
+    if (offset < sizeof(large) && large[offset] == '\n') {
+      line++;
+      column = 1;
+    } else {
+      column++;
+    }
+  }
+
+  free_line_index(&index);
+
+  /* An empty source has one empty line. */
+  init_line_index(&index, "", 0);
+  TEST_ASSERT_EQUAL_INT(LINE_INDEX_OK, line_index_locate(&index, 0, &location));
+  TEST_ASSERT_EQUAL_size_t(1, location.line);
+  TEST_ASSERT_EQUAL_size_t(1, location.column);
+  free_line_index(&index);
+}
+
+void test_diagnostic_list_keeps_every_error(void) {
+  DiagnosticList list;
+  init_diagnostic_list(&list);
+  TEST_ASSERT_NULL(list.items);
+
+  for (size_t i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL_INT(
+        1, diagnostic_list_add(&list, (DiagnosticCode)(i % 13), i * 3, 1));
+  }
+
+  TEST_ASSERT_EQUAL_size_t(100, list.count);
+  for (size_t i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL_INT(i % 13, list.items[i].code);
+    TEST_ASSERT_EQUAL_size_t(i * 3, list.items[i].offset);
+  }
+
+  TEST_ASSERT_EQUAL_STRING("expected an expression",
+                           diagnostic_message(DIAGNOSTIC_EXPECTED_EXPRESSION));
+  for (int code = DIAGNOSTIC_UNKNOWN_TOKEN;
+       code <= DIAGNOSTIC_TOKEN_TOO_LONG; code++) {
+    TEST_ASSERT_TRUE(strcmp("syntax error",
+                            diagnostic_message((DiagnosticCode)code)) != 0);
+  }
+
+  free_diagnostic_list(&list);
+  TEST_ASSERT_NULL(list.items);
+  TEST_ASSERT_EQUAL_size_t(0, list.count);
+}
@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "../include/lexer.h"
+#include "../third_party/Unity/src/unity.h"
+
+void test_lexer_token_is_compact(void) {
+  TEST_ASSERT_TRUE(sizeof(LexerToken) <= 16);
+}
+
+void test_lexer_long_identifier_is_not_truncated(void) {
+  char source[600];
+  memcpy(source, "let ", 4);
+  memset(source + 4, 'x', 500);
+  strcpy(source + 504, " = 1;");
+
+  Lexer lexer;
+  TEST_ASSERT_EQUAL_INT(LEXER_INIT_OK, init_lexer(&lexer, source));
+
+  LexerToken token = next_lexical_token(&lexer);
+  TEST_ASSERT_EQUAL_INT(TOKEN_LET, token.type);
+
+  token = next_lexical_token(&lexer);
+  TEST_ASSERT_EQUAL_INT(TOKEN_IDENTIFIER, token.type);
+  TEST_ASSERT_EQUAL_INT(500, token.length);
+  TEST_ASSERT_EQUAL_PTR(source + 4, lexer_token_text(&lexer, token));
+
+  token = next_lexical_token(&lexer);
+  TEST_ASSERT_EQUAL_INT(TOKEN_EQUAL, token.type);
+
+  token = next_lexical_token(&lexer);
+  TEST_ASSERT_EQUAL_INT(TOKEN_NUMBER, token.type);
+  TEST_ASSERT_TRUE(lexer_number(&lexer) == 1.0);
+
+  token = next_lexical_token(&lexer);
+  TEST_ASSERT_EQUAL_INT(TOKEN_EOF, token.type);
+
+  free_lexer(&lexer);
+}
+
+void test_lexer_recognizes_every_keyword(void) {
+  /* Sorted so that the n-th keyword maps to TOKEN_AWAIT + n. */
+  const char *source =
+      "await break case catch class const continue debugger default delete do "
+      "else enum export extends false finally for function if import in "
+      "instanceof let new null return static super switch this throw true try "
+      "typeof var void while with yield";
+
+  Lexer lexer;
+  TEST_ASSERT_EQUAL_INT(LEXER_INIT_OK, init_lexer(&lexer, source));
+
+  for (TokenType type = TOKEN_AWAIT; type <= TOKEN_YIELD; type++) {
+    TEST_ASSERT_EQUAL_INT(type, next_lexical_token(&lexer).type);
+  }
+  TEST_ASSERT_EQUAL_INT(TOKEN_EOF, next_lexical_token(&lexer).type);
+
+  free_lexer(&lexer);
+}
+
+void test_lexer_keyword_lookalikes_are_identifiers(void) {
+  Lexer lexer;
+  TEST_ASSERT_EQUAL_INT(
+      LEXER_INIT_OK,
+      init_lexer(&lexer, "lets le Let instanceOf returns _if $new tru"));
+
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL_INT(TOKEN_IDENTIFIER, next_lexical_token(&lexer).type);
+  }
+  TEST_ASSERT_EQUAL_INT(TOKEN_EOF, next_lexical_token(&lexer).type);
+
+  free_lexer(&lexer);
+}
+
+void test_lexer_converts_number_literals(void) {
+  Lexer lexer;
+  TEST_ASSERT_EQUAL_INT(
+      LEXER_INIT_OK,
+      init_lexer(&lexer, "1.5e3 .25 0x_1 1_000. a.b 1..c 017 12px 0b11"));
+
+  const struct {
+    TokenType type;
+    double value;
+  } expected[] = {{TOKEN_NUMBER, 1500.0},   {TOKEN_NUMBER, 0.25},
+                  {TOKEN_UNKNOWN, 0.0},     {TOKEN_NUMBER, 1000.0},
+                  {TOKEN_IDENTIFIER, 0.0},  {TOKEN_DOT, 0.0},
+                  {TOKEN_IDENTIFIER, 0.0},  {TOKEN_NUMBER, 1.0},
+                  {TOKEN_DOT, 0.0},         {TOKEN_IDENTIFIER, 0.0},
+                  {TOKEN_UNKNOWN, 0.0},     {TOKEN_UNKNOWN, 0.0},
+                  {TOKEN_NUMBER, 3.0},      {TOKEN_EOF, 0.0}};
+
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    LexerToken token = next_lexical_token(&lexer);
+    TEST_ASSERT_EQUAL_INT(expected[i].type, token.type);
+    if (token.type == TOKEN_NUMBER) {
+      TEST_ASSERT_TRUE(lexer_number(&lexer) == expected[i].value);
+    }
+  }
+
+  free_lexer(&lexer);
+}
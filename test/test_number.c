@@ -0,0 +1,148 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/number.h"
+#include "../third_party/Unity/src/unity.h"
+
+static uint64_t double_bits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double parse(const char *text) {
+  double value = -1.0;
+  TEST_ASSERT_EQUAL_INT(1, parse_number_literal(text, strlen(text), &value));
+  return value;
+}
+
+void test_number_parses_every_literal_form(void) {
+  const struct {
+    const char *text;
+    double value;
+  } cases[] = {
+      {"0", 0.0},
+      {"42", 42.0},
+      {"1.5", 1.5},
+      {".5", 0.5},
+      {"1.", 1.0},
+      {"1.e2", 100.0},
+      {"0.000", 0.0},
+      {"6.02e23", 6.02e23},
+      {"1E-3", 1e-3},
+      {"1e+3", 1e3},
+      {"1_000_000", 1e6},
+      {"0.000_1", 1e-4},
+      {"1e1_0", 1e10},
+      {"0x1F", 31.0},
+      {"0XfF", 255.0},
+      {"0b1010", 10.0},
+      {"0B1_1", 3.0},
+      {"0o17", 15.0},
+      {"0O7_7", 63.0},
+      {"0x1_0000_0000_0000_0000", 0x1p64},
+      /* Ties round to even, in every radix. */
+      {"0x20000000000001", 0x1p53},
+      {"0x20000000000003", 0x1p53 + 4},
+      {"0x20000000000001_0", 0x1p57},
+      {"0x20000000000001_1", 0x1p57 + 32},
+      {"9007199254740993", 0x1p53},
+      {"9007199254740995", 0x1p53 + 4},
+      {"9007199254740993.000000000000000000000", 0x1p53},
+      {"9007199254740993.000000000000000000001", 0x1p53 + 2},
+      {"123456789012345678901234567890", 1.2345678901234568e29},
+      /* Limits of the doubles, and past them. */
+      {"1.7976931348623157e308", 0x1.fffffffffffffp1023},
+      {"1.7976931348623158e308", 0x1.fffffffffffffp1023},
+      {"1.7976931348623159e308", HUGE_VAL},
+      {"1e400", HUGE_VAL},
+      {"2.2250738585072014e-308", 0x1p-1022},
+      {"2.2250738585072011e-308", 0x0.fffffffffffffp-1022},
+      {"4.9e-324", 0x1p-1074},
+      {"2.4703282292062328e-324", 0x1p-1074},
+      {"2.4703282292062327e-324", 0.0},
+      {"1e-400", 0.0},
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    TEST_ASSERT_EQUAL_UINT64(double_bits(cases[i].value),
+                             double_bits(parse(cases[i].text)));
+  }
+
+  /* A digit string longer than a double ever needs still rounds by all of
+   * its digits. */
+  char long_literal[1200];
+  memset(long_literal, '0', sizeof(long_literal) - 1);
+  memcpy(long_literal, "9007199254740993", 16);
+  long_literal[sizeof(long_literal) - 1] = '\0';
+  long_literal[16] = '.';
+  TEST_ASSERT_EQUAL_UINT64(double_bits(0x1p53),
+                           double_bits(parse(long_literal)));
+  long_literal[sizeof(long_literal) - 2] = '1';
+  TEST_ASSERT_EQUAL_UINT64(double_bits(0x1p53 + 2),
+                           double_bits(parse(long_literal)));
+
+  /* 2^1024 - 1 rounds up past the largest double. */
+  char hex_literal[2 + 256 + 1] = "0x";
+  memset(hex_literal + 2, 'f', 256);
+  hex_literal[sizeof(hex_literal) - 1] = '\0';
+  TEST_ASSERT_EQUAL_UINT64(double_bits(HUGE_VAL),
+                           double_bits(parse(hex_literal)));
+
+  const char *invalid[] = {"",    "0x",   "0b2",  "0o8",   "1_",   "1__0",
+                           "_1",  "1._5", "1_.5", "1e",    "1e+",  "1e_1",
+                           "017", "0_1",  "12px", "1.2.3", "0x_1", "0x1.5",
+                           ".",   "1n",   ".e1",  "0b",    "1e1_"};
+
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    double value;
+    TEST_ASSERT_EQUAL_INT(
+        0, parse_number_literal(invalid[i], strlen(invalid[i]), &value));
+  }
+}
+
+void test_number_matches_strtod(void) {
+  uint64_t state = 0x2545f4914f6cdd1du;
+  char text[64];
+
+  for (int i = 0; i < 50000; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    /* Up to 25 digits with a point somewhere among them, scaled anywhere
+     * in the range of the doubles. */
+    int digits = 1 + (int)(state % 25);
+    int point = (int)((state >> 8) % (uint64_t)(digits + 1));
+    int exponent = (int)((state >> 16) % 660) - 340;
+    uint64_t random = state;
+    int length = 0;
+
+    text[length++] = (char)('1' + random % 9);
+    for (int d = 1; d < digits; d++) {
+      if (d == point)
+        text[length++] = '.';
+      random = random * 6364136223846793005u + 1442695040888963407u;
+      text[length++] = (char)('0' + (random >> 33) % 10);
+    }
+    length += snprintf(text + length, sizeof(text) - (size_t)length, "e%d",
+                       exponent);
+
+    double value;
+    TEST_ASSERT_EQUAL_INT(1,
+                          parse_number_literal(text, (size_t)length, &value));
+    TEST_ASSERT_EQUAL_UINT64(double_bits(strtod(text, NULL)),
+                             double_bits(value));
+
+    /* Hexadecimal integers of up to 80 bits. */
+    length = snprintf(text, sizeof(text), "0x%llx%04x",
+                      (unsigned long long)state, (unsigned)(random & 0xffff));
+    TEST_ASSERT_EQUAL_INT(1,
+                          parse_number_literal(text, (size_t)length, &value));
+    TEST_ASSERT_EQUAL_UINT64(double_bits(strtod(text, NULL)),
+                             double_bits(value));
+  }
+}
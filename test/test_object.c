@@ -0,0 +1,176 @@
+#include "../include/object.h"
+#include "../third_party/Unity/src/unity.h"
+
+void test_object_shares_shapes_by_insertion_order(void) {
+  Heap heap;
+  init_heap(&heap);
+
+  Object *a = heap_new_object(&heap);
+  Object *b = heap_new_object(&heap);
+  Object *c = heap_new_object(&heap);
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_NOT_NULL(c);
+  TEST_ASSERT_TRUE(a->shape == b->shape);
+
+  /* {x, y} twice, then {y, x}. */
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, a, 0, value_number(1), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, a, 1, value_number(2), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, b, 0, value_number(3), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, b, 1, value_number(4), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, c, 1, value_number(5), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, c, 0, value_number(6), NULL));
+
+  TEST_ASSERT_TRUE(a->shape == b->shape);
+  TEST_ASSERT_TRUE(a->shape != c->shape);
+  TEST_ASSERT_EQUAL_UINT32(2, a->shape->slot_count);
+  TEST_ASSERT_EQUAL_size_t(5, heap.shape_count);
+
+  TEST_ASSERT_EQUAL_UINT32(0, shape_find_slot(a->shape, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, shape_find_slot(c->shape, 0));
+  TEST_ASSERT_EQUAL_UINT32(SHAPE_NO_SLOT, shape_find_slot(a->shape, 2));
+
+  /* Overwriting a property keeps the shape. */
+  Shape *shape = a->shape;
+  uint32_t slot = SHAPE_NO_SLOT;
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, a, 1, value_number(7), &slot));
+  TEST_ASSERT_EQUAL_UINT32(1, slot);
+  TEST_ASSERT_TRUE(a->shape == shape);
+
+  TEST_ASSERT_TRUE(value_as_number(object_get(a, 1)) == 7.0);
+  TEST_ASSERT_TRUE(value_as_number(object_get(b, 0)) == 3.0);
+  TEST_ASSERT_TRUE(value_as_number(object_get(c, 0)) == 6.0);
+  TEST_ASSERT_TRUE(value_is_undefined(object_get(c, 2)));
+
+  /* Shapes outlive the objects, so a new object finds them again. */
+  heap_free_objects(&heap);
+  TEST_ASSERT_EQUAL_size_t(0, heap.nursery_used);
+
+  Object *d = heap_new_object(&heap);
+  TEST_ASSERT_NOT_NULL(d);
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, d, 0, value_number(8), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, d, 1, value_number(9), NULL));
+  TEST_ASSERT_TRUE(d->shape == shape);
+  TEST_ASSERT_EQUAL_size_t(5, heap.shape_count);
+
+  free_heap(&heap);
+}
+
+void test_object_grows_its_slots(void) {
+  Heap heap;
+  init_heap(&heap);
+
+  Object *object = heap_new_object(&heap);
+  TEST_ASSERT_NOT_NULL(object);
+
+  for (uint32_t name = 0; name < 100; name++) {
+    TEST_ASSERT_EQUAL_INT(
+        1, object_set(&heap, object, name, value_number(name), NULL));
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(100, object->shape->slot_count);
+  TEST_ASSERT_TRUE(object->capacity >= 100);
+
+  for (uint32_t name = 0; name < 100; name++) {
+    TEST_ASSERT_TRUE(value_as_number(object_get(object, name)) == name);
+  }
+
+  free_heap(&heap);
+}
+
+void test_object_survives_collections_when_reachable(void) {
+  Heap heap;
+  init_heap(&heap);
+
+  Value roots[2] = {value_undefined(), value_undefined()};
+  heap.roots = roots;
+  heap.root_count = 2;
+
+  Object *parent = heap_new_object(&heap);
+  roots[0] = value_object(parent);
+  Object *child = heap_new_object(&heap);
+  TEST_ASSERT_EQUAL_INT(
+      1, object_set(&heap, parent, 0, value_object(child), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, child, 1, value_number(42), NULL));
+  roots[1] = value_object(heap_new_object(&heap));
+  roots[1] = value_undefined();
+
+  /* The unreachable object stays behind in the nursery. */
+  TEST_ASSERT_EQUAL_INT(1, heap_collect(&heap, false));
+  TEST_ASSERT_EQUAL_UINT64(1, heap.stats.minor_collections);
+  TEST_ASSERT_EQUAL_size_t(0, heap.nursery_used);
+  TEST_ASSERT_EQUAL_size_t(2, heap.old.count);
+
+  parent = (Object *)value_as_object(roots[0]);
+  TEST_ASSERT_EQUAL_UINT8(OBJECT_OLD, parent->generation);
+  child = (Object *)value_as_object(object_get(parent, 0));
+  TEST_ASSERT_EQUAL_UINT8(OBJECT_OLD, child->generation);
+  TEST_ASSERT_TRUE(value_as_number(object_get(child, 1)) == 42.0);
+
+  /* A young object stored into an old one is found through the remembered
+   * set. */
+  Object *young = heap_new_object(&heap);
+  TEST_ASSERT_EQUAL_INT(
+      1, object_set(&heap, parent, 2, value_object(young), NULL));
+  TEST_ASSERT_EQUAL_INT(1, object_set(&heap, young, 0, value_number(7), NULL));
+  TEST_ASSERT_TRUE(parent->remembered);
+  TEST_ASSERT_EQUAL_size_t(1, heap.remembered.count);
+
+  TEST_ASSERT_EQUAL_INT(1, heap_collect(&heap, false));
+  TEST_ASSERT_EQUAL_size_t(0, heap.remembered.count);
+  TEST_ASSERT_FALSE(parent->remembered);
+  TEST_ASSERT_EQUAL_size_t(3, heap.old.count);
+  young = (Object *)value_as_object(object_get(parent, 2));
+  TEST_ASSERT_EQUAL_UINT8(OBJECT_OLD, young->generation);
+  TEST_ASSERT_TRUE(value_as_number(object_get(young, 0)) == 7.0);
+
+  /* Old objects are only freed by a major collection. */
+  roots[0] = value_undefined();
+  TEST_ASSERT_EQUAL_INT(1, heap_collect(&heap, false));
+  TEST_ASSERT_EQUAL_size_t(3, heap.old.count);
+  TEST_ASSERT_EQUAL_INT(1, heap_collect(&heap, true));
+  TEST_ASSERT_EQUAL_UINT64(1, heap.stats.major_collections);
+  TEST_ASSERT_EQUAL_size_t(0, heap.old.count);
+  TEST_ASSERT_EQUAL_size_t(0, heap.old_bytes);
+
+  free_heap(&heap);
+}
+
+void test_object_collects_the_nursery_when_full(void) {
+  Heap heap;
+  init_heap(&heap);
+  heap.nursery_size = 64 * sizeof(Object);
+
+  Value roots[1] = {value_undefined()};
+  heap.roots = roots;
+  heap.root_count = 1;
+
+  /* Every tenth object is chained to the root, the others are garbage. */
+  for (int i = 0; i < 1000; i++) {
+    Object *object = heap_new_object(&heap);
+    TEST_ASSERT_NOT_NULL(object);
+
+    if (i % 10 == 0) {
+      TEST_ASSERT_EQUAL_INT(1, object_set(&heap, object, 0, roots[0], NULL));
+      TEST_ASSERT_EQUAL_INT(
+          1, object_set(&heap, object, 1, value_number(i), NULL));
+      roots[0] = value_object(object);
+    }
+  }
+
+  TEST_ASSERT_TRUE(heap.stats.minor_collections > 10);
+  TEST_ASSERT_TRUE(heap.old.count < 100);
+  TEST_ASSERT_TRUE(heap.stats.bytes_allocated >= 1000 * sizeof(Object));
+  TEST_ASSERT_TRUE(heap.stats.max_pause_seconds <= heap.stats.pause_seconds);
+
+  int count = 0;
+  for (Value link = roots[0]; !value_is_undefined(link); count++) {
+    const Object *object = (const Object *)value_as_object(link);
+    TEST_ASSERT_TRUE(value_as_number(object_get(object, 1)) ==
+                     990.0 - 10.0 * count);
+    link = object_get(object, 0);
+  }
+  TEST_ASSERT_EQUAL_INT(100, count);
+
+  free_heap(&heap);
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/resolver.h"
+#include "../third_party/Unity/src/unity.h"
+
+/*
+ * Collects the identifiers of a tree in source order, skipping function
+ * parameters.
+ */
+static void collect_identifiers(ASTNode *node, ASTNode **found, size_t *count) {
+  if (node->type == NODE_IDENTIFIER) {
+    found[(*count)++] = node;
+    return;
+  }
+
+  size_t first = node->type == NODE_FUNCTION_DECLARATION
+                     ? node->children_count - 1
+                     : 0;
+  for (size_t i = first; i < node->children_count; i++) {
+    collect_identifiers(&node->children[i], found, count);
+  }
+}
+
+/*
+ * Asserts where an identifier was resolved to.
+ */
+static void assert_resolved(const ASTNode *identifier, const char *name,
+                            uint32_t depth, uint32_t slot) {
+  TEST_ASSERT_EQUAL_STRING(name, identifier->data.identifier.value);
+  TEST_ASSERT_EQUAL_UINT32(depth, identifier->data.identifier.depth);
+  if (depth != AST_SCOPE_GLOBAL)
+    TEST_ASSERT_EQUAL_UINT32(slot, identifier->data.identifier.slot);
+}
+
+void test_resolver_assigns_slots_and_depths(void) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(
+      AST_INIT_OK,
+      init_ast(&ast, "let a = 1;\n"
+                     "function f(x, y) {\n"
+                     "  let z = x + a;\n"
+                     "  function g(w) { let v = w + z + y + a + h; }\n"
+                     "  z = q;\n"
+                     "}\n"
+                     "const c = f;\n"
+                     "let h = c;"));
+
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_size_t(4, program->children_count);
+  TEST_ASSERT_FALSE(program->data.scope.resolved);
+  TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+  TEST_ASSERT_TRUE(program->data.scope.resolved);
+
+  /* a, f, c and h, in source order. */
+  TEST_ASSERT_EQUAL_UINT32(4, program->data.scope.slot_count);
+  TEST_ASSERT_EQUAL_UINT32(2, program->children[2].data.declaration.slot);
+  TEST_ASSERT_TRUE(program->children[2].data.declaration.constant);
+
+  /* Parameters first, then z and g. */
+  ASTNode *f = &program->children[1];
+  TEST_ASSERT_EQUAL_UINT32(1, f->data.function.slot);
+  TEST_ASSERT_EQUAL_UINT32(4, f->data.function.slot_count);
+  TEST_ASSERT_EQUAL_UINT32(1, f->children[1].data.identifier.slot);
+
+  ASTNode *g = &f->children[2].children[1];
+  TEST_ASSERT_EQUAL_UINT32(3, g->data.function.slot);
+  TEST_ASSERT_EQUAL_UINT32(2, g->data.function.slot_count);
+
+  ASTNode *found[16];
+  size_t count = 0;
+  collect_identifiers(program, found, &count);
+  TEST_ASSERT_EQUAL_size_t(11, count);
+
+  assert_resolved(found[0], "x", 0, 0);
+  assert_resolved(found[1], "a", 1, 0);
+  assert_resolved(found[2], "w", 0, 0);
+  assert_resolved(found[3], "z", 1, 2);
+  assert_resolved(found[4], "y", 1, 1);
+  assert_resolved(found[5], "a", 2, 0);
+  /* Declarations are visible in their whole function. */
+  assert_resolved(found[6], "h", 2, 3);
+  assert_resolved(found[7], "z", 0, 2);
+  assert_resolved(found[8], "q", AST_SCOPE_GLOBAL, 0);
+  assert_resolved(found[9], "f", 0, 1);
+  assert_resolved(found[10], "c", 0, 2);
+
+  free_ast(&ast);
+}
+
+void test_resolver_rejects_redeclarations_and_constant_assignments(void) {
+  const struct {
+    const char *text;
+    ResolveError error;
+  } cases[] = {
+      {"let a; let a = 1;", RESOLVE_ERROR_REDECLARED},
+      {"let f; function f() { }", RESOLVE_ERROR_REDECLARED},
+      {"function f(a, a) { }", RESOLVE_ERROR_REDECLARED},
+      {"function f(a) { let a; }", RESOLVE_ERROR_REDECLARED},
+      {"const k = 1; k = 2;", RESOLVE_ERROR_CONSTANT},
+      {"const k = 1; function f() { k = 2; }", RESOLVE_ERROR_CONSTANT},
+      {"const k = 1; function f() { let k; k = 2; }", RESOLVE_OK},
+      {"let a; function f() { let a = 1; }", RESOLVE_OK},
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    AST ast;
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, cases[i].text));
+    ASTNode *program = ast_parse_program(&ast);
+    TEST_ASSERT_EQUAL_INT(cases[i].error, resolve_program(program));
+    TEST_ASSERT_EQUAL_INT(cases[i].error == RESOLVE_OK,
+                          program->data.scope.resolved);
+    free_ast(&ast);
+  }
+
+  /* A constant needs a value. */
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, "const k; let a;"));
+  TEST_ASSERT_EQUAL_size_t(1, ast_parse_program(&ast)->children_count);
+  TEST_ASSERT_EQUAL_size_t(1, ast.diagnostics.count);
+  TEST_ASSERT_EQUAL_INT(DIAGNOSTIC_MISSING_INITIALIZER,
+                        ast.diagnostics.items[0].code);
+  free_ast(&ast);
+}
+
+void test_resolver_resolves_lazy_bodies_and_deep_trees(void) {
+  Source source;
+  init_source_string(&source, "let a = 1; function f(x) { let b = x + a; }");
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast_tokens(&ast, &source, NULL));
+  ast.lazy_functions = true;
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+
+  ASTNode *f = &program->children[1];
+  TEST_ASSERT_EQUAL_UINT32(1, f->data.function.slot);
+  TEST_ASSERT_FALSE(f->children[1].data.body.parsed);
+
+  TEST_ASSERT_EQUAL_INT(AST_BODY_OK, ast_parse_function_body(&ast, f));
+  TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_function(program, f));
+  TEST_ASSERT_EQUAL_UINT32(2, f->data.function.slot_count);
+
+  ASTNode *found[4];
+  size_t count = 0;
+  collect_identifiers(f, found, &count);
+  TEST_ASSERT_EQUAL_size_t(2, count);
+  assert_resolved(found[0], "x", 0, 0);
+  assert_resolved(found[1], "a", 1, 0);
+
+  free_ast(&ast);
+
+  /* Deep enough to overflow the call stack of a recursive walk. */
+  const int depth = 200000;
+  char *text = malloc((size_t)depth * 4 + 64);
+  TEST_ASSERT_NOT_NULL(text);
+
+  size_t length = (size_t)sprintf(text, "let x; ");
+  for (int i = 0; i < depth; i++) {
+    memcpy(text + length, "x = ", 4);
+    length += 4;
+  }
+  strcpy(text + length, "x;");
+
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, text));
+  program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+
+  ASTNode *value = &program->children[1].children[0];
+  while (value->type == NODE_ASSIGNMENT_EXPRESSION) {
+    value = &value->children[1];
+  }
+  assert_resolved(value, "x", 0, 0);
+
+  free_ast(&ast);
+  free(text);
+}
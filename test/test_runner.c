@@ -3,11 +3,131 @@
 void test_tokenizer_basic(void);
 void test_tokenizer_basic_let_without_spaces(void);
 void test_tokenizer_with_numbers_in_variables(void);
+void test_tokenizer_spans_point_into_source(void);
+void test_tokenizer_long_runs(void);
+void test_tokenizer_is_delimited_by_length(void);
+void test_tokenizer_stream_matches_contiguous_source(void);
+void test_tokenizer_stream_reports_failed_window(void);
+void test_tokenizer_reads_mapped_file(void);
+void test_tokenizer_reads_unmappable_file(void);
+void test_lexer_token_is_compact(void);
+void test_lexer_long_identifier_is_not_truncated(void);
+void test_lexer_recognizes_every_keyword(void);
+void test_lexer_keyword_lookalikes_are_identifiers(void);
+void test_lexer_converts_number_literals(void);
+void test_number_parses_every_literal_form(void);
+void test_number_matches_strtod(void);
+void test_atom_table_interns_each_name_once(void);
+void test_lexer_interns_identifiers(void);
+void test_token_array_parallel_matches_sequential(void);
+void test_token_array_parallel_rejects_streams(void);
+void test_token_cursor_peeks_and_rewinds(void);
+void test_token_array_relexes_only_edited_tokens(void);
+void test_line_index_locates_offsets(void);
+void test_diagnostic_list_keeps_every_error(void);
+void test_ast_parses_declarations_into_arena(void);
+void test_ast_program_children_are_contiguous(void);
+void test_ast_parses_streamed_source(void);
+void test_ast_reports_failed_stream_window(void);
+void test_ast_reports_token_too_long(void);
+void test_ast_parses_addition_chains(void);
+void test_ast_parses_operators_by_precedence(void);
+void test_ast_parses_objects_and_members(void);
+void test_ast_parses_deep_expressions_iteratively(void);
+void test_ast_folds_literals_while_parsing(void);
+void test_ast_shares_interned_names(void);
+void test_ast_parses_token_array(void);
+void test_ast_reports_every_error_with_its_location(void);
+void test_ast_reports_unsupported_statements(void);
+void test_ast_preparses_function_bodies(void);
+void test_ast_limits_function_nesting(void);
+void test_ast_reparses_edits_like_a_full_parse(void);
+void test_resolver_assigns_slots_and_depths(void);
+void test_resolver_rejects_redeclarations_and_constant_assignments(void);
+void test_resolver_resolves_lazy_bodies_and_deep_trees(void);
+void test_value_is_boxed_in_64_bits(void);
+void test_value_round_trips_numbers(void);
+void test_value_distinguishes_singletons_and_objects(void);
+void test_value_adds_without_allocating(void);
+void test_object_shares_shapes_by_insertion_order(void);
+void test_object_grows_its_slots(void);
+void test_object_survives_collections_when_reachable(void);
+void test_object_collects_the_nursery_when_full(void);
+void test_vm_adds_numbers_and_variables(void);
+void test_vm_converts_primitives_to_numbers(void);
+void test_vm_runs_arithmetic_and_assignments(void);
+void test_vm_caches_property_accesses(void);
+void test_vm_rejects_properties_of_undefined(void);
+void test_vm_collects_garbage_while_running(void);
+void test_compiler_rejects_unknown_variables(void);
+void test_batch_parses_files_in_input_order(void);
+void test_cache_round_trips_tree_and_bytecode(void);
+void test_cache_rejects_forged_files(void);
 
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_tokenizer_basic);
   RUN_TEST(test_tokenizer_basic_let_without_spaces);
   RUN_TEST(test_tokenizer_with_numbers_in_variables);
+  RUN_TEST(test_tokenizer_spans_point_into_source);
+  RUN_TEST(test_tokenizer_long_runs);
+  RUN_TEST(test_tokenizer_is_delimited_by_length);
+  RUN_TEST(test_tokenizer_stream_matches_contiguous_source);
+  RUN_TEST(test_tokenizer_stream_reports_failed_window);
+  RUN_TEST(test_tokenizer_reads_mapped_file);
+  RUN_TEST(test_tokenizer_reads_unmappable_file);
+  RUN_TEST(test_lexer_token_is_compact);
+  RUN_TEST(test_lexer_long_identifier_is_not_truncated);
+  RUN_TEST(test_lexer_recognizes_every_keyword);
+  RUN_TEST(test_lexer_keyword_lookalikes_are_identifiers);
+  RUN_TEST(test_lexer_converts_number_literals);
+  RUN_TEST(test_number_parses_every_literal_form);
+  RUN_TEST(test_number_matches_strtod);
+  RUN_TEST(test_atom_table_interns_each_name_once);
+  RUN_TEST(test_lexer_interns_identifiers);
+  RUN_TEST(test_token_array_parallel_matches_sequential);
+  RUN_TEST(test_token_array_parallel_rejects_streams);
+  RUN_TEST(test_token_cursor_peeks_and_rewinds);
+  RUN_TEST(test_token_array_relexes_only_edited_tokens);
+  RUN_TEST(test_line_index_locates_offsets);
+  RUN_TEST(test_diagnostic_list_keeps_every_error);
+  RUN_TEST(test_ast_parses_declarations_into_arena);
+  RUN_TEST(test_ast_program_children_are_contiguous);
+  RUN_TEST(test_ast_parses_streamed_source);
+  RUN_TEST(test_ast_reports_failed_stream_window);
+  RUN_TEST(test_ast_reports_token_too_long);
+  RUN_TEST(test_ast_parses_addition_chains);
+  RUN_TEST(test_ast_parses_operators_by_precedence);
+  RUN_TEST(test_ast_parses_objects_and_members);
+  RUN_TEST(test_ast_parses_deep_expressions_iteratively);
+  RUN_TEST(test_ast_folds_literals_while_parsing);
+  RUN_TEST(test_ast_shares_interned_names);
+  RUN_TEST(test_ast_parses_token_array);
+  RUN_TEST(test_ast_reports_every_error_with_its_location);
+  RUN_TEST(test_ast_reports_unsupported_statements);
+  RUN_TEST(test_ast_preparses_function_bodies);
+  RUN_TEST(test_ast_limits_function_nesting);
+  RUN_TEST(test_ast_reparses_edits_like_a_full_parse);
+  RUN_TEST(test_resolver_assigns_slots_and_depths);
+  RUN_TEST(test_resolver_rejects_redeclarations_and_constant_assignments);
+  RUN_TEST(test_resolver_resolves_lazy_bodies_and_deep_trees);
+  RUN_TEST(test_value_is_boxed_in_64_bits);
+  RUN_TEST(test_value_round_trips_numbers);
+  RUN_TEST(test_value_distinguishes_singletons_and_objects);
+  RUN_TEST(test_value_adds_without_allocating);
+  RUN_TEST(test_object_shares_shapes_by_insertion_order);
+  RUN_TEST(test_object_grows_its_slots);
+  RUN_TEST(test_object_survives_collections_when_reachable);
+  RUN_TEST(test_object_collects_the_nursery_when_full);
+  RUN_TEST(test_vm_adds_numbers_and_variables);
+  RUN_TEST(test_vm_converts_primitives_to_numbers);
+  RUN_TEST(test_vm_runs_arithmetic_and_assignments);
+  RUN_TEST(test_vm_caches_property_accesses);
+  RUN_TEST(test_vm_rejects_properties_of_undefined);
+  RUN_TEST(test_vm_collects_garbage_while_running);
+  RUN_TEST(test_compiler_rejects_unknown_variables);
+  RUN_TEST(test_batch_parses_files_in_input_order);
+  RUN_TEST(test_cache_round_trips_tree_and_bytecode);
+  RUN_TEST(test_cache_rejects_forged_files);
   return UNITY_END();
 }
@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/token_array.h"
+#include "../third_party/Unity/src/unity.h"
+
+#define TOKEN_ARRAY_TEST_LENGTH 20000
+
+/*
+ * Helper function filling a buffer with pseudo-random tokens. Delimiters are
+ * rare, so that most splits fall in the middle of a token.
+ */
+static void fill_random_source(char *text, size_t length) {
+  static const char alphabet[] = "abcxyz_$0123456789+=#";
+  uint64_t state = 0x9e3779b97f4a7c15u;
+
+  for (size_t i = 0; i < length; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    unsigned roll = (unsigned)(state % 64);
+    if (roll == 0) {
+      text[i] = ' ';
+    } else if (roll == 1) {
+      text[i] = ';';
+    } else if (roll == 2) {
+      text[i] = '\n';
+    } else {
+      text[i] = alphabet[roll % (sizeof(alphabet) - 1)];
+    }
+  }
+}
+
+void test_token_array_parallel_matches_sequential(void) {
+  char *text = (char *)malloc(TOKEN_ARRAY_TEST_LENGTH);
+  TEST_ASSERT_NOT_NULL(text);
+  fill_random_source(text, TOKEN_ARRAY_TEST_LENGTH);
+
+  Source source;
+  init_source_buffer(&source, text, TOKEN_ARRAY_TEST_LENGTH);
+
+  AtomTable expected_atoms;
+  init_atom_table(&expected_atoms);
+  TokenArray expected;
+  init_token_array(&expected);
+  TEST_ASSERT_EQUAL_INT(TOKEN_ARRAY_OK,
+                        lex_token_array(&source, &expected_atoms, &expected));
+  TEST_ASSERT_EQUAL_INT(TOKEN_EOF, expected.types[expected.count - 1]);
+
+  static const unsigned thread_counts[] = {2, 3, 7, 16, 61};
+
+  for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]);
+       t++) {
+    ParallelLexOptions options = {.threads = thread_counts[t],
+                                  .chunk_size = 16};
+    AtomTable atoms;
+    init_atom_table(&atoms);
+    TokenArray tokens;
+    init_token_array(&tokens);
+
+    TEST_ASSERT_EQUAL_INT(
+        TOKEN_ARRAY_OK,
+        lex_token_array_parallel(&source, &atoms, &options, &tokens));
+
+    TEST_ASSERT_EQUAL_size_t(expected.count, tokens.count);
+    TEST_ASSERT_EQUAL_UINT32(expected_atoms.count, atoms.count);
+
+    TEST_ASSERT_EQUAL_MEMORY(expected.types, tokens.types, expected.count);
+    TEST_ASSERT_EQUAL_MEMORY(expected.offsets, tokens.offsets,
+                             expected.count * sizeof(size_t));
+    TEST_ASSERT_EQUAL_MEMORY(expected.lengths, tokens.lengths,
+                             expected.count * sizeof(size_t));
+    TEST_ASSERT_EQUAL_MEMORY(expected.payloads, tokens.payloads,
+                             expected.count * sizeof(uint32_t));
+
+    free_token_array(&tokens);
+    free_atom_table(&atoms);
+  }
+
+  free_token_array(&expected);
+  free_atom_table(&expected_atoms);
+  free(text);
+}
+
+static size_t read_nothing(void *context, char *buffer, size_t capacity) {
+  (void)context;
+  (void)buffer;
+  (void)capacity;
+  return 0;
+}
+
+void test_token_array_parallel_rejects_streams(void) {
+  Source source;
+  init_source_stream(&source, read_nothing, NULL, 64);
+
+  TokenArray tokens;
+  init_token_array(&tokens);
+
+  TEST_ASSERT_EQUAL_INT(TOKEN_ARRAY_ERROR_SOURCE,
+                        lex_token_array_parallel(&source, NULL, NULL, &tokens));
+  TEST_ASSERT_EQUAL_size_t(0, tokens.count);
+}
+
+void test_token_cursor_peeks_and_rewinds(void) {
+  Source source;
+  init_source_string(&source, "let a = b;");
+
+  TokenArray tokens;
+  init_token_array(&tokens);
+  TEST_ASSERT_EQUAL_INT(TOKEN_ARRAY_OK,
+                        lex_token_array(&source, NULL, &tokens));
+  TEST_ASSERT_EQUAL_size_t(5, tokens.count);
+
+  TokenCursor cursor = {.array = &tokens, .index = 0};
+  TEST_ASSERT_EQUAL_INT(TOKEN_EQUAL, token_cursor_peek(&cursor, 2).type);
+  TEST_ASSERT_EQUAL_INT(TOKEN_EOF, token_cursor_peek(&cursor, 100).type);
+
+  TEST_ASSERT_EQUAL_INT(TOKEN_LET, token_cursor_next(&cursor).type);
+  size_t mark = cursor.index;
+  TEST_ASSERT_EQUAL_INT(TOKEN_IDENTIFIER, token_cursor_next(&cursor).type);
+  TEST_ASSERT_EQUAL_INT(TOKEN_EQUAL, token_cursor_next(&cursor).type);
+
+  token_cursor_rewind(&cursor, mark);
+  LexerToken name = token_cursor_next(&cursor);
+  TEST_ASSERT_EQUAL_INT(4, name.offset);
+  TEST_ASSERT_EQUAL_INT(1, name.length);
+
+  for (int i = 0; i < 4; i++) {
+    token_cursor_next(&cursor);
+  }
+  TEST_ASSERT_EQUAL_INT(TOKEN_EOF, token_cursor_next(&cursor).type);
+
+  free_token_array(&tokens);
+}
+
+void test_token_array_relexes_only_edited_tokens(void) {
+  const char *before = "let alpha = 1; let beta = alpha + 2;";
+  const char *after = "let alpha = 1; let gamma = alpha + 2;";
+
+  Source source;
+  init_source_string(&source, before);
+  TokenArray tokens;
+  init_token_array(&tokens);
+  TEST_ASSERT_EQUAL_INT(TOKEN_ARRAY_OK,
+                        lex_token_array(&source, NULL, &tokens));
+
+  /* "beta" becomes "gamma". */
+  SourceEdit edit = {.offset = 19, .removed = 4, .inserted = 5};
+  init_source_string(&source, after);
+  TokenArrayChange change;
+  TEST_ASSERT_EQUAL_INT(
+      TOKEN_ARRAY_OK,
+      relex_token_array(&source, NULL, &edit, &tokens, &change));
+
+  TEST_ASSERT_EQUAL_size_t(5, change.first);
+  TEST_ASSERT_EQUAL_size_t(6, change.old_end);
+  TEST_ASSERT_EQUAL_size_t(6, change.new_end);
+
+  TokenArray expected;
+  init_token_array(&expected);
+  TEST_ASSERT_EQUAL_INT(TOKEN_ARRAY_OK,
+                        lex_token_array(&source, NULL, &expected));
+  TEST_ASSERT_EQUAL_size_t(expected.count, tokens.count);
+  TEST_ASSERT_EQUAL_MEMORY(expected.types, tokens.types, expected.count);
+  TEST_ASSERT_EQUAL_MEMORY(expected.offsets, tokens.offsets,
+                           expected.count * sizeof(size_t));
+  TEST_ASSERT_EQUAL_MEMORY(expected.lengths, tokens.lengths,
+                           expected.count * sizeof(size_t));
+
+  free_token_array(&expected);
+  free_token_array(&tokens);
+}
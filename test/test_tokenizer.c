@@ -1,4 +1,9 @@
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "../include/tokenizer.h"
 #include "../third_party/Unity/src/unity.h"
@@ -18,14 +23,12 @@ void test_tokenizer_basic(void) {
 
   unsigned int token_count = 0;
 
-  const char *token;
+  TokenSpan token;
   do {
     token = next_token(tokenizer);
 
-    free((void *)token);
-
     token_count++;
-  } while (token);
+  } while (token.length > 0);
 
   free(tokenizer);
 
@@ -44,14 +47,12 @@ void test_tokenizer_basic_let_without_spaces(void) {
 
   unsigned int token_count = 0;
 
-  const char *token;
+  TokenSpan token;
   do {
     token = next_token(tokenizer);
 
-    free((void *)token);
-
     token_count++;
-  } while (token);
+  } while (token.length > 0);
 
   free(tokenizer);
 
@@ -70,16 +71,245 @@ void test_tokenizer_with_numbers_in_variables(void) {
 
   unsigned int token_count = 0;
 
-  const char *token;
+  TokenSpan token;
   do {
     token = next_token(tokenizer);
 
-    free((void *)token);
-
     token_count++;
-  } while (token);
+  } while (token.length > 0);
 
   free(tokenizer);
 
   TEST_ASSERT_EQUAL_INT(5, token_count);
 }
+
+void test_tokenizer_spans_point_into_source(void) {
+  Tokenizer tokenizer;
+  const char *source = "let answer = 42;";
+
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK, init_tokenizer(&tokenizer, source));
+
+  TokenSpan token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_INT(0, token.offset);
+  TEST_ASSERT_EQUAL_INT(3, token.length);
+
+  token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_INT(4, token.offset);
+  TEST_ASSERT_EQUAL_INT(6, token.length);
+  TEST_ASSERT_EQUAL_STRING_LEN("answer", source + token.offset, token.length);
+}
+
+void test_tokenizer_long_runs(void) {
+  Tokenizer tokenizer;
+  const char *source =
+      "                                        let\t\t\t\t\t\t\t\t\t\t\t\t"
+      "an_identifier_that_is_longer_than_a_vector$1 = "
+      "12345678901234567890123456789012345678901234567890;";
+
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK, init_tokenizer(&tokenizer, source));
+
+  TokenSpan token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_INT(40, token.offset);
+  TEST_ASSERT_EQUAL_INT(3, token.length);
+
+  token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_INT(55, token.offset);
+  TEST_ASSERT_EQUAL_INT(44, token.length);
+
+  token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_INT(1, token.length);
+
+  token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_INT(50, token.length);
+
+  token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_INT(0, token.length);
+}
+
+void test_tokenizer_is_delimited_by_length(void) {
+  /* NUL bytes are ordinary characters, and the bytes after the length are
+   * never read. */
+  const char data[] = "let\0a = 1;\0let";
+  Source source;
+  init_source_buffer(&source, data, sizeof(data) - 4);
+
+  Tokenizer tokenizer;
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK,
+                        init_tokenizer_source(&tokenizer, &source));
+
+  const size_t expected[][2] = {{0, 3}, {3, 1}, {4, 1}, {6, 1}, {8, 1},
+                                {10, 1}};
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    TokenSpan token = next_token(&tokenizer);
+    TEST_ASSERT_EQUAL_size_t(expected[i][0], token.offset);
+    TEST_ASSERT_EQUAL_size_t(expected[i][1], token.length);
+  }
+
+  TEST_ASSERT_EQUAL_size_t(0, next_token(&tokenizer).length);
+
+#if SIZE_MAX > UINT32_MAX
+  /* Offsets past 4 GiB are kept whole. Only the last page of the mapping is
+   * touched, so it costs no memory. */
+  size_t length = ((size_t)5 << 30) + 3;
+  char *large = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (large == MAP_FAILED)
+    return;
+
+  memcpy(large + length - 16, "        answer;\0", 16);
+  init_source_buffer(&source, large, length);
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK,
+                        init_tokenizer_source(&tokenizer, &source));
+  tokenizer.position = length - 16;
+
+  TokenSpan token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_size_t(length - 8, token.offset);
+  TEST_ASSERT_EQUAL_STRING_LEN("answer", tokenizer_span_text(&tokenizer, token),
+                               token.length);
+
+  token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_size_t(length - 1, token.offset);
+  TEST_ASSERT_EQUAL_size_t(1, token.length);
+  TEST_ASSERT_EQUAL_size_t(0, next_token(&tokenizer).length);
+
+  munmap(large, length);
+#endif
+}
+
+typedef struct {
+  const char *data;
+  size_t remaining;
+} StringReader;
+
+static size_t read_string(void *context, char *buffer, size_t capacity) {
+  StringReader *reader = (StringReader *)context;
+  size_t count = reader->remaining < capacity ? reader->remaining : capacity;
+
+  memcpy(buffer, reader->data, count);
+  reader->data += count;
+  reader->remaining -= count;
+
+  return count;
+}
+
+void test_tokenizer_stream_matches_contiguous_source(void) {
+  const char *source = "let first_long_identifier = 1234567; let b\t=\n"
+                       "first_long_identifier + 42 + 1.5e+3 + .25e1_0 + "
+                       "0x_ff + 1_000. + 1..c;";
+
+  for (size_t chunk_size = 1; chunk_size <= 16; chunk_size++) {
+    Tokenizer contiguous;
+    TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK,
+                          init_tokenizer(&contiguous, source));
+
+    StringReader reader = {.data = source, .remaining = strlen(source)};
+    Source stream;
+    init_source_stream(&stream, read_string, &reader, chunk_size);
+
+    Tokenizer streaming;
+    TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK,
+                          init_tokenizer_source(&streaming, &stream));
+
+    TokenSpan expected;
+    do {
+      expected = next_token(&contiguous);
+      TokenSpan actual = next_token(&streaming);
+
+      TEST_ASSERT_EQUAL_INT(expected.offset, actual.offset);
+      TEST_ASSERT_EQUAL_INT(expected.length, actual.length);
+      TEST_ASSERT_EQUAL_STRING_LEN(tokenizer_span_text(&contiguous, expected),
+                                   tokenizer_span_text(&streaming, actual),
+                                   expected.length);
+    } while (expected.length > 0);
+
+    free_tokenizer(&streaming);
+  }
+}
+
+void test_tokenizer_stream_reports_failed_window(void) {
+  const char *source = "let alpha = 1;";
+  StringReader reader = {.data = source, .remaining = strlen(source)};
+  Source stream;
+  init_source_stream(&stream, read_string, &reader, 6);
+
+  Tokenizer tokenizer;
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK,
+                        init_tokenizer_source(&tokenizer, &stream));
+
+  TokenSpan span = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_size_t(3, span.length);
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_OK, tokenizer.error);
+
+  /* A window too large to allocate stands in for a failed realloc: the
+   * tokens stop there instead of returning the "al" read so far. */
+  tokenizer.chunk_size = SIZE_MAX;
+  span = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_size_t(0, span.length);
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_ERROR_MEMORY_ALLOCATION, tokenizer.error);
+  TEST_ASSERT_EQUAL_size_t(0, next_token(&tokenizer).length);
+
+  free_tokenizer(&tokenizer);
+}
+
+void test_tokenizer_reads_mapped_file(void) {
+  char path[] = "/tmp/cijs_test_XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+
+  const char *contents = "let mapped = 7;";
+  TEST_ASSERT_EQUAL_INT((int)strlen(contents),
+                        (int)write(fd, contents, strlen(contents)));
+  close(fd);
+
+  Source source;
+  TEST_ASSERT_EQUAL_INT(SOURCE_OPEN_OK, open_source_file(&source, path));
+  TEST_ASSERT_EQUAL_INT(SOURCE_MAPPED, source.kind);
+
+  Tokenizer tokenizer;
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK,
+                        init_tokenizer_source(&tokenizer, &source));
+
+  unsigned int token_count = 0;
+  TokenSpan token;
+  do {
+    token = next_token(&tokenizer);
+    token_count++;
+  } while (token.length > 0);
+
+  TEST_ASSERT_EQUAL_INT(5, token_count);
+
+  free_tokenizer(&tokenizer);
+  free_source(&source);
+  unlink(path);
+}
+
+void test_tokenizer_reads_unmappable_file(void) {
+  int fds[2];
+  TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+
+  const char *contents = "let piped = 7;";
+  TEST_ASSERT_EQUAL_INT((int)strlen(contents),
+                        (int)write(fds[1], contents, strlen(contents)));
+  close(fds[1]);
+
+  char path[64];
+  snprintf(path, sizeof(path), "/dev/fd/%d", fds[0]);
+
+  Source source;
+  TEST_ASSERT_EQUAL_INT(SOURCE_OPEN_OK, open_source_file(&source, path));
+  close(fds[0]);
+  TEST_ASSERT_EQUAL_INT(SOURCE_READ, source.kind);
+  TEST_ASSERT_EQUAL_size_t(strlen(contents), source.length);
+  TEST_ASSERT_EQUAL_STRING_LEN(contents, source.data, source.length);
+
+  Tokenizer tokenizer;
+  TEST_ASSERT_EQUAL_INT(TOKENIZER_INIT_OK,
+                        init_tokenizer_source(&tokenizer, &source));
+
+  TokenSpan token = next_token(&tokenizer);
+  TEST_ASSERT_EQUAL_STRING_LEN("let", tokenizer_span_text(&tokenizer, token),
+                               token.length);
+
+  free_tokenizer(&tokenizer);
+  free_source(&source);
+}
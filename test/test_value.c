@@ -0,0 +1,58 @@
+#include <math.h>
+
+#include "../include/value.h"
+#include "../third_party/Unity/src/unity.h"
+
+void test_value_is_boxed_in_64_bits(void) {
+  TEST_ASSERT_EQUAL_size_t(8, sizeof(Value));
+}
+
+void test_value_round_trips_numbers(void) {
+  const double numbers[] = {0.0, -0.0, 1.0, -1.5, 1e308, 5e-324, INFINITY,
+                            -INFINITY};
+
+  for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+    Value value = value_number(numbers[i]);
+    TEST_ASSERT_TRUE(value_is_number(value));
+    TEST_ASSERT_EQUAL_INT(VALUE_NUMBER, value_type(value));
+    TEST_ASSERT_EQUAL_MEMORY(&numbers[i], &value, sizeof(double));
+  }
+
+  /* Every NaN, whatever its payload, stays a number. */
+  Value nan = value_number(-NAN);
+  TEST_ASSERT_TRUE(value_is_number(nan));
+  TEST_ASSERT_TRUE(isnan(value_as_number(nan)));
+}
+
+void test_value_distinguishes_singletons_and_objects(void) {
+  Value values[] = {value_undefined(), value_null(), value_boolean(false),
+                    value_boolean(true)};
+  const ValueType types[] = {VALUE_UNDEFINED, VALUE_NULL, VALUE_BOOLEAN,
+                             VALUE_BOOLEAN};
+
+  for (size_t i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL_INT(types[i], value_type(values[i]));
+    TEST_ASSERT_FALSE(value_is_number(values[i]));
+    TEST_ASSERT_FALSE(value_is_object(values[i]));
+  }
+
+  TEST_ASSERT_TRUE(value_as_boolean(values[3]));
+  TEST_ASSERT_FALSE(value_as_boolean(values[2]));
+  TEST_ASSERT_FALSE(value_is_boolean(values[1]));
+
+  int object;
+  Value boxed = value_object(&object);
+  TEST_ASSERT_EQUAL_INT(VALUE_OBJECT, value_type(boxed));
+  TEST_ASSERT_EQUAL_PTR(&object, value_as_object(boxed));
+}
+
+void test_value_adds_without_allocating(void) {
+  Value sum = value_add(value_number(0.5), value_boolean(true));
+  TEST_ASSERT_TRUE(value_as_number(sum) == 1.5);
+
+  sum = value_add(value_null(), value_number(2.0));
+  TEST_ASSERT_TRUE(value_as_number(sum) == 2.0);
+
+  TEST_ASSERT_TRUE(
+      isnan(value_as_number(value_add(value_undefined(), value_number(1)))));
+}
@@ -0,0 +1,256 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/compiler.h"
+#include "../include/vm.h"
+#include "../third_party/Unity/src/unity.h"
+
+/*
+ * Parses, resolves, compiles and runs a program, leaving its chunk and
+ * registers in `chunk` and `vm`.
+ */
+static CompileError run_program(const char *source, Chunk *chunk, VM *vm) {
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, source));
+
+  init_chunk(chunk);
+  ASTNode *program = ast_parse_program(&ast);
+  resolve_program(program);
+  CompileError error = compile_program(program, chunk);
+  free_ast(&ast);
+
+  init_vm(vm);
+  if (error == COMPILE_OK) {
+    TEST_ASSERT_EQUAL_INT(VM_RUN_OK, vm_run(vm, chunk));
+  }
+
+  return error;
+}
+
+/*
+ * Returns the index of a property in the property table of a chunk.
+ */
+static uint32_t property_index(const Chunk *chunk, const char *name) {
+  for (uint32_t i = 0; i < chunk->property_count; i++) {
+    if (strcmp(chunk->properties[i], name) == 0)
+      return i;
+  }
+
+  TEST_FAIL_MESSAGE("unknown property");
+  return 0;
+}
+
+void test_vm_adds_numbers_and_variables(void) {
+  Chunk chunk;
+  VM vm;
+  TEST_ASSERT_EQUAL_INT(
+      COMPILE_OK,
+      run_program("let a = 1; let b = a + 2; let c = a + b + 39;", &chunk,
+                  &vm));
+
+  TEST_ASSERT_EQUAL_size_t(3, chunk.variable_count);
+  TEST_ASSERT_EQUAL_STRING("c", chunk.variables[2]);
+
+  TEST_ASSERT_TRUE(value_is_number(vm.registers[1]));
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[1]) == 3.0);
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[2]) == 43.0);
+
+  free_vm(&vm);
+  free_chunk(&chunk);
+}
+
+void test_vm_converts_primitives_to_numbers(void) {
+  Chunk chunk;
+  VM vm;
+  TEST_ASSERT_EQUAL_INT(
+      COMPILE_OK, run_program("let t = true + 1; let n = null + false; let u; "
+                              "let x = u + 1; let y = t;",
+                              &chunk, &vm));
+
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[0]) == 2.0);
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[1]) == 0.0);
+  TEST_ASSERT_TRUE(value_is_undefined(vm.registers[2]));
+  TEST_ASSERT_TRUE(isnan(value_as_number(vm.registers[3])));
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[4]) == 2.0);
+
+  free_vm(&vm);
+  free_chunk(&chunk);
+}
+
+void test_vm_runs_arithmetic_and_assignments(void) {
+  Chunk chunk;
+  VM vm;
+  TEST_ASSERT_EQUAL_INT(
+      COMPILE_OK,
+      run_program("let a = 10; let b = a - 3 * 2; let c = -a % 3; let d = !a; "
+                  "a = a / 4; let e = +true; let f = a + (a = 1); b = c = 7;",
+                  &chunk, &vm));
+
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[0]) == 1.0);
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[1]) == 7.0);
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[2]) == 7.0);
+  TEST_ASSERT_TRUE(value_is_boolean(vm.registers[3]));
+  TEST_ASSERT_FALSE(value_as_boolean(vm.registers[3]));
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[4]) == 1.0);
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[5]) == 3.5);
+
+  free_vm(&vm);
+  free_chunk(&chunk);
+
+  TEST_ASSERT_EQUAL_INT(COMPILE_OK,
+                        run_program("let a = 10; let c = -a % 3;", &chunk,
+                                    &vm));
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[1]) == -1.0);
+  free_vm(&vm);
+  free_chunk(&chunk);
+
+  TEST_ASSERT_EQUAL_INT(COMPILE_ERROR_UNDECLARED,
+                        run_program("let a = 1; b = a;", &chunk, &vm));
+  free_chunk(&chunk);
+}
+
+void test_compiler_rejects_unknown_variables(void) {
+  Chunk chunk;
+  VM vm;
+  TEST_ASSERT_EQUAL_INT(COMPILE_ERROR_UNDECLARED,
+                        run_program("let a = b + 1;", &chunk, &vm));
+  free_chunk(&chunk);
+
+  TEST_ASSERT_EQUAL_INT(COMPILE_ERROR_UNDECLARED,
+                        run_program("let a = a;", &chunk, &vm));
+  free_chunk(&chunk);
+
+  /* `b` is declared, but only after it is read. */
+  TEST_ASSERT_EQUAL_INT(COMPILE_ERROR_UNDECLARED,
+                        run_program("let a = b; let b = 1;", &chunk, &vm));
+  free_chunk(&chunk);
+
+  /* The resolver rejects the program, so the tree is left unresolved. */
+  TEST_ASSERT_EQUAL_INT(COMPILE_ERROR_UNRESOLVED,
+                        run_program("let a = 1; let a = 2;", &chunk, &vm));
+  free_chunk(&chunk);
+}
+
+void test_vm_caches_property_accesses(void) {
+  Chunk chunk;
+  VM vm;
+  TEST_ASSERT_EQUAL_INT(
+      COMPILE_OK,
+      run_program("let o = {x: 1, y: 2}; let p = {x: 3, y: {z: 4},}; "
+                  "let s = o.x + p.y.z; o.z = 5; p.x = 6; let m = o.w; "
+                  "let n = (1).x;",
+                  &chunk, &vm));
+
+  Object *o = (Object *)value_as_object(vm.registers[0]);
+  Object *p = (Object *)value_as_object(vm.registers[1]);
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[2]) == 5.0);
+  TEST_ASSERT_TRUE(value_is_undefined(vm.registers[3]));
+  TEST_ASSERT_TRUE(value_is_undefined(vm.registers[4]));
+  TEST_ASSERT_EQUAL_UINT32(3, o->shape->slot_count);
+  TEST_ASSERT_EQUAL_UINT32(2, p->shape->slot_count);
+  TEST_ASSERT_TRUE(o->shape->parent == p->shape);
+  TEST_ASSERT_TRUE(value_as_number(o->slots[2]) == 5.0);
+  TEST_ASSERT_TRUE(value_as_number(p->slots[0]) == 6.0);
+
+  /* Every site misses once per shape on the first run and hits afterwards. */
+  uint64_t misses = vm.ic_misses;
+  TEST_ASSERT_TRUE(misses > 0);
+  TEST_ASSERT_EQUAL_UINT64(0, vm.ic_hits);
+
+  size_t shapes = vm.heap.shape_count;
+  TEST_ASSERT_EQUAL_INT(VM_RUN_OK, vm_run(&vm, &chunk));
+  TEST_ASSERT_EQUAL_UINT64(misses, vm.ic_misses);
+  TEST_ASSERT_EQUAL_UINT64(misses, vm.ic_hits);
+  TEST_ASSERT_EQUAL_size_t(shapes, vm.heap.shape_count);
+  TEST_ASSERT_TRUE(value_as_number(vm.registers[2]) == 5.0);
+
+  free_vm(&vm);
+  free_chunk(&chunk);
+
+  TEST_ASSERT_EQUAL_INT(
+      COMPILE_OK, run_program("let u = {}; u.a = 1;", &chunk, &vm));
+  free_vm(&vm);
+  free_chunk(&chunk);
+}
+
+void test_vm_rejects_properties_of_undefined(void) {
+  const char *sources[] = {"let u; let v = u.x;", "let n = null; n.x = 1;"};
+
+  for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+    AST ast;
+    TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, sources[i]));
+
+    Chunk chunk;
+    init_chunk(&chunk);
+    ASTNode *program = ast_parse_program(&ast);
+    TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+    TEST_ASSERT_EQUAL_INT(COMPILE_OK, compile_program(program, &chunk));
+    free_ast(&ast);
+
+    VM vm;
+    init_vm(&vm);
+    TEST_ASSERT_EQUAL_INT(VM_RUN_ERROR_TYPE, vm_run(&vm, &chunk));
+    free_vm(&vm);
+    free_chunk(&chunk);
+  }
+}
+
+void test_vm_collects_garbage_while_running(void) {
+  /* Each statement replaces `t` with new objects; every hundredth one is
+   * kept in a chain. */
+  char *source = malloc(64 * 1024);
+  TEST_ASSERT_NOT_NULL(source);
+
+  size_t length = (size_t)sprintf(source, "let keep = {n: 0}; let t;\n");
+  for (int i = 1; i <= 2000; i++) {
+    length += (size_t)sprintf(source + length, "t = {a: {b: %d}};\n", i);
+    if (i % 100 == 0) {
+      length += (size_t)sprintf(source + length,
+                                "keep = {next: keep, t: t, n: %d};\n", i);
+    }
+  }
+
+  AST ast;
+  TEST_ASSERT_EQUAL_INT(AST_INIT_OK, init_ast(&ast, source));
+  Chunk chunk;
+  init_chunk(&chunk);
+  ASTNode *program = ast_parse_program(&ast);
+  TEST_ASSERT_EQUAL_INT(RESOLVE_OK, resolve_program(program));
+  TEST_ASSERT_EQUAL_INT(COMPILE_OK, compile_program(program, &chunk));
+  free_ast(&ast);
+  free(source);
+
+  VM vm;
+  init_vm(&vm);
+  vm.heap.nursery_size = 4096;
+  TEST_ASSERT_EQUAL_INT(VM_RUN_OK, vm_run(&vm, &chunk));
+
+  TEST_ASSERT_TRUE(vm.heap.stats.minor_collections > 0);
+  TEST_ASSERT_TRUE(vm.heap.old.count < 200);
+
+  uint32_t next = property_index(&chunk, "next");
+  uint32_t n = property_index(&chunk, "n");
+  uint32_t t = property_index(&chunk, "t");
+  uint32_t a = property_index(&chunk, "a");
+  uint32_t b = property_index(&chunk, "b");
+
+  int count = 0;
+  for (Value link = vm.registers[0]; !value_is_undefined(link); count++) {
+    const Object *keep = (const Object *)value_as_object(link);
+    double number = value_as_number(object_get(keep, n));
+    TEST_ASSERT_TRUE(number == 2000.0 - 100.0 * count);
+
+    if (number > 0) {
+      const Object *inner = (const Object *)value_as_object(
+          object_get((const Object *)value_as_object(object_get(keep, t)), a));
+      TEST_ASSERT_TRUE(value_as_number(object_get(inner, b)) == number);
+    }
+    link = object_get(keep, next);
+  }
+  TEST_ASSERT_EQUAL_INT(21, count);
+
+  free_vm(&vm);
+  free_chunk(&chunk);
+}